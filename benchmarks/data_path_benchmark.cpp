@@ -0,0 +1,641 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file data_path_benchmark.cpp
+   \brief Benchmark of the whole data path, with regression thresholds.
+
+   Runs the steps of the realtime cycle of the EthercatCommunicator on the simulated master
+   (\see SimulatedMaster), with the real objects of the node, for every number of slaves:
+   - cycle_exec: a whole cycle, from the wakeup to the end of the publishing of the raw data
+   - publish_raw: the publish_raw_data() of the cycle, the copy of the domain to the pdo_raw_ring
+   - command_intake: the PDOOutListener::pdo_out_batch_callback() of an int32 command
+   - command_to_domain: from the reception of the command to its copy to the domain, by the next cycle
+   - decode: the decoding and the serialization of the PDOIn messages of all the slaves, from a snapshot
+
+   The commands are sent in the middle of every other cycle, so command_to_domain is about half
+   a period, plus the cost of the intake and of the copy. The percentiles are exact (every sample is kept).
+   Doesn't need a running master, neither the IgH one, nor a ROS one. For realistic results, it
+   runs the cycles in SCHED_FIFO (\a --priority), when it's allowed to.
+
+   The results are printed as a table, and written (\a --json) as a JSON object, with one metric per
+   line. With \a --baseline, the p50 and the p99 of every metric are compared to the ones of a previous
+   JSON: an increase of more than \a --max-increase-ns (and more than \a --max-increase-pct percent,
+   if given) is a regression, and the exit status is 1.
+
+   Usage: data_path_benchmark [--slaves 4,32] [--cycles 5000] [--period-ns 1000000]
+                              [--decode-iterations 20000] [--priority 80] [--json results.json]
+                              [--baseline previous.json] [--max-increase-ns 5000] [--max-increase-pct 0]
+*/
+
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include "ros/serialization.h"
+#include "ether_ros/PDOIn.h"
+#include "ether_ros/ModifyPDOVariablesBatch.h"
+#include "pdo_bindings.h"
+#include "simulated_master.h"
+#include "utilities.h"
+#include "ether_ros.h"
+
+/************************GLOBAL VARIABLES ************************************/
+
+uint8_t *domain1_pd;
+uint8_t *process_data_buf;
+size_t total_process_data;
+size_t total_pdo_in;
+size_t total_pdo_out;
+EthercatMaster *ethercat_master;
+ec_master_state_t master_state;
+ec_master_info_t master_info;
+EthercatDomain *ethercat_domains;
+int domains_count;
+slave_struct *ethercat_slaves;
+int slaves_count;
+slave_pd_offsets *slave_offsets;
+OutputImage output_image;
+EthercatCommunicator ethercat_comm;
+PDOInPublisher pdo_in_publisher;
+PDOOutPublisher pdo_out_publisher;
+PDOOutListener pdo_out_listener;
+PDOOutPublisherTimer pdo_out_publisher_timer;
+PDORawRing pdo_raw_ring;
+PDORawPublisher pdo_raw_publisher;
+CallbackSpinner command_spinner;
+CallbackSpinner telemetry_spinner;
+PDORecorder pdo_recorder;
+SharedMemoryMirror shared_memory_mirror;
+CycleStatsPublisher cycle_stats_publisher;
+HealthMonitor health_monitor;
+OutputWatchdog output_watchdog;
+ControllerManager controller_manager;
+std::atomic<int> FREQUENCY;
+int RUN_TIME;
+std::atomic<int> PERIOD_NS;
+
+/****************************************************************************/
+
+#define CLOCK_BENCH CLOCK_MONOTONIC
+#define TIMESPEC_NS(T) ((uint64_t)(T).tv_sec * NSEC_PER_SEC + (T).tv_nsec)
+
+// the laelaps_leg slaves of config/ethercat_slaves.yaml
+#define PDO_IN_SIZE 22
+#define PDO_OUT_SIZE 38
+#define COMMAND_OFFSET 2 // desired_x_value, an int32
+#define COMMAND_STAMPS 1024
+
+static const struct
+{
+    const char *name;
+    const char *type;
+    int offset;
+} pdo_in_layout[] = {
+    {"hip_angle", "int16", 0},
+    {"desired_hip_angle", "int16", 2},
+    {"time", "uint16", 4},
+    {"knee_angle", "int16", 6},
+    {"desired_knee_angle", "int16", 8},
+    {"PWM10000_knee", "int16", 10},
+    {"PWM10000_hip", "int16", 12},
+    {"velocity_knee1000", "int32", 14},
+    {"velocity_hip1000", "int32", 18},
+};
+
+typedef struct bench_options
+{
+    std::vector<int> slaves;
+    long cycles;
+    int period_ns;
+    long decode_iterations;
+    int priority;
+    const char *json;
+    const char *baseline;
+    long max_increase_ns;
+    double max_increase_pct;
+} bench_options;
+
+/* The samples of a metric, kept for exact percentiles. Single writer, no allocation while recording. */
+class sample_set
+{
+  private:
+    std::vector<uint64_t> samples_;
+    size_t count_;
+
+  public:
+    void reserve(size_t capacity)
+    {
+        samples_.assign(capacity, 0);
+        count_ = 0;
+    }
+    inline void add(uint64_t value_ns)
+    {
+        if (count_ < samples_.size())
+            samples_[count_++] = value_ns;
+    }
+    size_t count() const
+    {
+        return count_;
+    }
+    // sorts the samples: no more add() after it
+    uint64_t percentile(double p)
+    {
+        if (!count_)
+            return 0;
+        std::sort(samples_.begin(), samples_.begin() + count_);
+        size_t index = (size_t)(p / 100.0 * count_);
+        return samples_[std::min(index, count_ - 1)];
+    }
+};
+
+typedef struct metric_result
+{
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+} metric_result;
+
+typedef std::map<std::string, metric_result> results;
+
+/* The state shared by the cycle loop and the command thread of a run. */
+typedef struct bench_run
+{
+    const bench_options *options;
+    uint64_t start_ns;                              // the wakeup of cycle 1
+    std::atomic<bool> done;
+    std::atomic<uint64_t> sent_ns[COMMAND_STAMPS]; // when the command with the value i % COMMAND_STAMPS was received
+    sample_set cycle_exec;
+    sample_set publish_raw;
+    sample_set command_intake;
+    sample_set command_to_domain;
+} bench_run;
+
+static uint64_t now_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_BENCH, &t);
+    return TIMESPEC_NS(t);
+}
+
+static struct timespec ns_to_timespec(uint64_t ns)
+{
+    struct timespec t;
+
+    t.tv_sec = ns / NSEC_PER_SEC;
+    t.tv_nsec = ns % NSEC_PER_SEC;
+    return t;
+}
+
+static void add_result(results &r, const std::string &name, sample_set &samples)
+{
+    metric_result m;
+
+    m.count = samples.count();
+    m.p50 = samples.percentile(50);
+    m.p99 = samples.percentile(99);
+    m.p999 = samples.percentile(99.9);
+    m.max = samples.percentile(100);
+    r[name] = m;
+}
+
+/* The bus of the node, with the simulated master: a single domain, [pdo_out][pdo_in] per slave. */
+static void setup_bus(int slaves, int ring_capacity)
+{
+    simulated_master_config config;
+    SimulatedMaster *sim = new SimulatedMaster();
+    std::vector<utilities::output_range> output_regions(slaves);
+
+    // no simulated bus latency: only the cost of the node is measured
+    config.slaves = slaves;
+    config.pdo_in_size = PDO_IN_SIZE;
+    config.pdo_out_size = PDO_OUT_SIZE;
+    config.receive_ns = 0;
+    config.send_ns = 0;
+    config.jitter_ns = 0;
+    config.loopback = true;
+    sim->init(config);
+    ethercat_master = sim;
+    if (!ethercat_master->request(0) || ethercat_master->info(&master_info) != 0)
+    {
+        fprintf(stderr, "Failed to set up the simulated master\n");
+        exit(1);
+    }
+
+    domains_count = 1;
+    ethercat_domains = new EthercatDomain[domains_count];
+    ethercat_domains[0].init("benchmark", 1, 0);
+    slaves_count = slaves;
+    slave_offsets = new slave_pd_offsets[slaves_count];
+    total_pdo_in = 0;
+    total_pdo_out = 0;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        int slave_config = ethercat_master->slave_config(0, i, 0, 0);
+        int pdo_out = ethercat_master->reg_pdo_entry(slave_config, 0x7000, 1, ethercat_domains[0].get_domain());
+        int pdo_in = ethercat_master->reg_pdo_entry(slave_config, 0x6000, 1, ethercat_domains[0].get_domain());
+
+        slave_offsets[i].pdo_out = pdo_out;
+        slave_offsets[i].pdo_out_size = pdo_in - pdo_out;
+        slave_offsets[i].pdo_in = pdo_in;
+        slave_offsets[i].pdo_in_size = PDO_IN_SIZE;
+        slave_offsets[i].raw_out = total_pdo_out;
+        slave_offsets[i].raw_in = total_pdo_in;
+        total_pdo_out += slave_offsets[i].pdo_out_size;
+        total_pdo_in += slave_offsets[i].pdo_in_size;
+        output_regions[i].offset = slave_offsets[i].pdo_out;
+        output_regions[i].size = slave_offsets[i].pdo_out_size;
+    }
+    ethercat_domains[0].set_offset(0);
+    total_process_data = ethercat_domains[0].get_size();
+    // the objects of the previous run are left behind, like the node never frees them
+    output_image.init(total_process_data, output_regions.data(), output_regions.size());
+    pdo_raw_ring.init(ring_capacity, total_process_data);
+
+    if (ethercat_master->activate() || !(domain1_pd = ethercat_master->domain_data(ethercat_domains[0].get_domain())))
+    {
+        fprintf(stderr, "Failed to activate the simulated master\n");
+        exit(1);
+    }
+    ethercat_domains[0].activate(domain1_pd);
+}
+
+static void set_fifo(int priority)
+{
+    struct sched_param param;
+
+    param.sched_priority = priority;
+    if (priority > 0 && pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        fprintf(stderr, "SCHED_FIFO %d not allowed, the results will be noisier\n", priority);
+}
+
+/* The steps of EthercatCommunicator::run(), without the distributed clocks and the statistics. */
+static void run_cycle(uint64_t cycle)
+{
+    ethercat_master->receive();
+    for (int i = 0; i < domains_count; i++)
+        ethercat_domains[i].process();
+    utilities::copy_process_data_buffer_to_buf(domain1_pd, cycle);
+    for (int i = 0; i < domains_count; i++)
+        ethercat_domains[i].queue(cycle);
+    ethercat_master->send();
+}
+
+static void *run_cycles(void *arg)
+{
+    bench_run *run = (bench_run *)arg;
+    uint8_t *command = domain1_pd + slave_offsets[slaves_count - 1].pdo_out + COMMAND_OFFSET;
+    int32_t last_value = 0;
+
+    set_fifo(run->options->priority);
+    for (uint64_t c = 1; c <= (uint64_t)run->options->cycles; c++)
+    {
+        uint64_t wakeup_ns = run->start_ns + (c - 1) * run->options->period_ns;
+        struct timespec wakeup_time = ns_to_timespec(wakeup_ns);
+
+        clock_nanosleep(CLOCK_BENCH, TIMER_ABSTIME, &wakeup_time, NULL);
+        uint64_t start_ns = now_ns();
+        run_cycle(c);
+        // the command of the listener has reached the domain
+        int32_t value = EC_READ_S32(command);
+        if (value != last_value)
+        {
+            run->command_to_domain.add(now_ns() - run->sent_ns[value % COMMAND_STAMPS].load(std::memory_order_acquire));
+            last_value = value;
+        }
+        uint64_t publish_ns = now_ns();
+        pdo_raw_ring.write(c, wakeup_ns, domain1_pd);
+        uint64_t end_ns = now_ns();
+        run->publish_raw.add(end_ns - publish_ns);
+        run->cycle_exec.add(end_ns - start_ns);
+    }
+    run->done.store(true, std::memory_order_release);
+    return NULL;
+}
+
+/* Sends a command in the middle of every other cycle, like a controller of another thread would. */
+static void run_commands(bench_run *run)
+{
+    ether_ros::ModifyPDOVariablesBatch::Ptr batch(new ether_ros::ModifyPDOVariablesBatch());
+    ether_ros::PDOOutEntry entry;
+    int32_t value = 0;
+
+    entry.slave_id = slaves_count - 1;
+    entry.offset = COMMAND_OFFSET;
+    entry.bit = 0;
+    entry.type = PDO_INT32;
+    batch->target_cycle = 0;
+    batch->based_on_cycle = 0;
+    batch->entries.push_back(entry);
+    for (uint64_t c = 2; !run->done.load(std::memory_order_acquire); c += 2)
+    {
+        struct timespec send_time = ns_to_timespec(run->start_ns + (c - 1) * run->options->period_ns +
+                                                   run->options->period_ns / 2);
+
+        clock_nanosleep(CLOCK_BENCH, TIMER_ABSTIME, &send_time, NULL);
+        if (c >= (uint64_t)run->options->cycles)
+            continue; // the last cycle wouldn't see it
+        // never 0, the initial value of the outputs
+        value = value % (COMMAND_STAMPS - 1) + 1;
+        batch->entries[0].value = value;
+        uint64_t sent_ns = now_ns();
+        run->sent_ns[value].store(sent_ns, std::memory_order_release);
+        pdo_out_listener.pdo_out_batch_callback(batch);
+        run->command_intake.add(now_ns() - sent_ns);
+    }
+}
+
+static void bench_cycles(const bench_options &options, int slaves, results &r)
+{
+    static bench_run run;
+    pthread_t thread;
+    int ret;
+
+    run.options = &options;
+    run.done.store(false, std::memory_order_relaxed);
+    for (int i = 0; i < COMMAND_STAMPS; i++)
+        run.sent_ns[i].store(0, std::memory_order_relaxed);
+    run.cycle_exec.reserve(options.cycles);
+    run.publish_raw.reserve(options.cycles);
+    run.command_intake.reserve(options.cycles);
+    run.command_to_domain.reserve(options.cycles);
+    // a few periods for the threads to start
+    run.start_ns = now_ns() + 10 * (uint64_t)options.period_ns;
+    ret = pthread_create(&thread, NULL, run_cycles, &run);
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_create");
+    }
+    run_commands(&run);
+    pthread_join(thread, NULL);
+
+    std::string suffix = "." + std::to_string(slaves);
+    add_result(r, "cycle_exec" + suffix, run.cycle_exec);
+    add_result(r, "publish_raw" + suffix, run.publish_raw);
+    add_result(r, "command_intake" + suffix, run.command_intake);
+    add_result(r, "command_to_domain" + suffix, run.command_to_domain);
+}
+
+/* The work of PDOInPublisher::publish_pdo_in(), for a snapshot of the ring, up to the serialization. */
+static void bench_decode(const bench_options &options, int slaves, results &r)
+{
+    XmlRpc::XmlRpcValue list;
+    PDOLayout layout;
+    PDODecoder<ether_ros::PDOIn> decoder;
+    PDORawRing::cursor cursor;
+    pdo_raw_snapshot snapshot;
+    std::vector<uint8_t> frame(pdo_raw_ring.frame_size());
+    sample_set decode;
+    uint64_t bytes = 0;
+
+    for (size_t i = 0; i < sizeof(pdo_in_layout) / sizeof(pdo_in_layout[0]); i++)
+    {
+        list[i]["name"] = std::string(pdo_in_layout[i].name);
+        list[i]["type"] = std::string(pdo_in_layout[i].type);
+        list[i]["offset"] = pdo_in_layout[i].offset;
+    }
+    if (!layout.load(list, "laelaps_leg/pdo_in"))
+        exit(1);
+    decoder.init(layout, pdo_in_bindings, pdo_in_bindings_count);
+    // a reader from the start of the ring, for the snapshot of the last cycle
+    cursor.next = 0;
+    cursor.overruns = 0;
+    snapshot.data = frame.data();
+    if (!pdo_raw_ring.read_latest(&cursor, &snapshot))
+    {
+        fprintf(stderr, "No snapshot in the ring\n");
+        exit(1);
+    }
+    decode.reserve(options.decode_iterations);
+    for (long i = 0; i < options.decode_iterations; i++)
+    {
+        uint64_t start_ns = now_ns();
+        for (int s = 0; s < slaves; s++)
+        {
+            ether_ros::PDOIn pdo_in;
+
+            decoder.decode(snapshot.data + slave_offsets[s].pdo_in, pdo_in);
+            ros::SerializedMessage m = ros::serialization::serializeMessage(pdo_in);
+            bytes += m.num_bytes;
+        }
+        decode.add(now_ns() - start_ns);
+    }
+    __asm__ __volatile__("" : : "r"(bytes) : "memory");
+    add_result(r, "decode." + std::to_string(slaves), decode);
+}
+
+static bool write_json(const char *path, const bench_options &options, const results &r)
+{
+    FILE *f = strcmp(path, "-") ? fopen(path, "w") : stdout;
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "{\n  \"period_ns\": %d,\n  \"cycles\": %ld,\n  \"metrics\": {\n", options.period_ns, options.cycles);
+    for (results::const_iterator it = r.begin(); it != r.end(); ++it)
+    {
+        const metric_result &m = it->second;
+        fprintf(f, "    \"%s\": {\"count\": %lu, \"p50\": %lu, \"p99\": %lu, \"p999\": %lu, \"max\": %lu}%s\n",
+                it->first.c_str(), m.count, m.p50, m.p99, m.p999, m.max, std::next(it) == r.end() ? "" : ",");
+    }
+    fprintf(f, "  }\n}\n");
+    if (f != stdout)
+        fclose(f);
+    return true;
+}
+
+/* Reads the metrics of a JSON written by write_json(), a line per metric. */
+static bool read_json(const char *path, results &r)
+{
+    FILE *f = fopen(path, "r");
+    char line[512];
+    char name[128];
+    metric_result m;
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, " \"%127[^\"]\": {\"count\": %lu, \"p50\": %lu, \"p99\": %lu, \"p999\": %lu, \"max\": %lu}",
+                   name, &m.count, &m.p50, &m.p99, &m.p999, &m.max) == 6)
+            r[name] = m;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool regressed(uint64_t baseline, uint64_t value, const bench_options &options)
+{
+    int64_t increase = (int64_t)value - (int64_t)baseline;
+
+    return increase > options.max_increase_ns &&
+           (options.max_increase_pct <= 0 || increase > baseline * options.max_increase_pct / 100.0);
+}
+
+/* The metrics of the baseline that went up beyond the thresholds. The max and the p99.9 are too noisy to gate. */
+static int compare(const results &baseline, const results &r, const bench_options &options)
+{
+    int regressions = 0;
+
+    for (results::const_iterator it = r.begin(); it != r.end(); ++it)
+    {
+        results::const_iterator base = baseline.find(it->first);
+        if (base == baseline.end())
+            continue;
+        const char *percentiles[] = {"p50", "p99"};
+        uint64_t base_values[] = {base->second.p50, base->second.p99};
+        uint64_t values[] = {it->second.p50, it->second.p99};
+        for (int i = 0; i < 2; i++)
+        {
+            if (!regressed(base_values[i], values[i], options))
+                continue;
+            printf("REGRESSION %s %s: %lu ns -> %lu ns (+%ld ns)\n", it->first.c_str(), percentiles[i],
+                   base_values[i], values[i], (int64_t)values[i] - (int64_t)base_values[i]);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--slaves 4,32] [--cycles N] [--period-ns N] [--decode-iterations N] [--priority N]\n"
+                    "       [--json file|-] [--baseline file] [--max-increase-ns N] [--max-increase-pct P]\n",
+            program);
+    exit(2);
+}
+
+static void parse_options(int argc, char **argv, bench_options *options)
+{
+    options->slaves.clear();
+    options->cycles = 5000;
+    options->period_ns = 1000000;
+    options->decode_iterations = 20000;
+    options->priority = 80;
+    options->json = NULL;
+    options->baseline = NULL;
+    options->max_increase_ns = 5000;
+    options->max_increase_pct = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (i + 1 == argc)
+            usage(argv[0]);
+        const char *value = argv[++i];
+        if (option == "--slaves")
+        {
+            for (const char *p = value; *p; p = strchr(p, ',') ? strchr(p, ',') + 1 : p + strlen(p))
+                options->slaves.push_back(atoi(p));
+        }
+        else if (option == "--cycles")
+            options->cycles = atol(value);
+        else if (option == "--period-ns")
+            options->period_ns = atoi(value);
+        else if (option == "--decode-iterations")
+            options->decode_iterations = atol(value);
+        else if (option == "--priority")
+            options->priority = atoi(value);
+        else if (option == "--json")
+            options->json = value;
+        else if (option == "--baseline")
+            options->baseline = value;
+        else if (option == "--max-increase-ns")
+            options->max_increase_ns = atol(value);
+        else if (option == "--max-increase-pct")
+            options->max_increase_pct = atof(value);
+        else
+            usage(argv[0]);
+    }
+    if (options->slaves.empty())
+    {
+        options->slaves.push_back(4);
+        options->slaves.push_back(32);
+    }
+    for (size_t i = 0; i < options->slaves.size(); i++)
+    {
+        if (options->slaves[i] <= 0 || options->slaves[i] > 255)
+            usage(argv[0]);
+    }
+    if (options->cycles < 10 || options->period_ns <= 0 || options->decode_iterations <= 0)
+        usage(argv[0]);
+}
+
+int main(int argc, char **argv)
+{
+    bench_options options;
+    results r;
+    results baseline;
+
+    parse_options(argc, argv, &options);
+    if (options.baseline && !read_json(options.baseline, baseline))
+        return EXIT_FAILURE;
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1)
+        fprintf(stderr, "mlockall failed, the results will be noisier\n");
+    PERIOD_NS = options.period_ns;
+    FREQUENCY = NSEC_PER_SEC / PERIOD_NS;
+    RUN_TIME = 0;
+
+    for (size_t i = 0; i < options.slaves.size(); i++)
+    {
+        setup_bus(options.slaves[i], 1024);
+        bench_cycles(options, options.slaves[i], r);
+        bench_decode(options, options.slaves[i], r);
+    }
+
+    printf("%-24s %8s %10s %10s %10s %10s\n", "metric (ns)", "count", "p50", "p99", "p99.9", "max");
+    for (results::const_iterator it = r.begin(); it != r.end(); ++it)
+    {
+        const metric_result &m = it->second;
+        printf("%-24s %8lu %10lu %10lu %10lu %10lu\n", it->first.c_str(), m.count, m.p50, m.p99, m.p999, m.max);
+    }
+    if (options.json && !write_json(options.json, options, r))
+        return EXIT_FAILURE;
+    if (options.baseline && compare(baseline, r, options))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file output_copy_benchmark.cpp
+   \brief Microbenchmark of the copy of the output PDOs to the domain, in every cycle.
+
+   Copies the output image to the domain, for 4 and 32 slaves, with:
+   - legacy: the former copy_process_data_buffer_to_buf(), one memcpy per slave, with the offsets
+     fetched from the EthercatSlave objects (out of line getters) in every cycle
+   - ranges: the utilities::copy_output_ranges() of the merged ranges, every range
+   - dirty: the same, when the commit changes a single slave per cycle
+
+   Two layouts of the process image: the laelaps_leg one, [pdo_out][pdo_in] per slave (no ranges
+   can be merged), and the outputs of every slave one after the other (a single range).
+   Only the copy stage of the cycle is timed, not the whole cycle: the \a cycle_exec of the
+   data_path_benchmark measures the whole cycle on the simulated master, for 4 and 32 slaves.
+   Doesn't need ROS or a running master.
+   Usage: output_copy_benchmark [iterations]
+*/
+
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "output_ranges.h"
+
+#define NSEC_PER_SEC (1000000000L)
+#define DIFF_NS(A, B) (((B).tv_sec - (A).tv_sec) * NSEC_PER_SEC + \
+                       (B).tv_nsec - (A).tv_nsec)
+
+#define MAX_SLAVES 32
+#define PDO_IN_SIZE 22
+#define PDO_OUT_SIZE 24
+
+/* The (relevant part of the) EthercatSlave objects the legacy copy walked through. */
+class bench_slave
+{
+  private:
+    std::string slave_id_;
+    int vendor_id_, product_code_, assign_activate_, position_, alias_, input_port_, output_port_;
+    void *ethercat_slave_;
+    int pdo_in_;
+    int pdo_out_;
+    char layouts_[128];
+
+  public:
+    void init(int pdo_out, int pdo_in)
+    {
+        pdo_out_ = pdo_out;
+        pdo_in_ = pdo_in;
+    }
+    __attribute__((noinline)) int get_pdo_in() { return pdo_in_; }
+    __attribute__((noinline)) int get_pdo_out() { return pdo_out_; }
+};
+
+typedef struct bench_setup
+{
+    const char *layout;
+    size_t slaves;
+    bench_slave objects[MAX_SLAVES];
+    std::vector<utilities::output_range> ranges;
+    std::atomic<uint64_t> changed[MAX_SLAVES];
+    std::vector<uint8_t> image;
+    std::vector<uint8_t> domain;
+} bench_setup;
+
+static void setup(bench_setup *b, const char *layout, size_t slaves, bool interleaved)
+{
+    utilities::output_range regions[MAX_SLAVES];
+
+    b->layout = layout;
+    b->slaves = slaves;
+    b->image.assign(slaves * (PDO_IN_SIZE + PDO_OUT_SIZE), 0);
+    b->domain.assign(b->image.size(), 0);
+    for (size_t s = 0; s < slaves; s++)
+    {
+        size_t out = interleaved ? s * (PDO_IN_SIZE + PDO_OUT_SIZE) : s * PDO_OUT_SIZE;
+        size_t in = interleaved ? out + PDO_OUT_SIZE : slaves * PDO_OUT_SIZE + s * PDO_IN_SIZE;
+        // the legacy copy took the inputs offset as the end of the outputs
+        b->objects[s].init(out, interleaved ? in : out + PDO_OUT_SIZE);
+        regions[s].offset = out;
+        regions[s].size = PDO_OUT_SIZE;
+    }
+    utilities::merge_output_ranges(regions, slaves, b->ranges);
+    for (size_t i = 0; i < MAX_SLAVES; i++)
+        b->changed[i].store(0, std::memory_order_relaxed);
+}
+
+static void copy_legacy(bench_setup *b, uint64_t /* seq */)
+{
+    for (size_t i = 0; i < b->slaves; i++)
+    {
+        memcpy((&b->domain[0] + b->objects[i].get_pdo_out()),
+               (&b->image[0] + b->objects[i].get_pdo_out()),
+               (size_t)(b->objects[i].get_pdo_in() - b->objects[i].get_pdo_out()));
+    }
+}
+
+static void copy_ranges(bench_setup *b, uint64_t /* seq */)
+{
+    utilities::copy_output_ranges(&b->domain[0], &b->image[0], b->ranges.data(), b->ranges.size(), b->changed, 0);
+}
+
+static void copy_dirty(bench_setup *b, uint64_t seq)
+{
+    // the writer changed seq % slaves: a single range, or the one range of every slave
+    b->changed[(seq % b->slaves) % b->ranges.size()].store(seq, std::memory_order_relaxed);
+    utilities::copy_output_ranges(&b->domain[0], &b->image[0], b->ranges.data(), b->ranges.size(), b->changed, seq - 1);
+}
+
+typedef void (*copy_fn)(bench_setup *b, uint64_t seq);
+
+static double run(copy_fn copy, bench_setup *b, long iterations)
+{
+    struct timespec start_time, end_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (long i = 1; i <= iterations; i++)
+    {
+        b->image[b->objects[i % b->slaves].get_pdo_out()] = (uint8_t)i; // a commit per cycle
+        copy(b, i);
+        __asm__ __volatile__("" : : "r"(&b->domain[0]) : "memory");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    return (double)DIFF_NS(start_time, end_time) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t slave_counts[] = {4, 32};
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    static bench_setup b;
+
+    printf("%-12s %-7s %-7s %10s %10s %10s\n", "layout", "slaves", "ranges", "legacy", "ranges", "dirty");
+    for (int interleaved = 1; interleaved >= 0; interleaved--)
+    {
+        for (size_t i = 0; i < sizeof(slave_counts) / sizeof(slave_counts[0]); i++)
+        {
+            setup(&b, interleaved ? "out/in" : "outputs", slave_counts[i], interleaved);
+            double legacy_ns = run(copy_legacy, &b, iterations);
+            double ranges_ns = run(copy_ranges, &b, iterations);
+            double dirty_ns = run(copy_dirty, &b, iterations);
+            printf("%-12s %-7zu %-7zu %8.1fns %8.1fns %8.1fns\n", b.layout, b.slaves, b.ranges.size(),
+                   legacy_ns, ranges_ns, dirty_ns);
+        }
+    }
+    return EXIT_SUCCESS;
+}
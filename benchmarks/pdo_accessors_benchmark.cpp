@@ -0,0 +1,260 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_accessors_benchmark.cpp
+   \brief Microbenchmark of the PDO accessors.
+
+   Decodes the input PDOs of the laelaps_leg layout (see config/ethercat_slaves.yaml), for
+   4, 16 and 32 slaves, with:
+   - legacy: the former out-of-line utilities::process_input_* functions, one call per variable
+   - inline: the utilities::pdo_read<T> accessors, one slave at a time
+   - bulk: the utilities::pdo_read_column<T> accessors, one variable of every slave at a time
+
+   Doesn't need ROS or a running master; only the ecrt.h header, for the legacy functions.
+   Usage: pdo_accessors_benchmark [iterations]
+*/
+
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "ecrt.h"
+#include "pdo_accessors.h"
+
+#define NSEC_PER_SEC (1000000000L)
+#define DIFF_NS(A, B) (((B).tv_sec - (A).tv_sec) * NSEC_PER_SEC + \
+                       (B).tv_nsec - (A).tv_nsec)
+
+#define MAX_SLAVES 32
+#define PDO_IN_SIZE 32
+#define PDO_OUT_SIZE 32
+#define FIELDS 9
+
+/* The input variables of the laelaps_leg layout. */
+typedef struct bench_field
+{
+    uint16_t offset;
+    int size;
+    bool is_signed;
+} bench_field;
+
+static const bench_field fields[FIELDS] = {
+    {0, 2, true}, {2, 2, true}, {4, 2, false}, {6, 2, true}, {8, 2, true},
+    {10, 2, true}, {12, 2, true}, {14, 4, true}, {18, 4, true}};
+
+/* Struct of arrays: one column per variable. */
+typedef struct soa_frame
+{
+    int64_t columns[FIELDS][MAX_SLAVES];
+} soa_frame;
+
+/* The former implementation of utilities.cpp, kept out-of-line, as it was in its own translation unit. */
+namespace legacy
+{
+__attribute__((noinline)) uint8_t process_input_uint8(uint8_t *data_ptr, uint8_t index)
+{
+    uint8_t return_value = 0x00;
+    uint8_t *new_data_ptr;
+    new_data_ptr = (data_ptr + index);
+    return_value = EC_READ_U8(new_data_ptr);
+    return return_value;
+}
+
+__attribute__((noinline)) uint16_t process_input_uint16(uint8_t *data_ptr, uint8_t index)
+{
+    uint16_t return_value = 0x0000;
+    uint8_t new_data_ptr[2];
+    new_data_ptr[0] = data_ptr[index];
+    new_data_ptr[1] = data_ptr[index + 1];
+    return_value = EC_READ_U16(new_data_ptr);
+    return return_value;
+}
+
+__attribute__((noinline)) int16_t process_input_int16(uint8_t *data_ptr, uint8_t index)
+{
+    int16_t return_value = 0x0000;
+    uint8_t new_data_ptr[2];
+    new_data_ptr[0] = data_ptr[index];
+    new_data_ptr[1] = data_ptr[index + 1];
+    return_value = EC_READ_S16(new_data_ptr);
+    return return_value;
+}
+
+__attribute__((noinline)) int32_t process_input_int32(uint8_t *data_ptr, uint8_t index)
+{
+    int32_t return_value = 0x00000000;
+    uint8_t new_data_ptr[4];
+    new_data_ptr[0] = data_ptr[index];
+    new_data_ptr[1] = data_ptr[index + 1];
+    new_data_ptr[2] = data_ptr[index + 2];
+    new_data_ptr[3] = data_ptr[index + 3];
+    return_value = EC_READ_S32(new_data_ptr);
+    return return_value;
+}
+} // namespace legacy
+
+static void decode_legacy(uint8_t *frame, const size_t *slave_offsets, size_t slaves, soa_frame *out)
+{
+    for (size_t s = 0; s < slaves; s++)
+    {
+        uint8_t *data_ptr = frame + slave_offsets[s];
+        for (int f = 0; f < FIELDS; f++)
+        {
+            switch (fields[f].size)
+            {
+            case 1:
+                out->columns[f][s] = legacy::process_input_uint8(data_ptr, fields[f].offset);
+                break;
+            case 2:
+                if (fields[f].is_signed)
+                    out->columns[f][s] = legacy::process_input_int16(data_ptr, fields[f].offset);
+                else
+                    out->columns[f][s] = legacy::process_input_uint16(data_ptr, fields[f].offset);
+                break;
+            default:
+                out->columns[f][s] = legacy::process_input_int32(data_ptr, fields[f].offset);
+                break;
+            }
+        }
+    }
+}
+
+static void decode_inline(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, soa_frame *out)
+{
+    for (size_t s = 0; s < slaves; s++)
+    {
+        const uint8_t *data_ptr = frame + slave_offsets[s];
+        for (int f = 0; f < FIELDS; f++)
+        {
+            switch (fields[f].size)
+            {
+            case 1:
+                out->columns[f][s] = utilities::pdo_read<uint8_t>(data_ptr, fields[f].offset);
+                break;
+            case 2:
+                if (fields[f].is_signed)
+                    out->columns[f][s] = utilities::pdo_read<int16_t>(data_ptr, fields[f].offset);
+                else
+                    out->columns[f][s] = utilities::pdo_read<uint16_t>(data_ptr, fields[f].offset);
+                break;
+            default:
+                out->columns[f][s] = utilities::pdo_read<int32_t>(data_ptr, fields[f].offset);
+                break;
+            }
+        }
+    }
+}
+
+static void decode_bulk(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, soa_frame *out)
+{
+    for (int f = 0; f < FIELDS; f++)
+    {
+        switch (fields[f].size)
+        {
+        case 1:
+            utilities::pdo_read_column<uint8_t>(frame, slave_offsets, slaves, fields[f].offset, out->columns[f]);
+            break;
+        case 2:
+            if (fields[f].is_signed)
+                utilities::pdo_read_column<int16_t>(frame, slave_offsets, slaves, fields[f].offset, out->columns[f]);
+            else
+                utilities::pdo_read_column<uint16_t>(frame, slave_offsets, slaves, fields[f].offset, out->columns[f]);
+            break;
+        default:
+            utilities::pdo_read_column<int32_t>(frame, slave_offsets, slaves, fields[f].offset, out->columns[f]);
+            break;
+        }
+    }
+}
+
+typedef void (*decode_fn)(uint8_t *frame, const size_t *slave_offsets, size_t slaves, soa_frame *out);
+
+static void decode_inline_fn(uint8_t *frame, const size_t *slave_offsets, size_t slaves, soa_frame *out)
+{
+    decode_inline(frame, slave_offsets, slaves, out);
+}
+
+static void decode_bulk_fn(uint8_t *frame, const size_t *slave_offsets, size_t slaves, soa_frame *out)
+{
+    decode_bulk(frame, slave_offsets, slaves, out);
+}
+
+static double run(decode_fn decode, uint8_t *frame, const size_t *slave_offsets, size_t slaves,
+                  soa_frame *out, long iterations)
+{
+    struct timespec start_time, end_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (long i = 0; i < iterations; i++)
+    {
+        frame[slave_offsets[0]] = (uint8_t)i; // the frame changes every cycle, as the domain does
+        decode(frame, slave_offsets, slaves, out);
+        __asm__ __volatile__("" : : "r"(out) : "memory");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    return (double)DIFF_NS(start_time, end_time) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t slave_counts[] = {4, 16, 32};
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    std::vector<uint8_t> frame(MAX_SLAVES * (PDO_IN_SIZE + PDO_OUT_SIZE));
+    size_t slave_offsets[MAX_SLAVES];
+    soa_frame out, reference;
+
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = (uint8_t)(i * 37 + 11);
+    for (int s = 0; s < MAX_SLAVES; s++)
+        slave_offsets[s] = s * (PDO_IN_SIZE + PDO_OUT_SIZE) + PDO_OUT_SIZE; // [pdo_out][pdo_in] per slave
+
+    decode_legacy(&frame[0], slave_offsets, MAX_SLAVES, &reference);
+    decode_bulk(&frame[0], slave_offsets, MAX_SLAVES, &out);
+    if (memcmp(&out, &reference, sizeof(out)) != 0)
+    {
+        fprintf(stderr, "bulk decode differs from the legacy decode\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-8s %10s %10s %10s\n", "slaves", "legacy", "inline", "bulk");
+    for (size_t i = 0; i < sizeof(slave_counts) / sizeof(slave_counts[0]); i++)
+    {
+        size_t slaves = slave_counts[i];
+        double legacy_ns = run(decode_legacy, &frame[0], slave_offsets, slaves, &out, iterations);
+        double inline_ns = run(decode_inline_fn, &frame[0], slave_offsets, slaves, &out, iterations);
+        double bulk_ns = run(decode_bulk_fn, &frame[0], slave_offsets, slaves, &out, iterations);
+        printf("%-8zu %8.1fns %8.1fns %8.1fns\n", slaves, legacy_ns, inline_ns, bulk_ns);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+'''
+Throughput and jitter of the whole pipeline of a running ether_ros node: the realtime loop (/cycle_stats),
+the raw publishing (/pdo_raw), the decoding (/pdo_in_slave_0) and the command intake (/pdo_listener_batch).
+
+Meant for the simulated master, with the loopback of the outputs to the inputs (launch/simulated.launch):
+a command written to the outputs of slave 0 comes back in its inputs, so the time from its publishing to
+its appearance in /pdo_raw is the round trip of a command through the node.
+
+Usage:
+    roslaunch ether_ros simulated.launch
+    rosrun ether_ros pipeline_benchmark.py [duration_s] [command_rate_hz]
+'''
+from __future__ import print_function
+import struct
+import sys
+import time
+
+import rospy
+from ether_ros.srv import EthercatCommd
+from ether_ros.msg import PDORaw, PDOIn, CycleStats, ModifyPDOVariablesBatch, PDOOutEntry
+
+# the int32 desired_x_value of the laelaps_leg layout: bytes 2..5 of the outputs (and of the inputs, looped back)
+COMMAND_OFFSET = 2
+PDO_INT32 = 6
+
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+class PipelineBenchmark(object):
+    def __init__(self, command_rate):
+        self.raw_count = 0
+        self.raw_gaps = 0
+        self.last_cycle = None
+        self.pdo_in_count = 0
+        self.stats = None
+        self.pending = {}
+        self.round_trips = []
+        self.value = 0
+        self.command_pub = rospy.Publisher('pdo_listener_batch', ModifyPDOVariablesBatch, queue_size=100)
+        rospy.Subscriber('pdo_raw', PDORaw, self.raw_callback, queue_size=1000)
+        rospy.Subscriber('pdo_in_slave_0', PDOIn, self.pdo_in_callback, queue_size=1000)
+        rospy.Subscriber('cycle_stats', CycleStats, self.stats_callback, queue_size=10)
+        self.command_period = 1.0 / command_rate
+
+    def raw_callback(self, raw):
+        now = time.time()
+        self.raw_count += 1
+        if self.last_cycle is not None and raw.cycle != self.last_cycle + 1:
+            self.raw_gaps += 1
+        self.last_cycle = raw.cycle
+        data = bytearray(raw.pdo_in_raw)
+        if len(data) >= COMMAND_OFFSET + 4:
+            value = struct.unpack_from('<i', bytes(data), COMMAND_OFFSET)[0]
+            sent = self.pending.pop(value, None)
+            if sent is not None:
+                self.round_trips.append(now - sent)
+
+    def pdo_in_callback(self, pdo_in):
+        self.pdo_in_count += 1
+
+    def stats_callback(self, stats):
+        self.stats = stats
+
+    def send_command(self):
+        self.value += 1
+        entry = PDOOutEntry(slave_id=0, offset=COMMAND_OFFSET, bit=0, type=PDO_INT32, value=self.value)
+        self.pending[self.value] = time.time()
+        self.command_pub.publish(ModifyPDOVariablesBatch(entries=[entry], target_cycle=0, based_on_cycle=0))
+
+    def run(self, duration):
+        start = time.time()
+        next_command = start
+        while not rospy.is_shutdown() and time.time() - start < duration:
+            if time.time() >= next_command:
+                self.send_command()
+                next_command += self.command_period
+            time.sleep(min(0.001, self.command_period))
+        elapsed = time.time() - start
+        self.report(elapsed)
+
+    def report(self, elapsed):
+        us = [t * 1e6 for t in self.round_trips]
+        print('duration            %8.1f s' % elapsed)
+        print('pdo_raw             %8.1f msg/s, %d gaps in the cycles' % (self.raw_count / elapsed, self.raw_gaps))
+        print('pdo_in_slave_0      %8.1f msg/s' % (self.pdo_in_count / elapsed))
+        print('command round trip  p50 %8.1f us, p99 %8.1f us, max %8.1f us (%d of %d commands seen)' %
+              (percentile(us, 50), percentile(us, 99), max(us) if us else float('nan'), len(us), self.value))
+        if self.stats:
+            for name in ('wakeup_latency', 'period', 'exec', 'command_latency'):
+                s = getattr(self.stats, name)
+                print('%-19s p50 %8.1f us, p99 %8.1f us, max %8.1f us' % (name, s.p50 / 1e3, s.p99 / 1e3, s.max / 1e3))
+            print('overruns            %8d' % self.stats.overruns)
+
+
+if __name__ == '__main__':
+    duration = float(sys.argv[1]) if len(sys.argv) > 1 else 10.0
+    command_rate = float(sys.argv[2]) if len(sys.argv) > 2 else 100.0
+    rospy.init_node('pipeline_benchmark', anonymous=True)
+    rospy.wait_for_service('ethercat_communicatord')
+    communicatord = rospy.ServiceProxy('ethercat_communicatord', EthercatCommd)
+    if communicatord('thread').success != 'true':
+        communicatord('start')
+    benchmark = PipelineBenchmark(command_rate)
+    rospy.sleep(1.0) # the connections of the topics
+    benchmark.run(duration)
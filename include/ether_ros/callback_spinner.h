@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file callback_spinner.h
+   \brief Header file for the CallbackSpinner class.
+*/
+
+/*****************************************************************************/
+
+#ifndef CALLBACK_SPINNER_LIB_H
+#define CALLBACK_SPINNER_LIB_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include "ros/ros.h"
+#include "ros/callback_queue.h"
+
+/** \class CallbackSpinner
+    \brief A ROS callback queue, with its own (non realtime) spinner threads.
+
+    The subscribers, the timers and the services created through \a node_handle() are called
+    only from the threads of this spinner, so a burst of callbacks of one path (e.g. the telemetry)
+    doesn't delay the callbacks of another (e.g. the output commands).
+    The threads are pinned to the CPUs of \a /ethercat_slaves/callbacks/{name}/cpus, which never
+    include the CPU of the realtime thread (\a /ethercat_slaves/realtime/cpu).
+    The CPUs of the telemetry spinner are also the ones of the PDORawRingConsumer threads.
+*/
+class CallbackSpinner
+{
+  private:
+    std::string name_;
+    ros::CallbackQueue queue_;
+    ros::NodeHandle node_handle_;
+    std::vector<pthread_t> threads_;
+    cpu_set_t cpuset_;
+    int threads_count_;
+    static void *run(void *arg);
+
+  public:
+    /** \fn void init(ros::NodeHandle &n, const std::string &name, int default_threads)
+    \brief Initialization Method.
+
+    Fetches the \a threads and \a cpus parameters of the spinner. Without \a cpus, the threads
+    may run on every CPU but the realtime one.
+    \param n The ROS Node Handle
+    \param name The name of the spinner, which is also the name of its parameters.
+    \param default_threads The number of threads, when it's not declared.
+*/
+    /** \fn ros::NodeHandle &node_handle()
+    \brief The node handle whose callbacks are served by this spinner.
+*/
+    /** \fn void start()
+    \brief Starts the spinner threads. They run until the node is shut down.
+*/
+    /** \fn void join()
+    \brief Waits for the spinner threads to finish, after the node is shut down.
+*/
+    /** \fn const cpu_set_t &cpuset()
+    \brief The CPUs of the spinner threads, set at \a init().
+*/
+    void init(ros::NodeHandle &n, const std::string &name, int default_threads);
+    ros::NodeHandle &node_handle();
+    void start();
+    void join();
+    const cpu_set_t &cpuset() const;
+};
+
+#endif /* CALLBACK_SPINNER_LIB_H */
@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file controller_manager.h
+   \brief Header file for the ControllerManager class.
+*/
+
+/*****************************************************************************/
+
+#ifndef CONTROLLER_MANAGER_LIB_H
+#define CONTROLLER_MANAGER_LIB_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "ros/ros.h"
+#include "rt_controller.h"
+
+/** \struct rt_controller_slot
+    \brief A controller declared in \a /ethercat_slaves/controllers, with its schedule and its statistics.
+    \var rt_controller_slot::divider
+    \brief The controller runs in the cycles where cycle % divider == phase.
+    \var rt_controller_slot::budget_ns
+    \brief The longest run of the controller, or 0 for a tenth of \a PERIOD_NS.
+    \var rt_controller_slot::disable_on_overrun
+    \brief Whether a run longer than the budget disables the controller.
+    \var rt_controller_slot::ran
+    \brief The controller has run at least once: its held outputs are valid (realtime only).
+*/
+typedef struct rt_controller_slot
+{
+    std::string name;
+    std::string type;
+    RTController *controller;
+    RTControllerIO io;
+    int divider;
+    int phase;
+    int64_t budget_ns;
+    bool disable_on_overrun;
+    bool ran;
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> runs;
+    std::atomic<uint64_t> overruns;
+    std::atomic<uint64_t> violations;
+    std::atomic<uint64_t> last_exec_ns;
+    std::atomic<uint64_t> max_exec_ns;
+} rt_controller_slot;
+
+/** \class ControllerManager
+    \brief Runs the controllers of \a /ethercat_slaves/controllers on the realtime thread.
+
+    Every cycle, after the output image (and the shared memory clients) have been copied to the
+    domain, the controllers due in the cycle run on its inputs, one after the other, in the declared
+    order; then the held outputs of every controller are written over the domain, so a controller
+    with a divider keeps its outputs between its runs. The runs feed the output watchdog of the
+    slaves of the controller. Only the safe outputs (stopping, faults, reconfiguration) override them.
+
+    A controller which exceeds its budget (with \a disable_on_overrun), or breaks the realtime
+    rules (ETHER_ROS_RT_CHECKS builds), is disabled: its variables are driven by the output image again.
+    The statistics are read by the HealthMonitor, which reports them to \a /diagnostics.
+*/
+class ControllerManager
+{
+  private:
+    std::vector<rt_controller_slot *> slots_;
+    uint8_t *outputs_; // the held outputs of all the controllers, at the offsets of the process image
+    void load(ros::NodeHandle &n, XmlRpc::XmlRpcValue &entry, size_t index);
+    void apply_outputs(const rt_controller_slot *slot, uint8_t *domain_pd);
+
+  public:
+    /** \fn void init(ros::NodeHandle &n, XmlRpc::XmlRpcValue &params)
+    \brief Initialization Method.
+
+    Creates and initializes the controllers of the list \a controllers of the fetched \a /ethercat_slaves
+    tree (\a params): every entry has a \a name, a registered \a type, and optionally a \a divider (1),
+    a \a phase (0), a \a budget_ns (0: a tenth of the period) and \a disable_on_overrun (true); the whole
+    entry is given to the controller. Must be called after the \a slave_offsets are known. Exits, if it
+    isn't valid.
+*/
+    /** \fn bool update(uint64_t cycle, uint64_t time_ns, uint8_t *domain_pd)
+    \brief Realtime side: runs the controllers due in \a cycle, on the inputs of \a domain_pd, and writes their outputs to it.
+
+    \retval true if a controller was disabled: the copy of the output image must be a full one.
+*/
+    /** \fn bool enabled()
+    \brief Whether any controller is declared.
+*/
+    /** \fn size_t size()
+    \brief The number of declared controllers.
+*/
+    /** \fn const rt_controller_slot &slot(size_t index)
+    \brief The controller \a index, for reading its statistics.
+*/
+    ControllerManager();
+    void init(ros::NodeHandle &n, XmlRpc::XmlRpcValue &params);
+    bool update(uint64_t cycle, uint64_t time_ns, uint8_t *domain_pd);
+    bool enabled() const;
+    size_t size() const;
+    const rt_controller_slot &slot(size_t index) const;
+};
+
+#endif /* CONTROLLER_MANAGER_LIB_H */
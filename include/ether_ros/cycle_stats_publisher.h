@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file cycle_stats_publisher.h
+   \brief Header file for the CycleStatsPublisher class.
+*/
+
+/*****************************************************************************/
+
+#ifndef CYCLE_STATS_PUB_LIB_H
+#define CYCLE_STATS_PUB_LIB_H
+
+#include "ros/ros.h"
+#include "ether_ros/CycleStats.h"
+#include "ether_ros/LatencyStats.h"
+#include "latency_histogram.h"
+
+/** \class CycleStatsPublisher
+    \brief The timing statistics Publisher class.
+
+    Used for publishing to the \a /cycle_stats topic the percentiles and the maximum of the wakeup
+    latency, the period and the execution time of the EtherCAT Communicator, and the state of the
+    DC servo, at a low rate.
+    The histograms are recorded by the realtime thread; this class only reads them.
+*/
+class CycleStatsPublisher
+{
+  private:
+    ros::Publisher cycle_stats_pub_;
+    ros::Timer cycle_stats_timer_;
+    histogram_snapshot snapshot_;
+    ros::NodeHandle n_;
+    bool startup_reported_;
+    void fill_latency_stats(const LatencyHistogram &histogram, ether_ros::LatencyStats &stats);
+
+    /** \fn void init(ros::NodeHandle &n)
+    \brief Initialization Method.
+
+    Advertises the \a /cycle_stats topic and starts a timer, at the \a /ethercat_slaves/cycle_stats_rate
+    (Hz, default 1).
+    \param n The ROS Node Handle
+*/
+    /** \fn void timer_callback(const ros::TimerEvent &event)
+    \brief Timer Callback
+
+    Takes a snapshot of every histogram and publishes its percentiles. Until the first cycle,
+    also logs the phases of the startup reached since the previous call. \see startup_report
+    \param event The fired timer event.
+*/
+  public:
+    void init(ros::NodeHandle &n);
+    void timer_callback(const ros::TimerEvent &event);
+};
+
+#endif /* CYCLE_STATS_PUB_LIB_H */
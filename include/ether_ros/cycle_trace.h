@@ -0,0 +1,90 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file cycle_trace.h
+   \brief Trace markers of the phases of the realtime cycle.
+
+   Built only with the ETHER_ROS_TRACE CMake option (-DETHER_ROS_TRACE=ON); without it, every
+   CYCLE_TRACE compiles to nothing. With it, every CYCLE_TRACE writes a line
+   \a "ether_ros <phase> <cycle>" to the ftrace \a trace_marker, which shows next to the
+   scheduler and the network events of trace-cmd and kernelshark (see scripts/trace-cmd/trace_phases.sh).
+   A phase lasts until the next marker. If the trace_marker can't be opened, the markers are
+   skipped at the cost of a single branch.
+*/
+
+/*****************************************************************************/
+
+#ifndef CYCLE_TRACE_LIB_H
+#define CYCLE_TRACE_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ETHER_ROS_TRACE
+
+namespace cycle_trace
+{
+/** \var int trace_fd
+    \brief The file descriptor of the trace_marker, or -1.
+*/
+extern int trace_fd;
+/** \fn void init()
+    \brief Opens the trace_marker of tracefs (or of debugfs, on the older kernels).
+*/
+void init();
+/** \fn void mark(const char *prefix, size_t prefix_size, uint64_t cycle)
+    \brief Writes the \a prefix and the \a cycle to the trace_marker, with a single write().
+*/
+void mark(const char *prefix, size_t prefix_size, uint64_t cycle);
+} // namespace cycle_trace
+
+#define CYCLE_TRACE_INIT() cycle_trace::init()
+#define CYCLE_TRACE(phase, cycle)                                                                   \
+    do                                                                                             \
+    {                                                                                              \
+        if (cycle_trace::trace_fd >= 0)                                                            \
+            cycle_trace::mark("ether_ros " phase " ", sizeof("ether_ros " phase " ") - 1, cycle); \
+    } while (0)
+
+#else
+
+#define CYCLE_TRACE_INIT() \
+    do                     \
+    {                      \
+    } while (0)
+#define CYCLE_TRACE(phase, cycle) \
+    do                            \
+    {                             \
+    } while (0)
+
+#endif /* ETHER_ROS_TRACE */
+
+#endif /* CYCLE_TRACE_LIB_H */
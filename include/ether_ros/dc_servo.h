@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file dc_servo.h
+   \brief Header file for the DCServo class.
+*/
+
+/*****************************************************************************/
+
+#ifndef DC_SERVO_LIB_H
+#define DC_SERVO_LIB_H
+
+#include <stdint.h>
+#include <atomic>
+#include "ros/ros.h"
+#include "latency_histogram.h"
+
+/** \enum dc_sync_mode
+    \brief The synchronization mode of the distributed clocks.
+*/
+typedef enum dc_sync_mode
+{
+    DC_REF_TO_MASTER = 0, /**< the reference clock follows the master (application) time */
+    DC_MASTER_TO_REF      /**< the master (application) time follows the reference clock */
+} dc_sync_mode;
+
+/** \class DCServo
+    \brief The PI servo of the distributed clocks.
+
+    In the \a DC_MASTER_TO_REF mode, \a update() gets the difference between the application time and the
+    reference clock, every cycle, and returns the correction to be added to the system time base:
+    - the proportional term pulls in the phase
+    - the integral term estimates (and cancels) the drift between the clocks
+    Both the integral and the output are clamped to \a max_adjust_ns (anti-windup).
+
+    In the \a DC_REF_TO_MASTER mode, the master writes the reference clock, so there's nothing to servo;
+    \a observe() gets the maximum deviation of the slave clocks, reported by the sync monitor.
+
+    In both modes, the servo is locked after \a lock_cycles consecutive cycles within \a lock_threshold_ns.
+    The telemetry is written by the EtherCAT Communicator only, and can be read by any thread.
+
+    The parameters are fetched from \a /ethercat_slaves/dc.
+*/
+class DCServo
+{
+  private:
+    dc_sync_mode mode_;
+    double kp_;
+    double ki_;
+    int64_t max_adjust_ns_;
+    int32_t lock_threshold_ns_;
+    int lock_cycles_;
+
+    bool started_;
+    double integral_ns_;
+    int cycles_in_threshold_;
+
+    std::atomic<int32_t> diff_ns_;
+    std::atomic<int64_t> adjust_ns_;
+    std::atomic<bool> locked_;
+    std::atomic<uint64_t> lock_losses_;
+    LatencyHistogram diff_histogram_;
+
+    void record(int32_t diff_ns);
+
+  public:
+    DCServo();
+    /** \fn void init(ros::NodeHandle &n)
+    \brief Fetches the mode and the gains from the \a /ethercat_slaves/dc parameters.
+*/
+    void init(ros::NodeHandle &n);
+    /** \fn int64_t update(int32_t diff_ns, int32_t period_ns)
+    \brief Runs a step of the servo, with the raw difference \a diff_ns (application time - reference clock).
+
+    \retval The correction (ns) to be added to the system time base. 0 until the first non zero difference.
+*/
+    int64_t update(int32_t diff_ns, int32_t period_ns);
+    /** \fn void observe(uint32_t deviation_ns)
+    \brief Records the deviation of the slave clocks, without any correction.
+*/
+    void observe(uint32_t deviation_ns);
+    /** \fn int32_t normalize(int32_t diff_ns, int32_t period_ns)
+    \brief Wraps \a diff_ns to [-period_ns / 2, period_ns / 2).
+*/
+    static int32_t normalize(int32_t diff_ns, int32_t period_ns);
+
+    dc_sync_mode mode() const;
+    bool started() const;
+    int32_t diff_ns() const;
+    int64_t adjust_ns() const;
+    bool locked() const;
+    uint64_t lock_losses() const;
+    /** \fn const LatencyHistogram &diff_histogram()
+    \brief The histogram of the absolute (normalized) differences.
+*/
+    const LatencyHistogram &diff_histogram() const;
+};
+
+#endif /* DC_SERVO_LIB_H */
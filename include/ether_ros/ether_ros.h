@@ -36,32 +36,39 @@
 /*****************************************************************************/
 /** \var uint8_t *domain1_pd
     \brief Global buffer for the actual communication with the IgH Master Module.
+
+    The process image: the data of every domain, one after the other. \see EthercatDomain
 */
 /** \var uint8_t *process_data_buf
-    \brief Global buffer for safe concurrent accesses from the output PDOs services and the EtherCAT Communicator. \see ethercat_comm
+    \brief Global buffer for the writers of the output PDOs, accessed only between output_image.begin_write() and output_image.commit(). \see output_image
 */
 /** \var size_t total_process_data
     \brief Total number of process data (PD) (bytes).
 */
-/** \var size_t num_process_data_in
-    \brief Number of input PD per slave (bytes).
+/** \var size_t total_pdo_in
+    \brief Number of input PD of all the slaves (bytes).
+
+    The size of the \a pdo_in_raw of the /pdo_raw topic.
+*/
+/** \var size_t total_pdo_out
+    \brief Number of output PD of all the slaves (bytes).
 
-    Assumes that the EtherCAT application is the same for every slave.
+    The size of the \a pdo_out_raw of the /pdo_raw topic.
 */
-/** \var size_t num_process_data_out
-    \brief Number of output PD per slave (bytes).
+/** \var int slaves_count
+    \brief Number of the configured slaves (the \a ethercat_slaves).
 
-    Assumes that the EtherCAT application is the same for every slave.
+    The slaves of the bus beyond them aren't used.
 */
-/** \var int log_fd
-    \brief File descriptor used for logging, provided that LOGGING and one of LOGGING_SAMPLING or LOGGING_NO_SAMPLING is enabled.
+/** \var slave_pd_offsets *slave_offsets
+    \brief The offsets and the sizes of the PD of every slave, in a contiguous table.
 
-    Could be deprecated in a next version (see kernelshark).
+    Used by every loop over the PDOs of the slaves, instead of the \a ethercat_slaves.
 */
-/** \var ec_master_t *master
-    \brief The main master struct.
+/** \var EthercatMaster *ethercat_master
+    \brief The master backend.
 
-    Used for communication with the IgH Master Module.
+    Used for communication with the IgH Master Module (IghMaster), or with a simulated bus (SimulatedMaster).
 */
 /** \var ec_master_state_t master_state
     \brief The master state struct.
@@ -73,25 +80,25 @@
 
     Used to know the slaves responding to the Master.
 */
-/** \var ec_domain_t *domain1
-    \brief The main domain struct variable.
+/** \var EthercatDomain *ethercat_domains
+    \brief The domains, as declared in \a /ethercat_slaves/domains.
 
-    Used to send and receive the datagrams.
+    Used to send and receive the datagrams, every domain at its own rate, and to examine
+    their working counters. \see ethercat_comm
 */
-/** \var ec_domain_state_t domain1_state
-    \brief The domain state struct.
-
-    Used to examine the current state (Working counter, DL states) of the domain. \see ethercat_comm
+/** \var int domains_count
+    \brief The number of \a ethercat_domains.
 */
 /** \var slave_struct *ethercat_slaves
     \brief The main slave struct.
 
     Used by our program to contain all the useful info of every slave.
 */
-/** \var pthread_spinlock_t lock
-    \brief The shared spinlock.
+/** \var OutputImage output_image
+    \brief The staging area of the output PDOs.
 
-    Used by every thread whick modifies the process_data_buf. \see process_data_buf
+    Used by every thread which modifies the process_data_buf, and by the EtherCAT Communicator
+    to pick up the latest committed image, without locking. \see process_data_buf
 */
 /** \var EthercatCommunicator ethercat_comm
     \brief The barebone object of our application.
@@ -100,7 +107,7 @@
     Doesn't change the output PDOs. Basic state machine:
     -  Receive the new PDOs in domain1_pd from the IgH Master Module (and then to EtherCAT slaves)
     - Move to the domain_pd the output data of process_data_buf, safely
-    - Publish the "raw" data (not linked to EtherCAT variables) in PDOs from the domain1_pd
+    - Write the "raw" data (not linked to EtherCAT variables) in PDOs from the domain1_pd to the pdo_raw_ring
     - Send the new PDOs from domain1_pd to the IgH Master Module (and then to EtherCAT slaves)
 */
 <<<<<<< HEAD:include/ighm_ros/ighm_ros.h
@@ -117,13 +124,49 @@
 
     Maps indeces to variables.
 */
-/** \var int FREQUENCY /**<
+/** \var PDORawRing pdo_raw_ring
+    \brief The in-process ring of domain snapshots.
+
+    Written once per cycle by the EtherCAT Communicator and read by the publishers, every one at its own rate.
+*/
+/** \var PDORawPublisher pdo_raw_publisher
+    \brief Main object for publishing to the /pdo_raw topic the "raw" data of the domain.
+
+    Serializes the snapshots of the pdo_raw_ring, outside of the realtime thread.
+*/
+/** \var PDORecorder pdo_recorder
+    \brief The (optional) binary recorder of the domain snapshots of every cycle.
+*/
+/** \var CycleStatsPublisher cycle_stats_publisher
+    \brief Main object for publishing to the /cycle_stats topic the timing statistics of the EtherCAT Communicator.
+*/
+/** \var CallbackSpinner command_spinner
+    \brief The callback queue and threads of the output commands (\a /pdo_listener, \a /pdo_listener_batch).
+*/
+/** \var CallbackSpinner telemetry_spinner
+    \brief The callback queue and threads of the telemetry timers (\a /pdo_out_timer, \a /cycle_stats).
+*/
+/** \var HealthMonitor health_monitor
+    \brief The monitor of the working counters, the link and the AL states, publishing \a /diagnostics.
+*/
+/** \var OutputWatchdog output_watchdog
+    \brief The per slave watchdog of the output commands, falling back to the safe outputs of the slaves without commands.
+*/
+/** \var ControllerManager controller_manager
+    \brief The controllers run on the realtime thread, declared in \a /ethercat_slaves/controllers.
+*/
+/** \var SharedMemoryMirror shared_memory_mirror
+    \brief The (optional) mirror of the domain in POSIX shared memory, for the clients of the same host.
+*/
+/** \var std::atomic<int> FREQUENCY /**<
     \brief Frequency of the realtime thread: EtherCAT Communicator.
+
+    Changed at runtime, along with \a PERIOD_NS, by the \a period mode of \a ethercat_communicatord.
 */
 /** \var int RUN_TIME
     \brief Total run time of the realtime thread: EtherCAT Communicator.
 */
-/** \var int PERIOD_NS
+/** \var std::atomic<int> PERIOD_NS
     \brief Handy variable induced from the Frequency variable. \see FREQUENCY
 */
 /** \def CLOCK_TO_USE CLOCK_MONOTONIC
@@ -132,13 +175,6 @@
     The CLOCK_MONOTONIC is the best for
     realtime purposes.
 */
-/** \def SAMPLING_FREQ 10
-    \brief The sampling frequency.
-
-    Used when the \a LOGGING_SAMPLING is defined.
-    It's used as a frequency for sampling measurements.
-    The number is in Hz.
-*/
 /** \def NSEC_PER_SEC (1000000000L)
     \brief Nanoseconds per second.
 
@@ -162,16 +198,38 @@
     \brief Macro that returns the nanoseconds from the timespec struct.
 
 */
-/** \typedef struct slave_struct slave_struct
+/** \typedef struct slave_pd_offsets
+{
+    uint32_t pdo_out;
+    uint32_t pdo_out_size;
+    uint32_t pdo_in;
+    uint32_t pdo_in_size;
+    uint32_t raw_out;
+    uint32_t raw_in;
+} slave_pd_offsets;
+
+typedef struct slave_struct slave_struct
     \brief A shorthand definition of slave_struct
 
+*/
+/** \struct slave_pd_offsets
+    \brief Where the PD of a slave are.
+    \var slave_pd_offsets::pdo_out
+    \brief The offset of the output PDOs in the process image (domain1_pd).
+    \var slave_pd_offsets::pdo_in
+    \brief The offset of the input PDOs in the process image (domain1_pd).
+    \var slave_pd_offsets::raw_out
+    \brief The offset of the output PDOs in the \a pdo_out_raw of the /pdo_raw topic.
+    \var slave_pd_offsets::raw_in
+    \brief The offset of the input PDOs in the \a pdo_in_raw of the /pdo_raw topic.
+
 */
 /** \struct slave_struct
     \brief The basic slave struct.
     \var slave_struct::slave_name
-    \brief The slave's name (for convienience, the names are the positions of the legs)
+    \brief The slave's name, as declared in ethercat_slaves.yaml
     \var slave_struct::id
-    \brief The slave's id (in a four legged robot, that will be from 0 to 3)
+    \brief The slave's id (its index in the bus order of the configured slaves)
     \var slave_struct::slave
     \brief The EthercatSlave object, used to store every other useful information.
 
@@ -192,8 +250,11 @@
 // #include <time.h>
 #include <sys/mman.h>
 #include <stddef.h>
+#include <atomic>
 #include "ecrt.h"
+#include "ethercat_master.h"
 #include "ethercat_slave.h"
+#include "ethercat_domain.h"
 #include "ethercat_communicator.h"
 <<<<<<< HEAD:include/ighm_ros/ighm_ros.h
 #include "ethercat_input_data_handler.h"
@@ -203,15 +264,21 @@
 #include "pdo_out_publisher.h"
 #include "pdo_out_listener.h"
 #include "pdo_out_publisher_timer.h"
+#include "pdo_raw_ring.h"
+#include "output_image.h"
+#include "shared_memory_mirror.h"
+#include "pdo_raw_publisher.h"
+#include "pdo_recorder.h"
+#include "cycle_stats_publisher.h"
+#include "health_monitor.h"
+#include "output_watchdog.h"
+#include "controller_manager.h"
+#include "callback_spinner.h"
 >>>>>>> devel:include/ether_ros/ether_ros.h
 
 // Application parameters
 #define CLOCK_TO_USE CLOCK_MONOTONIC
-// #define LOGGING_SAMPLING
 // #define RUN_TIME 60 // run time in seconds
-#if defined(LOGGING) && defined(LOGGING_SAMPLING)
-#define SAMPLING_FREQ 10
-#endif
 /****************************************************************************/
 
 #define NSEC_PER_SEC (1000000000L)
@@ -241,6 +308,16 @@
 
 /****************************************************************************/
 
+typedef struct slave_pd_offsets
+{
+    uint32_t pdo_out;
+    uint32_t pdo_out_size;
+    uint32_t pdo_in;
+    uint32_t pdo_in_size;
+    uint32_t raw_out;
+    uint32_t raw_in;
+} slave_pd_offsets;
+
 typedef struct slave_struct
 {
     std::string slave_name;
@@ -249,27 +326,35 @@ typedef struct slave_struct
 } slave_struct;
 
 extern slave_struct * ethercat_slaves;
+extern int slaves_count;
+extern slave_pd_offsets *slave_offsets;
 extern uint8_t *domain1_pd;
 extern uint8_t * process_data_buf;
 extern size_t total_process_data;
-extern size_t num_process_data_in;
-extern size_t num_process_data_out;
-extern int log_fd;
-extern ec_master_t *master;
+extern size_t total_pdo_in;
+extern size_t total_pdo_out;
+extern EthercatMaster *ethercat_master;
 extern ec_master_state_t master_state;
 extern ec_master_info_t master_info;
-extern ec_domain_t *domain1;
-extern ec_domain_state_t domain1_state;
-extern pthread_spinlock_t lock;
+extern EthercatDomain *ethercat_domains;
+extern int domains_count;
+extern OutputImage output_image;
 extern EthercatCommunicator ethercat_comm;
 extern PDOInPublisher pdo_in_publisher;
 extern PDOOutPublisher pdo_out_publisher;
 extern PDOOutListener pdo_out_listener;
 extern PDOOutPublisherTimer pdo_out_publisher_timer;
-extern int PERIOD_NS;
-extern int FREQUENCY;
+extern PDORawRing pdo_raw_ring;
+extern PDORawPublisher pdo_raw_publisher;
+extern PDORecorder pdo_recorder;
+extern SharedMemoryMirror shared_memory_mirror;
+extern CycleStatsPublisher cycle_stats_publisher;
+extern HealthMonitor health_monitor;
+extern OutputWatchdog output_watchdog;
+extern ControllerManager controller_manager;
+extern CallbackSpinner command_spinner;
+extern CallbackSpinner telemetry_spinner;
+extern std::atomic<int> PERIOD_NS;
+extern std::atomic<int> FREQUENCY;
 extern int RUN_TIME;
-#ifdef LOGGING
-extern statistics_struct stat_struct;
-#endif
 #endif /* ether_ros_LIB_H */
@@ -41,6 +41,9 @@
 #include <pthread.h>
 #include "ros/ros.h"
 #include <sched.h>
+#include <atomic>
+#include "latency_histogram.h"
+#include "dc_servo.h"
 /** \class EthercatCommunicator
     \brief The Ethercat Communicator class.
 
@@ -48,51 +51,83 @@
     from our application to the Ethercat slaves, via IgH Master module.
     The class uses the POSIX API for gaining realtime attributes.
 */
-#define DC_FILTER_CNT 1024
 #if !defined(SYNC_MASTER_TO_REF) && !defined(SYNC_REF_TO_MASTER)
 
-#define SYNC_REF_TO_MASTER //the default synchronization will be ref to master
+#define SYNC_REF_TO_MASTER //the default dc/mode will be ref to master
 
 #endif
+/** \enum overrun_policy
+    \brief What the realtime loop does, when a cycle overruns the next wakeup.
+*/
+typedef enum overrun_policy
+{
+  OVERRUN_SKIP = 0,     /**< skip the missed cycles and re-phase to the cycle grid */
+  OVERRUN_CATCH_UP,     /**< run the missed cycles back to back (at most max_catch_up_cycles of them) */
+  OVERRUN_SAFE_OUTPUTS  /**< skip the missed cycles and send the safe outputs, until the fault is reset */
+} overrun_policy;
+
+/** \enum deadline_calibration
+    \brief The state of the measurement of the execution time, for switching to SCHED_DEADLINE.
+*/
+typedef enum deadline_calibration
+{
+  CALIBRATION_NONE = 0,      /**< no calibration: SCHED_FIFO, or a configured runtime */
+  CALIBRATION_RUNNING,       /**< measuring, in SCHED_FIFO */
+  CALIBRATION_DONE,          /**< switched to SCHED_DEADLINE, with the derived runtime */
+  CALIBRATION_OVER_DEADLINE, /**< the derived runtime exceeds the deadline: staying in SCHED_FIFO */
+  CALIBRATION_FAILED         /**< sched_setattr() failed: staying in SCHED_FIFO */
+} deadline_calibration;
+
 #if !defined(FIFO_SCHEDULING) && !defined(DEADLINE_SCHEDULING)
 
 #define FIFO_SCHEDULING //the default scheduling policy will be FIFO
 
 #endif
-#ifdef LOGGING
-#ifdef LOGGING_SAMPLING
+/** \def DC_START_LEAD_NS
+    \brief When the period changes, the SYNC0 of the slaves restarts at least this later (as the IgH Master starts it).
+*/
+#define DC_START_LEAD_NS 100000000LL
 
-typedef struct statistics_struct
+/** \struct realtime_config
+    \brief The scheduling attributes of the realtime thread, fetched from \a /ethercat_slaves/realtime.
+    \var realtime_config::cpu
+    \brief The CPU the thread is pinned to, or -1 for no affinity.
+    \var realtime_config::priority
+    \brief The SCHED_FIFO priority.
+    \var realtime_config::policy
+    \brief SCHED_FIFO or SCHED_DEADLINE.
+    \var realtime_config::runtime_ns
+    \brief The SCHED_DEADLINE runtime, or 0 for deriving it from the measured execution time.
+    \var realtime_config::deadline_ns
+    \brief The SCHED_DEADLINE relative deadline, or 0 for the period.
+    \var realtime_config::calibration_cycles
+    \brief The number of cycles (run in SCHED_FIFO) for measuring the execution time, when \a runtime_ns is 0.
+    \var realtime_config::runtime_margin
+    \brief The derived runtime is the maximum measured execution time, multiplied by this margin.
+    \var realtime_config::overrun_policy
+    \brief The overrun_policy of the loop.
+    \var realtime_config::max_catch_up_cycles
+    \brief With OVERRUN_CATCH_UP, the cycles beyond this number are skipped.
+    \var realtime_config::stop_safe_cycles
+    \brief The cycles run with the safe outputs (\see OutputWatchdog) when the thread stops, before it exits.
+    \var realtime_config::stop_timeout_ms
+    \brief How long stop() waits for the thread to exit by itself, before canceling it.
+*/
+typedef struct realtime_config
 {
-  int statistics_id;
-  uint32_t period_ns;
-  uint32_t exec_ns;
-  uint32_t latency_ns;
-  uint32_t * latency_min_ns;
-  uint32_t * latency_max_ns;
-  uint32_t * period_min_ns;
-  uint32_t * period_max_ns;
-  uint32_t * exec_min_ns;
-  uint32_t * exec_max_ns;
-  struct timespec start_time;
-  struct timespec end_time;
-  struct timespec last_start_time;
-} statistics_struct;
-#endif
-#ifdef LOGGING_NO_SAMPLING
+  int cpu;
+  int priority;
+  int policy;
+  uint64_t runtime_ns;
+  uint64_t deadline_ns;
+  int calibration_cycles;
+  double runtime_margin;
+  int overrun_policy;
+  int max_catch_up_cycles;
+  int stop_safe_cycles;
+  int stop_timeout_ms;
+} realtime_config;
 
-typedef struct statistics_struct
-{
-  int statistics_id;
-  uint32_t * period_ns;
-  uint32_t * exec_ns;
-  uint32_t * latency_ns;
-  struct timespec start_time;
-  struct timespec end_time;
-  struct timespec last_start_time;
-} statistics_struct;
-#endif
-#endif
 class EthercatCommunicator
 {
 private:
@@ -102,33 +137,48 @@ private:
   //cleanup_pop_arg_ is used only for future references. No actual usage in our application.
   //Serves as an argument to the cleanup_handler.
   static pthread_t communicator_thread_;
-  static ros::Publisher pdo_raw_pub_;
-  static bool running_thread_;
+  static std::atomic<bool> running_thread_;
+  static std::atomic<bool> stop_requested_;
+  static bool joinable_thread_;
+  static bool master_activated_;
   static uint64_t dc_start_time_ns_;
-  static uint64_t dc_time_ns_;
+  static std::atomic<uint64_t> dc_time_ns_;
   static int64_t system_time_base_;
+  static realtime_config rt_config_;
+  static LatencyHistogram wakeup_latency_histogram_;
+  static LatencyHistogram period_histogram_;
+  static LatencyHistogram exec_histogram_;
 
-#ifdef SYNC_MASTER_TO_REF
-  static uint8_t dc_started_;
   static int32_t dc_diff_ns_;
-  static int32_t prev_dc_diff_ns_;
-  static int64_t dc_diff_total_ns_;
-  static int64_t dc_delta_total_ns_;
-  static int dc_filter_idx_;
-  static int64_t dc_adjust_ns_;
-#endif
+  static DCServo dc_servo_;
+  static std::atomic<uint64_t> system_time_errors_;
+  static std::atomic<uint64_t> overruns_;
+  static std::atomic<uint64_t> missed_cycles_;
+  static std::atomic<bool> overrun_fault_;
+  static std::atomic<uint64_t> cycle_;
+  static std::atomic<bool> reconfiguring_;
+  static std::atomic<uint64_t> run_start_time_ns_;
+  static uint64_t run_first_cycle_;
+  static std::atomic<int> calibration_state_;
+  static std::atomic<uint64_t> calibration_exec_ns_;
+  static std::atomic<uint64_t> calibration_runtime_ns_;
+  static std::atomic<int> calibration_errno_;
+  static std::atomic<bool> run_time_expired_;
   static void *run(void *arg);
+  static void load_realtime_config(ros::NodeHandle &n);
+  static int set_deadline_scheduling(uint64_t runtime_ns);
   static void cleanup_handler(void *arg);
+  static void activate_master();
   static void copy_data_to_domain_buf();
-  static void publish_raw_data();
+  static void publish_raw_data(uint64_t cycle, uint64_t timestamp_ns);
   static void sync_distributed_clocks(void);
   static void update_master_clock(void);
+  static void process_sync_monitor(void);
+  static void handle_overrun(struct timespec *wakeup_time, int64_t late_ns);
   static uint64_t system_time_ns(void);
-#ifdef LOGGING
-  static void create_new_statistics_sample(statistics_struct *ss, unsigned int * sampling_counter);
-  static void create_statistics(statistics_struct * ss, struct timespec * wakeup_time_p);
-  static void log_statistics_to_file(statistics_struct *ss);
-#endif
+  static uint64_t sync0_start_time_ns(int divider, int phase, int32_t sync0_shift);
+  static bool restart_sync0();
+  void stop_thread(bool clear_outputs);
 public:
 /** \fn static bool has_running_thread()
     \brief A getter for knowing if there is a running thread.
@@ -140,6 +190,8 @@ public:
     \brief Initializes the main thread.
 
     Mostly makes ready the attributes of the realtime thread, before running.
+    The CPU affinity, the priority and the scheduling policy are fetched from the
+    \a /ethercat_slaves/realtime parameters, and are applied at \a start().
     \param n The ROS Node Handle
 
 */
@@ -147,11 +199,17 @@ public:
     \brief Starts the main thread.
 
     The function that actually starts the realtime thread. The realtime attributes have been set from \a init.
+    With the SCHED_DEADLINE policy and no configured runtime, the thread runs in SCHED_FIFO for the
+    calibration cycles, and then switches itself to SCHED_DEADLINE, with a runtime derived from the
+    measured execution time.
+    The master is activated only at the first start: a restart only re-phases the cycles
+    to the time of the new start.
     Implements the basic realtime communication (Tx/Rx) with the EtherCAT slaves.
     Doesn't change the output PDOs. Basic state machine:
     -  Receive the new PDOs in domain1_pd from the IgH Master Module (and therefore from the EtherCAT slaves)
     - Move to the domain_pd the output data of process_data_buf, safely
-    - Publish the "raw" data (not linked to EtherCAT variables) in PDOs received from the domain1_pd, to the /ethercat_data_raw topic
+    - Run the realtime controllers on the new inputs, and write their outputs to the domain1_pd (\see ControllerManager)
+    - Write the "raw" data (not linked to EtherCAT variables) in PDOs received from the domain1_pd, to the pdo_raw_ring
     - Synchronize the DC of every slave (every \a count'nth cycle)
     - Send the new PDOs from domain1_pd to the IgH Master Module (and then to EtherCAT slaves)
     \see void init(ros::NodeHandle &n)
@@ -160,13 +218,78 @@ public:
 /** \fn void stop()
     \brief Stops the main thread.
 
-    This function stops the execution of the realtime thread. The mechanism for stopping it,
-    is provided by the POSIX API. Search for \a pthread_testcancel() and other related functions.
+    This function stops the execution of the realtime thread, cooperatively: the thread checks a
+    stop flag once per cycle, runs \a realtime/stop_safe_cycles more cycles with the safe outputs and
+    exits. If it hasn't exited after \a realtime/stop_timeout_ms, it's canceled.
+    The thread also stops by itself, the same way, when the \a RUN_TIME expires.
+    The scheduled commands are discarded and the output image is cleared (zeros), so a new start
+    doesn't drive the slaves with the commands of the previous run.
+
+*/
+/** \fn static const LatencyHistogram &wakeup_latency_histogram()
+    \brief The histogram of the time from the programmed wakeup to the actual wakeup of the realtime thread.
+*/
+/** \fn static const LatencyHistogram &period_histogram()
+    \brief The histogram of the time between two consecutive wakeups.
+*/
+/** \fn static const LatencyHistogram &exec_histogram()
+    \brief The histogram of the time from the wakeup to the end of the cycle.
+*/
+/** \fn static const DCServo &dc_servo()
+    \brief The servo of the distributed clocks, for reading its telemetry.
+*/
+/** \fn static uint64_t system_time_errors()
+    \brief The number of times the system time base was found greater than the system time.
+*/
+/** \fn static uint64_t overruns()
+    \brief The number of cycles which ended after the next wakeup (deadline misses).
+*/
+/** \fn static uint64_t missed_cycles()
+    \brief The number of cycle slots that passed while overrunning (skipped or caught up).
+*/
+/** \fn static bool overrun_fault()
+    \brief With the OVERRUN_SAFE_OUTPUTS policy, true after an overrun, until reset_overrun_fault().
+*/
+/** \fn static uint64_t current_cycle()
+    \brief The id of the cycle in progress (or of the next one, between the cycles).
+
+    The ids start from 1 and count the executed cycles, across restarts. They tag the raw data
+    (\a pdo_raw topic, shared memory) and are the time base of the scheduled output commands. \see OutputImage
+*/
+/** \fn static int deadline_calibration(uint64_t *max_exec_ns, uint64_t *runtime_ns, int *err)
+    \brief The deadline_calibration state, with the measured execution time, the derived runtime and the errno of sched_setattr().
+
+    The realtime thread only records them: they are logged by the HealthMonitor.
+*/
+/** \fn bool change_period(int period_ns, int32_t sync0_shift)
+    \brief Changes the cycle period and the SYNC0 shift of all the slaves, without restarting the node.
 
+    Before the activation of the master, only the configuration of the slaves is changed. Afterwards,
+    the realtime thread must be running: it's stopped (as by \a stop(), with the safe outputs) and restarted
+    with the new period, which re-phases the cycles. Unlike \a stop(), the output image is kept: the
+    commanded setpoints and gains apply again after the reconfiguration, without being resent. Then, with the safe outputs, the SYNC0 of every
+    DC slave is turned off, given the new cycle time and turned back on, on the new cycle grid
+    (a start time at least \a DC_START_LEAD_NS ahead, on the cycles of the slave's domain). The outputs are
+    driven again by the output image once every slave has started. If a slave can't be reconfigured,
+    the realtime thread is stopped.
+    \retval false if the period or the shift are invalid, or the reconfiguration failed.
 */
   static bool has_running_thread();
+  static uint64_t current_cycle();
+  static const LatencyHistogram &wakeup_latency_histogram();
+  static const LatencyHistogram &period_histogram();
+  static const LatencyHistogram &exec_histogram();
+  static const DCServo &dc_servo();
+  static uint64_t system_time_errors();
+  static int overrun_policy();
+  static uint64_t overruns();
+  static uint64_t missed_cycles();
+  static bool overrun_fault();
+  static void reset_overrun_fault();
+  static int deadline_calibration(uint64_t *max_exec_ns, uint64_t *runtime_ns, int *err);
   void init(ros::NodeHandle &n);
   void start();
   void stop();
+  bool change_period(int period_ns, int32_t sync0_shift);
 };
 #endif /* ETH_COM_LIB_H */
@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file ethercat_domain.h
+   \brief Header file for the EthercatDomain class.
+*/
+
+/*****************************************************************************/
+
+#ifndef ETH_DOMAIN_LIB_H
+#define ETH_DOMAIN_LIB_H
+
+#include <string>
+#include <atomic>
+#include "ecrt.h"
+#include "ros/ros.h"
+
+/** \class EthercatDomain
+    \brief The Ethercat Domain class.
+
+    A group of slaves, with its own datagrams in the EtherCAT frame, exchanged every
+    \a divider cycles of the EtherCAT Communicator. The slow slaves don't add bytes to the
+    frames of the cycles in between. The domains are declared in \a /ethercat_slaves/domains,
+    and every slave joins one of them, with its \a domain parameter.
+
+    The process data of all the domains are contiguous (the IgH Master maps them one after the other,
+    in the order they are created), so the offsets of the slaves are offsets in a single process image,
+    the \a domain1_pd, whatever their domain is.
+*/
+class EthercatDomain
+{
+  private:
+    std::string name_;
+    int divider_;
+    int phase_;
+    int domain_;
+    size_t offset_;
+    size_t size_;
+    ec_domain_state_t state_;
+    bool queued_;
+    std::atomic<uint64_t> exchanges_;
+    std::atomic<uint64_t> wkc_errors_;
+    std::atomic<unsigned int> working_counter_;
+    std::atomic<int> wc_state_;
+
+  public:
+    /** \fn void init(const std::string &name, int divider, int phase)
+    \brief Initialization Method.
+
+    Creates the domain in the \a ethercat_master. Must be called before the registration of the PDOs.
+    \param name The name of the domain, used by the slaves for joining it.
+    \param divider The domain is exchanged every \a divider cycles.
+    \param phase The domain is exchanged in the cycles where cycle % divider == phase.
+*/
+    /** \fn void set_offset(size_t offset)
+    \brief Fixes the offset of the domain in the process image, after the registration of the PDOs.
+*/
+    /** \fn void activate(uint8_t *process_image)
+    \brief Checks that the data of the activated domain are at its offset of the process image.
+*/
+    /** \fn void process()
+    \brief Realtime side: processes the received datagrams, if the domain was queued in the previous cycle,
+    and monitors its working counter.
+*/
+    /** \fn void queue(uint64_t cycle)
+    \brief Realtime side: queues the datagrams of the domain, if it's exchanged in this \a cycle.
+*/
+    /** \fn uint64_t wkc_errors()
+    \brief The number of exchanges with an incomplete (or zero) working counter.
+*/
+    void init(const std::string &name, int divider, int phase);
+    void set_offset(size_t offset);
+    void activate(uint8_t *process_image);
+    void process();
+    void queue(uint64_t cycle);
+    const std::string &get_name();
+    int get_divider();
+    int get_phase();
+    int get_domain();
+    size_t get_offset();
+    size_t get_size();
+    uint64_t exchanges() const;
+    uint64_t wkc_errors() const;
+    unsigned int working_counter() const;
+    int wc_state() const;
+};
+
+/** \fn void init_ethercat_domains(ros::NodeHandle &n)
+    \brief Creates the \a ethercat_domains, from the \a /ethercat_slaves/domains parameter.
+
+    Without the parameter, there's a single domain, "main", exchanged in every cycle.
+*/
+/** \fn int find_ethercat_domain(const std::string &name)
+    \brief The index of the domain with the \a name in \a ethercat_domains, or -1.
+*/
+void init_ethercat_domains(ros::NodeHandle &n);
+int find_ethercat_domain(const std::string &name);
+
+#endif /* ETH_DOMAIN_LIB_H */
@@ -0,0 +1,125 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file ethercat_master.h
+   \brief Header file for the EthercatMaster interface.
+*/
+
+/*****************************************************************************/
+
+#ifndef ETH_MASTER_LIB_H
+#define ETH_MASTER_LIB_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include "ecrt.h"
+#include "ros/ros.h"
+
+/** \class EthercatMaster
+    \brief The EtherCAT master backend.
+
+    The master and domain calls of the application (the subset of the \a ecrt API that the
+    EthercatCommunicator, the EthercatDomain, the EthercatSlave and the \a utilities use), behind a
+    single interface, so the same code runs against the IgH Master (IghMaster) or without any
+    hardware (SimulatedMaster). The backend is chosen with \a /ethercat_slaves/master/backend.
+
+    The domains and the slave configurations are referred to by the ids returned at their creation,
+    in the order of creation. The methods follow the semantics of the \a ecrt functions they are named after.
+*/
+class EthercatMaster
+{
+  public:
+    virtual ~EthercatMaster() {}
+    /** \fn virtual bool request(int index)
+    \brief Requests the master \a index (ecrt_request_master). \retval false on failure.
+*/
+    virtual bool request(int index) = 0;
+    virtual int info(ec_master_info_t *info) = 0;
+    virtual void state(ec_master_state_t *state) = 0;
+    /** \fn virtual int create_domain()
+    \brief Creates a domain. \retval The id of the domain, or -1 on failure.
+*/
+    virtual int create_domain() = 0;
+    virtual size_t domain_size(int domain) = 0;
+    /** \fn virtual uint8_t *domain_data(int domain)
+    \brief The process data of the domain. Valid after \a activate().
+*/
+    virtual uint8_t *domain_data(int domain) = 0;
+    virtual void domain_process(int domain) = 0;
+    virtual void domain_state(int domain, ec_domain_state_t *state) = 0;
+    virtual void domain_queue(int domain) = 0;
+    /** \fn virtual int slave_config(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code)
+    \brief Configures the slave at (\a alias, \a position). \retval The id of the configuration, or -1 on failure.
+*/
+    virtual int slave_config(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code) = 0;
+    /** \fn virtual int reg_pdo_entry(int slave_config, uint16_t index, uint8_t subindex, int domain)
+    \brief Registers a PDO entry of the slave in the domain. \retval The offset of the entry in the domain, or < 0 on failure.
+*/
+    virtual int reg_pdo_entry(int slave_config, uint16_t index, uint8_t subindex, int domain) = 0;
+    virtual void config_dc(int slave_config, uint16_t assign_activate, uint32_t sync0_cycle, int32_t sync0_shift) = 0;
+    /** \fn virtual int create_reg_request(int slave_config, size_t size)
+    \brief Creates a register request of up to \a size bytes for the slave. Must be called before \a activate().
+    \retval The id of the request, or -1 on failure.
+*/
+    virtual int create_reg_request(int slave_config, size_t size) = 0;
+    /** \fn virtual void reg_request_write(int request, uint16_t address, const uint8_t *data, size_t size)
+    \brief Schedules the write of \a size bytes of \a data to the register \a address of the slave.
+
+    The write is carried out by the master, with the frames of the next cycles. \see reg_request_state
+*/
+    virtual void reg_request_write(int request, uint16_t address, const uint8_t *data, size_t size) = 0;
+    virtual ec_request_state_t reg_request_state(int request) = 0;
+    /** \fn virtual void slave_config_state(int slave_config, ec_slave_config_state_t *state)
+    \brief The state of the slave (ecrt_slave_config_state). Called from the non realtime threads.
+*/
+    virtual void slave_config_state(int slave_config, ec_slave_config_state_t *state) = 0;
+    virtual int select_reference_clock(int slave_config) = 0;
+    virtual int activate() = 0;
+    virtual void receive() = 0;
+    virtual void send() = 0;
+    virtual void application_time(uint64_t time_ns) = 0;
+    virtual int reference_clock_time(uint32_t *time) = 0;
+    virtual void sync_reference_clock() = 0;
+    virtual void sync_slave_clocks() = 0;
+    virtual void sync_monitor_queue() = 0;
+    virtual uint32_t sync_monitor_process() = 0;
+};
+
+/** \fn EthercatMaster *create_ethercat_master(ros::NodeHandle &n)
+    \brief Creates the backend of \a /ethercat_slaves/master/backend (\a igh, the default, or \a sim) and requests
+    the master \a /ethercat_slaves/master/index from it.
+
+    Exits, if the backend is unknown or the master can't be requested.
+*/
+EthercatMaster *create_ethercat_master(ros::NodeHandle &n);
+
+#endif /* ETH_MASTER_LIB_H */
@@ -39,8 +39,10 @@
 #define ETH_SLAVE_LIB_H
 
 #include <string>
+#include <vector>
 #include "ecrt.h"
 #include "ros/ros.h"
+#include "pdo_schema.h"
 
 /** \class EthercatSlave
     \brief The Ethercat Slave class.
@@ -59,17 +61,23 @@ class EthercatSlave
     int alias_;
     int input_port_;
     int output_port_;
-    ec_slave_config_t *ethercat_slave_; //pointer to the basic slave struct in ighm
+    int ethercat_slave_; //id of the slave configuration in the ethercat_master
     int pdo_in_;
     int pdo_out_;
+    int domain_;
     int32_t sync0_shift_;
+    int dc_request_; //id of the register request of the DC registers, or -1 without DC
+    PDOLayout pdo_in_layout_;
+    PDOLayout pdo_out_layout_;
+    bool write_register(uint16_t address, const uint8_t *data, size_t size);
 
   public:
-    /** \fn void init(std::string slave, ros::NodeHandle& n)
+    /** \fn void init(std::string slave, XmlRpc::XmlRpcValue &params, XmlRpc::XmlRpcValue &layouts)
     \brief Initialization Method.
 
     Used for initializing the EthercatSlave entity. It's basically
-    the main method in the class.
+    the main method in the class. The configuration is read from the already fetched
+    \a /ethercat_slaves (\a params) and \a /pdo_layouts (\a layouts) trees: exits if it isn't valid.
 */
     /** \fn int get_pdo_out()
     \brief Getter Method.
@@ -81,10 +89,96 @@ class EthercatSlave
 
     Used for getting the number of bytes of the input PDO of the single slave.
 */
-    void init(std::string slave, ros::NodeHandle &n);
+    /** \fn void relocate(int domain_offset)
+    \brief Moves the offsets of the PDOs, from the domain of the slave to the process image.
+
+    \param domain_offset The offset of the slave's domain in the process image.
+*/
+    /** \fn int get_domain()
+    \brief Getter Method.
+
+    Used for getting the index of the slave's domain in \a ethercat_domains.
+*/
+    /** \fn const PDOLayout &get_pdo_in_layout()
+    \brief Getter Method.
+
+    Used for getting the layout of the input PDO variables, as declared in \a /pdo_layouts.
+*/
+    /** \fn const PDOLayout &get_pdo_out_layout()
+    \brief Getter Method.
+
+    Used for getting the layout of the output PDO variables, as declared in \a /pdo_layouts.
+*/
+    /** \fn void configure_dc(int32_t sync0_shift)
+    \brief Configures the SYNC0 of the slave: the exchange period of its domain (\a PERIOD_NS times its divider), and \a sync0_shift.
+
+    Used before the activation of the master. After it, the configuration is only kept for the
+    next time the master configures the slave: the running slave is reconfigured with \a stop_dc() and \a start_dc().
+*/
+    /** \fn bool stop_dc()
+    \brief Turns off the SYNC0 of the running slave, and writes its new cycle time.
+
+    Blocks until the registers are written, by the frames of the realtime thread, which must be running.
+    \retval false if a write failed, or took more than \a DC_REQUEST_TIMEOUT_MS.
+*/
+    /** \fn bool start_dc(uint64_t start_time_ns)
+    \brief Turns the SYNC0 of the running slave back on, with its first pulse at \a start_time_ns (in system time). \see stop_dc()
+*/
+    /** \fn bool has_dc()
+    \brief Whether the slave has its SYNC signals configured (a non zero \a assign_activate).
+*/
+    void init(std::string slave, XmlRpc::XmlRpcValue &params, XmlRpc::XmlRpcValue &layouts);
+    void configure_dc(int32_t sync0_shift);
+    bool stop_dc();
+    bool start_dc(uint64_t start_time_ns);
+    bool has_dc();
+    int32_t get_sync0_shift();
+    void relocate(int domain_offset);
+    int get_domain();
     int get_pdo_out();
     int get_pdo_in();
-    ec_slave_config_t *get_slave_config();
+    int get_slave_config();
+    const PDOLayout &get_pdo_in_layout();
+    const PDOLayout &get_pdo_out_layout();
 };
 
+/** \def PARAMETERS_TIMEOUT_MS
+    \brief How long the node waits for the parameter server to have the \a /ethercat_slaves tree.
+*/
+/** \def PARAMETERS_BACKOFF_MIN_MS
+    \brief The first wait between two fetches of a missing parameter; it's doubled after every fetch.
+*/
+/** \def PARAMETERS_BACKOFF_MAX_MS
+    \brief The longest wait between two fetches of a missing parameter.
+*/
+/** \def DC_REQUEST_TIMEOUT_MS
+    \brief How long a write of the DC registers of a running slave may take.
+*/
+#define PARAMETERS_TIMEOUT_MS 30000
+#define PARAMETERS_BACKOFF_MIN_MS 10
+#define PARAMETERS_BACKOFF_MAX_MS 1000
+#define DC_REQUEST_TIMEOUT_MS 500
+
+/** \fn bool fetch_parameters(ros::NodeHandle &n, const std::string &name, XmlRpc::XmlRpcValue &value, int timeout_ms)
+    \brief Fetches the whole parameter tree \a name in a single round trip, retrying with a backoff for up to \a timeout_ms.
+
+    \retval false if it's still missing after \a timeout_ms (0: a single try).
+*/
+/** \fn std::vector<std::string> find_configured_slaves(XmlRpc::XmlRpcValue &params)
+    \brief The names of the slaves declared in the \a /ethercat_slaves tree \a params (every map with a \a position), in the order of the bus.
+*/
+/** \fn std::vector<std::string> find_configured_slaves(ros::NodeHandle &n)
+    \brief The same, fetching the \a /ethercat_slaves tree first. Exits if it's missing.
+*/
+/** \fn void init_slave_offsets()
+    \brief Builds the \a slave_offsets table, after the offsets of the slaves are relocated to the process image.
+
+    The output PDOs of a slave end where its input PDOs begin, and its input PDOs end where the next
+    PDOs of its domain begin (or with the domain).
+*/
+bool fetch_parameters(ros::NodeHandle &n, const std::string &name, XmlRpc::XmlRpcValue &value, int timeout_ms);
+std::vector<std::string> find_configured_slaves(XmlRpc::XmlRpcValue &params);
+std::vector<std::string> find_configured_slaves(ros::NodeHandle &n);
+void init_slave_offsets();
+
 #endif /* ETH_SLAVE_LIB_H */
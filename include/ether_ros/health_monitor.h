@@ -0,0 +1,136 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file health_monitor.h
+   \brief Header file for the HealthMonitor class.
+*/
+
+/*****************************************************************************/
+
+#ifndef HEALTH_MONITOR_LIB_H
+#define HEALTH_MONITOR_LIB_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include "ecrt.h"
+#include "ros/ros.h"
+#include "diagnostic_msgs/DiagnosticArray.h"
+
+/** \class HealthMonitor
+    \brief The monitor of the working counters, the link and the AL states of the bus.
+
+    The realtime thread only records the raw state of the master (\a record_master_state()) and of the
+    domains (EthercatDomain::process()) into atomics, with counters of the changes between two samples,
+    so a link flap or a dropped working counter isn't missed. This class reads them from a (non realtime)
+    timer, logs the changes, samples the AL state of every slave and publishes them to \a /diagnostics
+    (diagnostic_msgs/DiagnosticArray): a status for the master, one per domain and one per slave, with
+    the error rates of the last period, and one per realtime controller. \see ControllerManager
+*/
+class HealthMonitor
+{
+  private:
+    typedef struct slave_health
+    {
+        ec_slave_config_state_t state;
+        uint64_t state_changes;
+        uint64_t samples;
+        uint64_t errors;
+    } slave_health;
+    typedef struct domain_health
+    {
+        uint64_t exchanges;
+        uint64_t wkc_errors;
+        double error_rate;
+    } domain_health;
+    // written by the realtime thread only
+    ec_master_state_t rt_master_state_;
+    bool rt_recorded_;
+    std::atomic<unsigned int> slaves_responding_;
+    std::atomic<unsigned int> al_states_;
+    std::atomic<bool> link_up_;
+    std::atomic<uint64_t> link_downs_;
+    std::atomic<uint64_t> al_state_changes_;
+    // the timer only
+    ros::Publisher diagnostics_pub_;
+    ros::Timer health_timer_;
+    double wkc_error_rate_warn_;
+    unsigned int slaves_responding_seen_;
+    unsigned int al_states_seen_;
+    bool link_up_seen_;
+    uint64_t link_downs_seen_;
+    uint64_t al_state_changes_seen_;
+    int calibration_seen_;
+    std::vector<domain_health> domains_;
+    std::vector<slave_health> slaves_;
+    std::vector<bool> controllers_enabled_seen_;
+    void check_master(diagnostic_msgs::DiagnosticArray &diagnostics);
+    void check_calibration();
+    void check_domains(diagnostic_msgs::DiagnosticArray &diagnostics);
+    void check_slaves(diagnostic_msgs::DiagnosticArray &diagnostics);
+    void check_controllers(diagnostic_msgs::DiagnosticArray &diagnostics);
+
+  public:
+    /** \fn void init(ros::NodeHandle &n)
+    \brief Initialization Method.
+
+    Advertises the \a /diagnostics topic and starts a timer at \a /ethercat_slaves/health/rate (Hz, default 1).
+    A domain is reported with a warning, when the rate of its exchanges with an incomplete working counter,
+    since the last period, exceeds \a /ethercat_slaves/health/wkc_error_rate_warn (default 0.001).
+    \param n The ROS Node Handle
+*/
+    /** \fn void record_master_state(const ec_master_state_t &state)
+    \brief Realtime side: records the state of the master, and counts the link downs and the changes of the AL states.
+
+    Neither locks nor logs.
+*/
+    /** \fn void timer_callback(const ros::TimerEvent &event)
+    \brief Timer Callback
+
+    Logs the changes since the previous call and publishes the diagnostics.
+    \param event The fired timer event.
+*/
+    /** \fn uint64_t link_downs()
+    \brief The number of times the link was found down, after being up.
+*/
+    /** \fn uint64_t al_state_changes()
+    \brief The number of changes of the AL states of the slaves, as seen by the master.
+*/
+    HealthMonitor();
+    void init(ros::NodeHandle &n);
+    void record_master_state(const ec_master_state_t &state);
+    void timer_callback(const ros::TimerEvent &event);
+    uint64_t link_downs() const;
+    uint64_t al_state_changes() const;
+};
+
+#endif /* HEALTH_MONITOR_LIB_H */
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file igh_master.h
+   \brief Header file for the IghMaster class.
+*/
+
+/*****************************************************************************/
+
+#ifndef IGH_MASTER_LIB_H
+#define IGH_MASTER_LIB_H
+
+#include <vector>
+#include "ethercat_master.h"
+
+/** \class IghMaster
+    \brief The EthercatMaster backend of the IgH Master Module.
+
+    Forwards every call to the \a ecrt library, with the domains and the slave configurations
+    kept in tables, indexed by their ids.
+*/
+class IghMaster : public EthercatMaster
+{
+  private:
+    ec_master_t *master_;
+    std::vector<ec_domain_t *> domains_;
+    std::vector<ec_slave_config_t *> slave_configs_;
+    std::vector<ec_reg_request_t *> reg_requests_;
+
+  public:
+    IghMaster();
+    bool request(int index);
+    int info(ec_master_info_t *info);
+    void state(ec_master_state_t *state);
+    int create_domain();
+    size_t domain_size(int domain);
+    uint8_t *domain_data(int domain);
+    void domain_process(int domain);
+    void domain_state(int domain, ec_domain_state_t *state);
+    void domain_queue(int domain);
+    int slave_config(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code);
+    int reg_pdo_entry(int slave_config, uint16_t index, uint8_t subindex, int domain);
+    void config_dc(int slave_config, uint16_t assign_activate, uint32_t sync0_cycle, int32_t sync0_shift);
+    int create_reg_request(int slave_config, size_t size);
+    void reg_request_write(int request, uint16_t address, const uint8_t *data, size_t size);
+    ec_request_state_t reg_request_state(int request);
+    void slave_config_state(int slave_config, ec_slave_config_state_t *state);
+    int select_reference_clock(int slave_config);
+    int activate();
+    void receive();
+    void send();
+    void application_time(uint64_t time_ns);
+    int reference_clock_time(uint32_t *time);
+    void sync_reference_clock();
+    void sync_slave_clocks();
+    void sync_monitor_queue();
+    uint32_t sync_monitor_process();
+};
+
+#endif /* IGH_MASTER_LIB_H */
@@ -0,0 +1,145 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file latency_histogram.h
+   \brief Header file for the LatencyHistogram class.
+*/
+
+/*****************************************************************************/
+
+#ifndef LATENCY_HISTOGRAM_LIB_H
+#define LATENCY_HISTOGRAM_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/** \def HISTOGRAM_SUB_BITS
+    \brief log2 of the linear sub-buckets per power of two.
+
+    With 5 bits, every bucket is at most 1/32 (~3%) of its value wide.
+*/
+#define HISTOGRAM_SUB_BITS 5
+/** \def HISTOGRAM_BUCKETS
+    \brief The number of buckets, for covering the values up to 2^32 ns (~4.3 s).
+*/
+#define HISTOGRAM_BUCKETS ((32 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+/** \struct histogram_snapshot
+    \brief A copy of the histogram, taken by a reader.
+    \var histogram_snapshot::count
+    \brief The number of recorded values.
+    \var histogram_snapshot::sum
+    \brief The sum of the recorded values (ns).
+    \var histogram_snapshot::max
+    \brief The maximum recorded value (ns).
+    \var histogram_snapshot::min
+    \brief The minimum recorded value (ns).
+*/
+typedef struct histogram_snapshot
+{
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t min;
+} histogram_snapshot;
+
+/** \class LatencyHistogram
+    \brief A fixed size, log-linear (HDR style) histogram of durations in nanoseconds.
+
+    The values below 2^HISTOGRAM_SUB_BITS have one bucket each; above that, every power of two
+    is split in 2^HISTOGRAM_SUB_BITS linear buckets. The memory is fixed, whatever the run time.
+    There must be a single writer (the EtherCAT Communicator), which never locks, never allocates
+    and never does an atomic read-modify-write. Any thread can take a snapshot at any time.
+*/
+class LatencyHistogram
+{
+  private:
+    std::atomic<uint64_t> counts_[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> min_;
+
+  public:
+    LatencyHistogram();
+
+    /** \fn void record(uint64_t value_ns)
+    \brief Adds a value to the histogram. Single writer only.
+*/
+    inline void record(uint64_t value_ns)
+    {
+        size_t index = bucket_index(value_ns);
+        counts_[index].store(counts_[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value_ns, std::memory_order_relaxed);
+        if (value_ns > max_.load(std::memory_order_relaxed))
+            max_.store(value_ns, std::memory_order_relaxed);
+        if (value_ns < min_.load(std::memory_order_relaxed))
+            min_.store(value_ns, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** \fn void snapshot(histogram_snapshot *snap)
+    \brief Copies the histogram to \a snap.
+
+    The buckets are copied one by one, while the writer may still be recording, so the
+    snapshot may be (harmlessly) off by the values of the last cycle.
+*/
+    void snapshot(histogram_snapshot *snap) const;
+
+    /** \fn size_t bucket_index(uint64_t value_ns)
+    \brief Returns the bucket of \a value_ns. The values of 2^32 ns or more go to the last bucket.
+*/
+    static inline size_t bucket_index(uint64_t value_ns)
+    {
+        if (value_ns < (1ULL << HISTOGRAM_SUB_BITS))
+            return value_ns;
+        if (value_ns >= (1ULL << 32))
+            return HISTOGRAM_BUCKETS - 1;
+        int shift = (63 - __builtin_clzll(value_ns)) - HISTOGRAM_SUB_BITS;
+        return ((shift + 1) << HISTOGRAM_SUB_BITS) + (value_ns >> shift) - (1 << HISTOGRAM_SUB_BITS);
+    }
+
+    /** \fn uint64_t bucket_upper_bound(size_t index)
+    \brief Returns the highest value of the bucket \a index.
+*/
+    static uint64_t bucket_upper_bound(size_t index);
+
+    /** \fn uint64_t percentile(const histogram_snapshot &snap, double p)
+    \brief Returns the value below (or equal to) which lies the \a p percent of the values of \a snap.
+
+    The result is the upper bound of the bucket, clamped to the maximum value.
+*/
+    static uint64_t percentile(const histogram_snapshot &snap, double p);
+};
+
+#endif /* LATENCY_HISTOGRAM_LIB_H */
@@ -0,0 +1,223 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file output_image.h
+   \brief Header file for the OutputImage class.
+*/
+
+/*****************************************************************************/
+
+#ifndef OUTPUT_IMAGE_LIB_H
+#define OUTPUT_IMAGE_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <atomic>
+#include "triple_buffer.h"
+#include "latency_histogram.h"
+#include "pdo_schema.h"
+#include "output_ranges.h"
+
+/** \def OUTPUT_SCHEDULE_SLOTS
+    \brief The maximum number of scheduled commands, not yet folded into the image.
+*/
+#define OUTPUT_SCHEDULE_SLOTS 16
+/** \def OUTPUT_PATCH_MAX_WRITES
+    \brief The maximum number of writes in a scheduled command.
+*/
+#define OUTPUT_PATCH_MAX_WRITES 1024
+
+/** \struct output_write
+    \brief A single write of a scheduled command: image[offset + i] = (image[offset + i] & ~mask[i]) | (data[i] & mask[i]).
+    \var output_write::offset
+    \brief The offset in the image (the same as in the domain).
+    \var output_write::slave
+    \brief The slave of the write, whose OutputWatchdog is fed when the command is applied.
+*/
+typedef struct output_write
+{
+    uint32_t offset;
+    uint16_t slave;
+    uint8_t size;
+    uint8_t data[8];
+    uint8_t mask[8];
+} output_write;
+
+/** \struct output_patch
+    \brief A scheduled command: the writes to be applied at \a target_cycle.
+*/
+typedef struct output_patch
+{
+    uint64_t target_cycle;
+    uint64_t based_on_cycle;
+    size_t count;
+    output_write *writes;
+} output_patch;
+
+/** \class OutputImage
+    \brief The staging area of the output PDOs.
+
+    The writers (topic listeners, services) modify the \a process_data_buf between
+    \a begin_write() and \a commit(). The commit publishes a whole, consistent copy of the
+    image through a triple buffer, from which the EtherCAT Communicator picks up the latest
+    one with \a latest(). The writers serialize among themselves with a mutex, but the
+    realtime thread never takes it, so a slow writer can't stall the cycle.
+
+    A writer can also \a schedule() a command for a given cycle. The scheduled commands are
+    queued, in order, and the EtherCAT Communicator applies every one of them on top of the image
+    (\a apply_scheduled()), from its target cycle on. The next writer folds the applied commands
+    into the \a process_data_buf, and the realtime thread stops applying them, as soon as it gets an
+    image which contains them. Therefore, a command is applied exactly at its target cycle, and it's
+    never lost nor reverted by the writes which follow it.
+
+    The output regions of the slaves are merged into the minimal number of contiguous ranges, and
+    every commit records which ranges it changed. Therefore, the realtime thread copies (\a copy_to())
+    only the ranges changed since the image it copied last, with one memcpy per range.
+*/
+class OutputImage
+{
+  private:
+    TripleBuffer images_;
+    pthread_mutex_t writer_mutex_;
+    size_t size_;
+    std::vector<utilities::output_range> ranges_;
+    std::atomic<uint64_t> *changed_; // the last commit which changed every range
+    uint8_t *published_;             // the last published image (writer)
+    uint64_t commit_seq_;            // the last commit (writer)
+    uint64_t copied_seq_;            // the commit the realtime buffer is up to date with (realtime)
+    bool force_copy_;                // the realtime buffer was changed outside of the image (realtime)
+    bool fresh_;                     // the latest() image is a new one (realtime)
+    uint64_t current_seq_;           // the commit of the latest() image (realtime)
+
+    output_patch patches_[OUTPUT_SCHEDULE_SLOTS];
+    std::atomic<uint64_t> head_;     // the next command to be scheduled (writer)
+    std::atomic<uint64_t> applied_;  // the commands before it have reached their target cycle (realtime)
+    std::atomic<uint64_t> consumed_; // the commands before it are in the image used by the realtime thread
+    uint64_t folded_;                // the commands before it are in the process_data_buf (writer)
+    uint64_t current_folded_;        // the folded_ of the image used by the realtime thread
+
+    std::atomic<uint64_t> applied_commands_;
+    std::atomic<uint64_t> late_commands_;
+    LatencyHistogram command_latency_histogram_;
+
+    void fold_applied();
+    void publish_image(uint64_t based_on_cycle);
+    void apply_patch(uint8_t *buffer, const output_patch &patch);
+    void record_latency(uint64_t cycle, uint64_t based_on_cycle);
+
+  public:
+    /** \fn void init(size_t size, const utilities::output_range *regions, size_t count)
+    \brief Initialization Method.
+
+    Allocates the \a process_data_buf, the published images and the scheduled commands, all filled with zeros,
+    and merges the output \a regions of the slaves into the copy ranges.
+    \param size The size of the image in bytes (\a total_process_data).
+    \param regions The output PDOs of every slave.
+    \param count The number of \a regions.
+*/
+    /** \fn void begin_write()
+    \brief Writer side: gives exclusive access to the \a process_data_buf.
+
+    Must be followed by \a commit(). Never call it from the realtime thread.
+*/
+    /** \fn void commit(uint64_t based_on_cycle = 0)
+    \brief Writer side: publishes the \a process_data_buf as the latest image and releases it.
+
+    \param based_on_cycle The cycle of the inputs the new outputs were computed from (0 if unknown),
+    for measuring the sense to actuate latency.
+*/
+    /** \fn bool schedule(const output_write *writes, size_t count, uint64_t target_cycle, uint64_t based_on_cycle)
+    \brief Writer side: queues the \a writes, for being applied at the \a target_cycle.
+
+    The commands are applied in the order they were scheduled: a command waits for the ones before it.
+    A \a target_cycle already passed means the next cycle. Waits (shortly) if the queue is full.
+    \retval false if the queue stayed full, or there are too many writes.
+*/
+    /** \fn void discard_scheduled()
+    \brief Drops the commands which haven't reached their target cycle. Only when the realtime thread is stopped.
+*/
+    /** \fn void snapshot(uint8_t *buffer)
+    \brief Copies the \a process_data_buf, as the writers see it, to \a buffer.
+
+    Used by the non realtime readers (e.g. loggers). Never call it from the realtime thread.
+*/
+    /** \fn const uint8_t *latest(uint64_t cycle)
+    \brief Realtime side: returns the latest committed image.
+
+    Wait-free; the image stays valid and unchanged until the next call.
+    Must only be called from the EtherCAT Communicator thread.
+*/
+    /** \fn void copy_to(uint8_t *buffer, uint64_t cycle)
+    \brief Realtime side: brings the outputs of \a buffer up to date with the latest image and the scheduled commands.
+
+    Copies only the ranges changed since the previous call (nothing, when there's no new image), unless
+    \a invalidate() was called. Must only be called from the EtherCAT Communicator thread. Wait-free.
+*/
+    /** \fn void invalidate()
+    \brief Realtime side: the outputs of the \a copy_to() buffer were changed by someone else, the next copy is a full one.
+*/
+    /** \fn size_t ranges_count()
+    \brief The number of the copy ranges (at most one per slave).
+*/
+    /** \fn void apply_scheduled(uint8_t *buffer, uint64_t cycle)
+    \brief Realtime side: applies to \a buffer the scheduled commands due at \a cycle, which aren't in the latest image.
+
+    A command feeds the \a output_watchdog of its slaves when it reaches its target cycle, not when it's scheduled,
+    so a slave commanded far ahead still falls back to its safe outputs meanwhile, and recovers with the command.
+
+    Must be called after \a latest(), from the EtherCAT Communicator thread. Wait-free.
+*/
+    /** \fn static void make_write(output_write *write, int slave, size_t offset, pdo_type type, uint8_t bit, int64_t value)
+    \brief Fills the \a write of the variable of \a type of the \a slave, at \a offset (and \a bit) of the image.
+*/
+    void init(size_t size, const utilities::output_range *regions, size_t count);
+    void begin_write();
+    void commit(uint64_t based_on_cycle = 0);
+    bool schedule(const output_write *writes, size_t count, uint64_t target_cycle, uint64_t based_on_cycle);
+    void discard_scheduled();
+    void snapshot(uint8_t *buffer);
+    const uint8_t *latest(uint64_t cycle);
+    void apply_scheduled(uint8_t *buffer, uint64_t cycle);
+    void copy_to(uint8_t *buffer, uint64_t cycle);
+    void invalidate();
+    size_t ranges_count() const;
+    static void make_write(output_write *write, int slave, size_t offset, pdo_type type, uint8_t bit, int64_t value);
+
+    uint64_t applied_commands() const;
+    uint64_t late_commands() const;
+    /** \fn const LatencyHistogram &command_latency_histogram()
+    \brief The histogram of the time from the cycle of the inputs to the cycle of the outputs of the commands (ns).
+*/
+    const LatencyHistogram &command_latency_histogram() const;
+};
+
+#endif /* OUTPUT_IMAGE_LIB_H */
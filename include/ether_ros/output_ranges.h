@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file output_ranges.h
+   \brief Header-only coalescing of the output PDO regions into bulk copy ranges.
+
+   Includes:
+   - merge_output_ranges() for merging the (adjacent) output regions of the slaves
+   - copy_output_ranges() for copying the ranges changed since a given commit
+
+   Depends neither on ROS, nor on the IgH Master.
+*/
+
+/*****************************************************************************/
+
+#ifndef OUTPUT_RANGES_LIB_H
+#define OUTPUT_RANGES_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace utilities
+{
+
+/** \struct output_range
+    \brief A contiguous region of output PDOs in the process image.
+*/
+typedef struct output_range
+{
+    uint32_t offset;
+    uint32_t size;
+} output_range;
+
+inline bool output_range_before(const output_range &a, const output_range &b)
+{
+    return a.offset < b.offset;
+}
+
+/** \fn void merge_output_ranges(const output_range *regions, size_t count, std::vector<output_range> &ranges)
+    \brief Sorts the output \a regions of the slaves and merges the adjacent (or overlapping) ones.
+
+    The result is the minimal number of bulk copies, that move all the outputs and no inputs.
+*/
+inline void merge_output_ranges(const output_range *regions, size_t count, std::vector<output_range> &ranges)
+{
+    std::vector<output_range> sorted(regions, regions + count);
+
+    std::sort(sorted.begin(), sorted.end(), output_range_before);
+    ranges.clear();
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        if (!sorted[i].size)
+            continue;
+        if (!ranges.empty() && ranges.back().offset + ranges.back().size >= sorted[i].offset)
+        {
+            uint32_t end = std::max(ranges.back().offset + ranges.back().size, sorted[i].offset + sorted[i].size);
+            ranges.back().size = end - ranges.back().offset;
+        }
+        else
+            ranges.push_back(sorted[i]);
+    }
+}
+
+/** \fn void copy_output_ranges(uint8_t *dst, const uint8_t *src, const output_range *ranges, size_t count, const std::atomic<uint64_t> *changed, uint64_t since)
+    \brief Copies from \a src to \a dst the \a ranges changed after the commit \a since.
+
+    \param changed The last commit which changed every range.
+    \param since The commit \a dst is up to date with, or 0 for copying every range.
+*/
+inline void copy_output_ranges(uint8_t *dst, const uint8_t *src, const output_range *ranges, size_t count,
+                               const std::atomic<uint64_t> *changed, uint64_t since)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (since && changed[i].load(std::memory_order_relaxed) <= since)
+            continue; // unchanged: dst has it already
+        memcpy(dst + ranges[i].offset, src + ranges[i].offset, ranges[i].size);
+    }
+}
+
+} // namespace utilities
+
+#endif /* OUTPUT_RANGES_LIB_H */
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file output_watchdog.h
+   \brief Header file for the OutputWatchdog class.
+*/
+
+/*****************************************************************************/
+
+#ifndef OUTPUT_WATCHDOG_LIB_H
+#define OUTPUT_WATCHDOG_LIB_H
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include "ros/ros.h"
+
+/** \class OutputWatchdog
+    \brief The per slave watchdog of the output commands.
+
+    Every command for a slave (the \a pdo_listener, \a pdo_listener_batch and \a pdo_command topics, or the
+    outputs of a shared memory client) \a feed()s its slave. If a slave isn't fed for its timeout, the realtime
+    thread overwrites its outputs with its safe outputs (\a update() and \a apply()), until it's fed again, so a controller
+    which died doesn't leave stale setpoints on the bus. The safe outputs are precomputed at \a init(), in an
+    image of their own: the realtime side only compares timestamps and copies bytes, without locking or allocating.
+
+    The safe outputs are also what the EtherCAT Communicator sends while stopping, after an overrun (safe_outputs
+    policy) and while the period changes. \see utilities::clear_outputs
+*/
+class OutputWatchdog
+{
+  private:
+    uint8_t *safe_image_;                   // the safe outputs, at the offsets of the slaves in the process image
+    std::vector<int64_t> timeouts_ns_;      // 0: the slave is never timed out
+    std::atomic<uint64_t> *fed_ns_;         // the time of the last command of every slave (writers)
+    std::atomic<bool> *expired_;            // the slave gets its safe outputs (realtime)
+    std::atomic<uint64_t> *expirations_;    // the times the slave was timed out (realtime)
+    void load_safe_outputs(int slave, XmlRpc::XmlRpcValue &safe_outputs);
+
+  public:
+    /** \fn void init(XmlRpc::XmlRpcValue &params)
+    \brief Initialization Method.
+
+    Reads from the fetched \a /ethercat_slaves tree the timeout of every slave (\a output_watchdog/timeout_ms,
+    or \a <slave>/output_timeout_ms for a single slave; 0, the default, disables the watchdog) and its
+    safe outputs (\a <slave>/safe_outputs, a map from the variables of its \a pdo_out layout to their values;
+    the rest of the bytes are zeros). Must be called after the \a slave_offsets are known. Exits, if they aren't valid.
+*/
+    /** \fn void feed(int slave)
+    \brief Writer side: a command for \a slave (or for all of them, with 255) was received. Wait-free.
+*/
+    /** \fn void feed(int slave, uint64_t now_ns)
+    \brief A command for \a slave was applied at \a now_ns (CLOCK_TO_USE), e.g. a scheduled one, from the realtime thread. Wait-free.
+*/
+    /** \fn bool update(uint64_t now_ns)
+    \brief Realtime side: times out the slaves not fed since \a now_ns (CLOCK_TO_USE) minus their timeout.
+
+    Called once per cycle, before the copy of the output image.
+    \retval true if a timed out slave was fed again: the copy of the output image must be a full one.
+*/
+    /** \fn void apply(uint8_t *buffer)
+    \brief Realtime side: writes the safe outputs of the timed out slaves to \a buffer (normally the domain1_pd).
+
+    Called once per cycle, after every other write of the outputs.
+*/
+    /** \fn void write_safe_outputs(uint8_t *buffer)
+    \brief Writes the safe outputs of every slave to \a buffer (the \a domain1_pd or the \a process_data_buf).
+*/
+    /** \fn bool expired(int slave)
+    \brief Whether the slave is timed out, and gets its safe outputs.
+*/
+    OutputWatchdog();
+    void init(XmlRpc::XmlRpcValue &params);
+    void feed(int slave);
+    void feed(int slave, uint64_t now_ns);
+    bool update(uint64_t now_ns);
+    void apply(uint8_t *buffer);
+    void write_safe_outputs(uint8_t *buffer);
+    bool expired(int slave) const;
+    uint64_t expirations(int slave) const;
+    int64_t timeout_ns(int slave) const;
+};
+
+#endif /* OUTPUT_WATCHDOG_LIB_H */
@@ -0,0 +1,179 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_accessors.h
+   \brief Header-only typed accessors of the PDO variables.
+
+   Includes:
+   - pdo_read<T>() / pdo_write<T>() for the (little endian) integer variables
+   - pdo_read_bit() / pdo_write_bit() for the bit variables
+   - pdo_read_column<T>() for decoding the same variable of many slaves at once
+
+   The accessors are inline and use memcpy, so that every read or write compiles to a
+   single (unaligned) load or store, plus a byte swap on big endian hosts only.
+   They depend neither on ROS, nor on the IgH Master.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_ACCESSORS_LIB_H
+#define PDO_ACCESSORS_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <endian.h>
+
+namespace utilities
+{
+
+/** \struct pdo_endian
+    \brief Converts a value of \a N bytes between the EtherCAT (little endian) and the host byte order.
+*/
+template <typename T, size_t N = sizeof(T)>
+struct pdo_endian;
+
+template <typename T>
+struct pdo_endian<T, 1>
+{
+    static inline T convert(T value) { return value; }
+};
+
+template <typename T>
+struct pdo_endian<T, 2>
+{
+    static inline T convert(T value)
+    {
+        uint16_t raw;
+        memcpy(&raw, &value, sizeof(raw));
+        raw = le16toh(raw);
+        memcpy(&value, &raw, sizeof(raw));
+        return value;
+    }
+};
+
+template <typename T>
+struct pdo_endian<T, 4>
+{
+    static inline T convert(T value)
+    {
+        uint32_t raw;
+        memcpy(&raw, &value, sizeof(raw));
+        raw = le32toh(raw);
+        memcpy(&value, &raw, sizeof(raw));
+        return value;
+    }
+};
+
+template <typename T>
+struct pdo_endian<T, 8>
+{
+    static inline T convert(T value)
+    {
+        uint64_t raw;
+        memcpy(&raw, &value, sizeof(raw));
+        raw = le64toh(raw);
+        memcpy(&value, &raw, sizeof(raw));
+        return value;
+    }
+};
+
+/** \fn T pdo_read(const uint8_t *data_ptr, size_t offset)
+    \brief Returns the variable of type \a T at \a offset bytes of the \a data_ptr buffer.
+*/
+template <typename T>
+inline T pdo_read(const uint8_t *data_ptr, size_t offset)
+{
+    T value;
+    memcpy(&value, data_ptr + offset, sizeof(T));
+    return pdo_endian<T>::convert(value);
+}
+
+/** \fn void pdo_write(uint8_t *data_ptr, size_t offset, T value)
+    \brief Writes the variable of type \a T at \a offset bytes of the \a data_ptr buffer.
+*/
+template <typename T>
+inline void pdo_write(uint8_t *data_ptr, size_t offset, T value)
+{
+    value = pdo_endian<T>::convert(value);
+    memcpy(data_ptr + offset, &value, sizeof(T));
+}
+
+/** \fn bool pdo_read_bit(const uint8_t *data_ptr, size_t offset, uint8_t bit)
+    \brief Returns the \a bit of the byte at \a offset of the \a data_ptr buffer.
+*/
+inline bool pdo_read_bit(const uint8_t *data_ptr, size_t offset, uint8_t bit)
+{
+    return (data_ptr[offset] >> bit) & 0x01;
+}
+
+/** \fn void pdo_write_bit(uint8_t *data_ptr, size_t offset, uint8_t bit, bool value)
+    \brief Sets the \a bit of the byte at \a offset of the \a data_ptr buffer to \a value.
+*/
+inline void pdo_write_bit(uint8_t *data_ptr, size_t offset, uint8_t bit, bool value)
+{
+    data_ptr[offset] = (data_ptr[offset] & ~(1 << bit)) | ((value ? 1 : 0) << bit);
+}
+
+/** \fn void pdo_read_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, size_t offset, O *column)
+    \brief Bulk decode: reads the variable of type \a T at \a offset, of every slave, into \a column.
+
+    \a slave_offsets holds the start of every slave's PDO in the \a frame. The loop has no
+    branches and no type dispatch, so that the compiler can unroll and vectorize it.
+    \param frame The domain (or a snapshot of it)
+    \param slave_offsets The offsets of the PDOs of the slaves in the \a frame
+    \param slaves Number of slaves
+    \param offset The offset of the variable, from the start of a slave's PDO
+    \param column The output array of \a slaves values
+*/
+template <typename T, typename O>
+inline void pdo_read_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, size_t offset, O *column)
+{
+    for (size_t i = 0; i < slaves; i++)
+    {
+        column[i] = (O)pdo_read<T>(frame, slave_offsets[i] + offset);
+    }
+}
+
+/** \fn void pdo_read_bit_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, size_t offset, uint8_t bit, O *column)
+    \brief Bulk decode of a bit variable. \see pdo_read_column
+*/
+template <typename O>
+inline void pdo_read_bit_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, size_t offset, uint8_t bit, O *column)
+{
+    for (size_t i = 0; i < slaves; i++)
+    {
+        column[i] = (O)pdo_read_bit(frame, slave_offsets[i] + offset, bit);
+    }
+}
+
+} // namespace utilities
+#endif /* PDO_ACCESSORS_LIB_H */
@@ -0,0 +1,94 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_bindings.h
+   \brief The bindings of the PDO variables to the fields of the PDOIn and PDOOut messages.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_BINDINGS_LIB_H
+#define PDO_BINDINGS_LIB_H
+
+#include <vector>
+#include "pdo_schema.h"
+#include "ether_ros/PDOIn.h"
+#include "ether_ros/PDOOut.h"
+#include "ether_ros/PDOInAll.h"
+#include "ether_ros/PDOOutAll.h"
+
+/** \var const pdo_binding<ether_ros::PDOIn> pdo_in_bindings[]
+    \brief The fields of the PDOIn message, that the input PDO variables can be published to.
+*/
+/** \var const pdo_binding<ether_ros::PDOOut> pdo_out_bindings[]
+    \brief The fields of the PDOOut message, that the output PDO variables can be published to.
+*/
+/** \fn void init_pdo_in_decoders(std::vector<PDODecoder<ether_ros::PDOIn> > &decoders)
+    \brief Compiles the pdo_in layouts of all the slaves into \a decoders (one per slave).
+
+    Exits if a layout doesn't fit in the input PDO of its slave.
+*/
+/** \fn void init_pdo_out_decoders(std::vector<PDODecoder<ether_ros::PDOOut> > &decoders)
+    \brief Compiles the pdo_out layouts of all the slaves into \a decoders (one per slave).
+
+    Exits if a layout doesn't fit in the output PDO of its slave.
+*/
+/** \var const pdo_column_binding<ether_ros::PDOInAll> pdo_in_all_bindings[]
+    \brief The array fields of the PDOInAll message, with the input PDO variables of all the slaves.
+*/
+/** \var const pdo_column_binding<ether_ros::PDOOutAll> pdo_out_all_bindings[]
+    \brief The array fields of the PDOOutAll message, with the output PDO variables of all the slaves.
+*/
+/** \fn void init_pdo_in_all_decoder(PDOColumnDecoder<ether_ros::PDOInAll> &decoder)
+    \brief Compiles the pdo_in layouts of all the slaves into a single \a decoder, for the aggregated message.
+
+    Exits if a layout doesn't fit in the input PDO of its slave.
+*/
+/** \fn void init_pdo_out_all_decoder(PDOColumnDecoder<ether_ros::PDOOutAll> &decoder)
+    \brief Compiles the pdo_out layouts of all the slaves into a single \a decoder, for the aggregated message.
+
+    Exits if a layout doesn't fit in the output PDO of its slave.
+*/
+extern const pdo_binding<ether_ros::PDOIn> pdo_in_bindings[];
+extern const size_t pdo_in_bindings_count;
+extern const pdo_binding<ether_ros::PDOOut> pdo_out_bindings[];
+extern const size_t pdo_out_bindings_count;
+extern const pdo_column_binding<ether_ros::PDOInAll> pdo_in_all_bindings[];
+extern const size_t pdo_in_all_bindings_count;
+extern const pdo_column_binding<ether_ros::PDOOutAll> pdo_out_all_bindings[];
+extern const size_t pdo_out_all_bindings_count;
+
+void init_pdo_in_decoders(std::vector<PDODecoder<ether_ros::PDOIn> > &decoders);
+void init_pdo_out_decoders(std::vector<PDODecoder<ether_ros::PDOOut> > &decoders);
+void init_pdo_in_all_decoder(PDOColumnDecoder<ether_ros::PDOInAll> &decoder);
+void init_pdo_out_all_decoder(PDOColumnDecoder<ether_ros::PDOOutAll> &decoder);
+
+#endif /* PDO_BINDINGS_LIB_H */
@@ -38,42 +38,66 @@
 #ifndef PDO_IN_PUB_LIB_H
 #define PDO_IN_PUB_LIB_H
 
+#include <vector>
 #include "ros/ros.h"
-#include "ether_ros/PDORaw.h"
+#include "ether_ros/PDOIn.h"
+#include "ether_ros/PDOInAll.h"
+#include "pdo_raw_ring.h"
+#include "pdo_schema.h"
+#include "publish_throttle.h"
 
 /** \class PDOInPublisher
     \brief The Ethercat Input Data Handler class.
 
     Used for trasforming the "raw" indexed data from
-    the \a /pdo_raw topic, sent by the Ethercat
+    the \a pdo_raw_ring, written by the Ethercat
     Communicator, to values of variables, and stream them
-    to the \a /pdo_in_slave_{slave_id} topic.
+    to the \a /pdo_in_slave_{slave_id} topic, and (with \a publishers/pdo_in/aggregated) of all the
+    slaves in a single PDOInAll message, to the \a /pdo_in_all topic.
 */
-class PDOInPublisher
+class PDOInPublisher : public PDORawRingConsumer
 {
     private:
-      ros::Subscriber pdo_raw_sub_;
       ros::Publisher * pdo_in_pub_;
+      std::vector<PDODecoder<ether_ros::PDOIn> > decoders_;
+      PublishThrottle throttle_;
+      std::vector<bool> subscribed_;
+      std::vector<bool> changed_;
+      bool per_slave_;
+      bool aggregated_;
+      bool aggregated_subscribed_;
+      ros::Publisher pdo_in_all_pub_;
+      ether_ros::PDOInAll pdo_in_all_;
+      PDOColumnDecoder<ether_ros::PDOInAll> all_decoder_;
+      int64_t clock_offset_ns_;
 /** \fn void init(ros::NodeHandle &n)
     \brief Initialization Method.
 
     Used for initializing the PDOInPublisher object. It's basically
-    the main method in the class, which initializes the listener to the afore
-    mentioned topic.
+    the main method in the class, which advertises the afore mentioned topics
+    and starts reading the \a pdo_raw_ring, at the rate of \a /ethercat_slaves/publishers/pdo_in.
+    While no topic has subscribers, the ring is skipped, without copying the snapshots.
     \param n The ROS Node Handle
 */
-/** \fn void pdo_raw_callback(const ether_ros::PDORaw::ConstPtr &pdo_raw)
-    \brief Raw Data Callback
+/** \fn void publish_pdo_in(const pdo_raw_snapshot &snapshot)
+    \brief Raw Data Handler
 
-    This method, is called when there are data in the \a /pdo_raw topic.
-    Should the EtherCAT application change, this callback must change also.
+    This method, is called for every new snapshot of the \a pdo_raw_ring.
     Implements the basic functionality of the class, to transform the "raw" data
-    into variable values and pipe them into another topic.
-    \param pdo_raw A copy of the actual data sent to the topic \a /pdo_raw.
+    into variable values and pipe them into another topic. The variables are decoded
+    with the \a pdo_in layout of every slave (see \a /pdo_layouts). The slaves whose topic has
+    no subscribers are skipped, and with \a on_change, the ones whose input PDOs haven't changed.
+    The aggregated message has every slave, and is published if any of them has changed.
+    The messages are stamped with the wakeup time of the cycle of the snapshot.
+    \param snapshot The snapshot of the domain.
 */
+    protected:
+      int wakeup_period_ns();
+      void consume();
+
     public:
       void init(ros::NodeHandle &n);
-      void pdo_raw_callback(const ether_ros::PDORaw::ConstPtr &pdo_raw);
+      void publish_pdo_in(const pdo_raw_snapshot &snapshot);
 };
 
 #endif /* PDO_IN_PUB_LIB_H */
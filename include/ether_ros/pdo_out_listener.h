@@ -41,7 +41,13 @@
 
 #include "ros/ros.h"
 #include "ether_ros/ModifyPDOVariables.h"
+#include "ether_ros/ModifyPDOVariablesBatch.h"
+#include "ether_ros/PDOCommandBatch.h"
+#include <pthread.h>
 #include <map>
+#include <vector>
+#include "output_image.h"
+#include "pdo_variable_table.h"
 
 /** \class PDOOutListener
     \brief The Ethercat Input Data Handler class.
@@ -55,6 +61,19 @@ class PDOOutListener
 {
   private:
     ros::Subscriber pdo_out_listener_;
+    ros::Subscriber pdo_out_batch_listener_;
+    ros::Subscriber pdo_command_listener_;
+    std::vector<output_write> scheduled_writes_;
+    pthread_mutex_t schedule_mutex_; // the scheduled_writes_ of the concurrent callbacks (callbacks/command/threads > 1)
+    int max_schedule_ahead_cycles_;
+    PDOVariableTable variables_;
+    bool check_entry(const ether_ros::PDOOutEntry &entry, size_t i);
+    bool check_command(const ether_ros::PDOCommand &command, size_t i);
+    bool check_target_cycle(const char *topic, uint64_t target_cycle, uint64_t current_cycle);
+    void schedule_writes(const char *topic, size_t count, uint64_t target_cycle, uint64_t based_on_cycle,
+                         uint64_t current_cycle);
+    void schedule_batch(const ether_ros::ModifyPDOVariablesBatch::ConstPtr &batch);
+    void schedule_commands(const ether_ros::PDOCommandBatch::ConstPtr &batch);
     std::map<std::string, int> int_type_map_ = {
         {"bool", 0},
         {"uint8", 1},
@@ -71,7 +90,8 @@ class PDOOutListener
 
     Used for initializing the PDOInPublisher object. It's basically
     the main method in the class, which initializes the listener to the afore
-    mentioned topic.
+    mentioned topic. Numbers the output PDO variables of the slaves, for the \a /pdo_command topic,
+    and sets their names to \a /ethercat_slaves/pdo_out_variables.
     \param n The ROS Node Handle
 */
     /** \fn void pdo_out_callback(const ether_ros::ModifyPDOVariables::ConstPtr &new_var);
@@ -90,9 +110,30 @@ class PDOOutListener
     Implements the basic functionality of the class, to transform the "raw" data
     into variable values and pipe them into another topic.
     \param pdo_raw A copy of the actual data sent to the topic \a /pdo_raw.
+*/
+    /** \fn void pdo_out_batch_callback(const ether_ros::ModifyPDOVariablesBatch::ConstPtr &batch)
+    \brief Applies every entry of the \a /pdo_listener_batch topic message, in a single commit of the output image.
+
+    The entries are checked first: if any of them is invalid, none is applied. Therefore, all the
+    entries reach the slaves in the same cycle, or not at all. There's no logging per entry.
+    With a \a target_cycle, the entries are scheduled for exactly that cycle (it must be within
+    \a /ethercat_slaves/max_schedule_ahead_cycles of the current one), instead of the next one. \see OutputImage::schedule
+    \param batch The entries (slave, offset, bit, type, value) to write.
+*/
+    /** \fn void pdo_command_callback(const ether_ros::PDOCommandBatch::ConstPtr &batch)
+    \brief Applies every command of the \a /pdo_command topic message, in a single commit of the output image.
+
+    The compact form of \a pdo_out_batch_callback(): a command names the variable by its id (its index
+    in \a /ethercat_slaves/pdo_out_variables), and its offset, bit and type come from the \a pdo_out
+    layout of the slave, resolved once in \a init(). The write is a table lookup and a call of the
+    writer of the type, without any string handling. A broadcast (slave 255) writes the variable
+    of every slave that has it. The same all-or-nothing checks and the same \a target_cycle apply.
+    \param batch The commands (variable, slave, value) to write.
 */
     public : void init(ros::NodeHandle & n);
     void pdo_out_callback(const ether_ros::ModifyPDOVariables::ConstPtr &new_var);
+    void pdo_out_batch_callback(const ether_ros::ModifyPDOVariablesBatch::ConstPtr &batch);
+    void pdo_command_callback(const ether_ros::PDOCommandBatch::ConstPtr &batch);
     void modify_pdo_variable(int slave_id, const ether_ros::ModifyPDOVariables::ConstPtr &new_var);
 };
 
@@ -38,7 +38,11 @@
 #ifndef PDO_OUT_PUB_TIMER_LIB_H
 #define PDO_OUT_PUB_TIMER_LIB_H
 
+#include <vector>
 #include "ros/ros.h"
+#include "ether_ros/PDOOut.h"
+#include "pdo_schema.h"
+#include "publish_throttle.h"
 
 /** \class PDOOutPublisher
     \brief The Process Data Objects Publisher class.
@@ -51,24 +55,28 @@ class PDOOutPublisherTimer
 {
   private:
     ros::Publisher pdo_out_pub_;
+    std::vector<PDODecoder<ether_ros::PDOOut> > decoders_;
     uint8_t * data_ptr_;
     ros::Timer pdo_out_timer_;
+    PublishThrottle throttle_;
 
     /** \fn void init(ros::NodeHandle &n)
     \brief Initialization Method.
 
     Used for initializing the PDOOutPublisherTimer object. It's basically
     the main method in the class, which initializes the listener to the afore
-    mentioned topic.
+    mentioned topic. The timer fires at the rate of \a /ethercat_slaves/publishers/pdo_out_timer
+    (Hz, default 0.2).
     \param n The ROS Node Handle
 */
     /** \fn void timer_callback(const ros::TimerEvent &event)
     \brief Timer Callback
 
     This method, is called when the timer fires.
-    Should the EtherCAT application change, this callback must change also.
     Implements the basic functionality of the class, to copy the \a pdo_out data
-    from the \a process_data_buffer and pipe them into another topic.
+    from the \a process_data_buffer and pipe them into another topic. The variables are decoded
+    with the \a pdo_out layout of every slave (see \a /pdo_layouts). With \a on_change, the slaves
+    whose output PDOs haven't changed are skipped.
     \param event The fired timer event.
 */
   public:
@@ -0,0 +1,77 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_raw_publisher.h
+   \brief Header file for the PDORawPublisher class.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_RAW_PUB_LIB_H
+#define PDO_RAW_PUB_LIB_H
+
+#include "ros/ros.h"
+#include "ether_ros/PDORaw.h"
+#include "pdo_raw_ring.h"
+
+/** \class PDORawPublisher
+    \brief The Raw Process Data Objects Publisher class.
+
+    Used for streaming the "raw" domain data, written by the EtherCAT Communicator in the
+    \a pdo_raw_ring, to the \a /pdo_raw topic, for the nodes outside of this process.
+    The construction of the message and its serialization are done in the (non realtime)
+    consumer thread. Every snapshot of the ring is published, tagged with the id and the
+    wakeup time of its cycle, while the topic has subscribers; without them, the ring is skipped.
+*/
+class PDORawPublisher : public PDORawRingConsumer
+{
+  private:
+    ros::Publisher pdo_raw_pub_;
+    ether_ros::PDORaw raw_data_;
+    int64_t clock_offset_ns_;
+    void publish_frame(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *frame);
+
+  protected:
+    void consume();
+
+    /** \fn void init(ros::NodeHandle &n)
+    \brief Initialization Method.
+
+    Used for initializing the PDORawPublisher object. Preallocates the message, sized from
+    \a total_process_data, advertises the \a /pdo_raw topic and starts the consumer thread.
+    Must be called after the \a pdo_raw_ring has been initialized.
+    \param n The ROS Node Handle
+*/
+  public:
+    void init(ros::NodeHandle &n);
+};
+
+#endif /* PDO_RAW_PUB_LIB_H */
@@ -0,0 +1,189 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_raw_ring.h
+   \brief Header file for the PDORawRing and PDORawRingConsumer classes.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_RAW_RING_LIB_H
+#define PDO_RAW_RING_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <atomic>
+
+/** \struct pdo_raw_snapshot
+    \brief A snapshot of the domain, as taken in a single cycle.
+    \var pdo_raw_snapshot::cycle
+    \brief The cycle counter of the EtherCAT Communicator, when the snapshot was taken.
+    \var pdo_raw_snapshot::timestamp_ns
+    \brief The (CLOCK_TO_USE) wakeup time of that cycle, in ns.
+    \var pdo_raw_snapshot::period_ns
+    \brief The period (\a PERIOD_NS) of that cycle, in ns.
+    \var pdo_raw_snapshot::data
+    \brief The domain bytes. Points to a buffer of \a PDORawRing::frame_size() bytes, owned by the reader.
+*/
+typedef struct pdo_raw_snapshot
+{
+    uint64_t cycle;
+    uint64_t timestamp_ns;
+    uint32_t period_ns;
+    uint8_t *data;
+} pdo_raw_snapshot;
+
+/** \class PDORawRing
+    \brief A lock-free, single producer, multiple consumer ring of domain snapshots.
+
+    The EtherCAT Communicator writes one slot per cycle and never waits for the readers.
+    Every reader keeps its own \a cursor and reads at its own rate. A reader that falls
+    more than \a capacity slots behind, loses the oldest snapshots, which are counted as
+    overruns in its cursor. Every slot is protected by its own sequence number (seqlock),
+    so a reader never returns a torn snapshot.
+*/
+class PDORawRing
+{
+  private:
+    typedef struct slot
+    {
+        std::atomic<uint64_t> seq;
+        uint64_t cycle;
+        uint64_t timestamp_ns;
+        uint32_t period_ns;
+        uint8_t *data;
+    } slot;
+    slot *slots_;
+    uint8_t *data_;
+    size_t capacity_;
+    size_t mask_;
+    size_t frame_size_;
+    std::atomic<uint64_t> head_;
+    bool read_slot(uint64_t index, pdo_raw_snapshot *snapshot);
+
+  public:
+    /** \struct cursor
+        \brief The reading position of a single consumer of the ring.
+        \var cursor::next
+        \brief The index of the next snapshot to be read.
+        \var cursor::overruns
+        \brief Number of snapshots lost, because the writer overwrote them before they were read.
+    */
+    typedef struct cursor
+    {
+        uint64_t next;
+        uint64_t overruns;
+    } cursor;
+
+    /** \fn void init(size_t capacity, size_t frame_size)
+    \brief Initialization Method.
+
+    Allocates (and prefaults) all the slots. Must be called before the realtime thread starts.
+    \param capacity Number of slots, rounded up to a power of two.
+    \param frame_size The size of every snapshot in bytes.
+*/
+    /** \fn void write(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *data)
+    \brief Producer side: stores a new snapshot, overwriting the oldest one.
+
+    Wait-free. Must only be called from the realtime thread.
+*/
+    /** \fn void attach(cursor *c)
+    \brief Consumer side: positions a new cursor just after the latest snapshot.
+*/
+    /** \fn bool read(cursor *c, pdo_raw_snapshot *snapshot)
+    \brief Consumer side: reads the next snapshot in order.
+
+    \retval false if there is no unread snapshot.
+*/
+    /** \fn bool read_latest(cursor *c, pdo_raw_snapshot *snapshot)
+    \brief Consumer side: reads the newest snapshot, skipping on purpose any older unread ones.
+
+    The skipped snapshots are not counted as overruns.
+    \retval false if there is no unread snapshot.
+*/
+    /** \fn void skip(cursor *c)
+    \brief Consumer side: moves the cursor after the newest snapshot, without reading anything.
+
+    For the consumers with nobody to pass the snapshots to. The skipped snapshots are not counted as overruns.
+*/
+    PDORawRing();
+    ~PDORawRing();
+    void init(size_t capacity, size_t frame_size);
+    size_t frame_size();
+    void write(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *data);
+    void attach(cursor *c);
+    bool read(cursor *c, pdo_raw_snapshot *snapshot);
+    bool read_latest(cursor *c, pdo_raw_snapshot *snapshot);
+    void skip(cursor *c);
+};
+
+/** \class PDORawRingConsumer
+    \brief Base class for the consumers of the PDORawRing.
+
+    Owns a (non realtime) thread, which wakes up every \a wakeup_period_ns() and calls \a consume().
+    The period is asked again at every wakeup, so the consumers follow the changes of \a PERIOD_NS.
+    The derived classes read the ring through \a read() or \a read_latest(), with
+    their own cursor and their own buffer, or \a skip() it, when the snapshots aren't needed.
+*/
+class PDORawRingConsumer
+{
+  private:
+    pthread_t consumer_thread_;
+    static void *run(void *arg);
+
+  protected:
+    PDORawRing::cursor cursor_;
+    pdo_raw_snapshot snapshot_;
+    /** \fn void start_consumer()
+    \brief Attaches to the ring and starts the consumer thread, on the CPUs of the \a telemetry_spinner.
+
+    Must be called after the \a telemetry_spinner has been initialized.
+*/
+    /** \fn virtual int wakeup_period_ns()
+    \brief The time till the next wakeup of the consumer thread: a cycle (\a PERIOD_NS), by default.
+*/
+    /** \fn virtual void consume()
+    \brief Called every \a wakeup_period_ns() from the consumer thread.
+*/
+    void start_consumer();
+    bool read();
+    bool read_latest();
+    void skip();
+    virtual int wakeup_period_ns();
+    virtual void consume() = 0;
+
+  public:
+    virtual ~PDORawRingConsumer() {}
+    uint64_t overruns();
+};
+
+#endif /* PDO_RAW_RING_LIB_H */
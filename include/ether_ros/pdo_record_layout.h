@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_record_layout.h
+   \brief Layout of the binary record files of the PDORecorder.
+
+   Shared between the PDORecorder (inside ether_ros) and the readers (pdo_record_reader.h,
+   scripts/pdo_record.py). Doesn't depend on ROS or the IgH Master.
+
+   A record file consists of:
+   - The \a pdo_record_header
+   - The slave table: \a slave_count \a pdo_record_slave entries, at \a slaves_offset
+   - The layout text, at \a layout_offset: a line "slave in|out name type offset bit" per PDO variable
+   - The records, at \a data_offset (page aligned): \a records times \a record_size bytes, every one a
+     \a pdo_record_entry followed by a copy of the whole domain (\a image_size bytes)
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_RECORD_LAYOUT_LIB_H
+#define PDO_RECORD_LAYOUT_LIB_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define PDO_RECORD_MAGIC 0x43455245 // "EREC"
+#define PDO_RECORD_VERSION 2
+#define PDO_RECORD_NAME_SIZE 32
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "The record header needs lock-free 64-bit atomics"
+#endif
+
+/** \struct pdo_record_slave
+    \brief The name, and the offsets (from the start of an image) and sizes of the PDOs, of a single slave.
+*/
+typedef struct pdo_record_slave
+{
+    char name[PDO_RECORD_NAME_SIZE];
+    uint32_t pdo_out_offset;
+    uint32_t pdo_out_size;
+    uint32_t pdo_in_offset;
+    uint32_t pdo_in_size;
+} pdo_record_slave;
+
+/** \struct pdo_record_header
+    \brief The header at the start of a record file.
+    \var pdo_record_header::magic
+    \brief Always PDO_RECORD_MAGIC.
+    \var pdo_record_header::version
+    \brief The layout version (PDO_RECORD_VERSION). Readers must refuse any other version.
+    \var pdo_record_header::image_size
+    \brief The size of the domain copy of every record, in bytes.
+    \var pdo_record_header::record_size
+    \brief The size of every record (entry and image, padded to 8 bytes).
+    \var pdo_record_header::period_ns
+    \brief The period of the EtherCAT Communicator, when the file was created. The period may change
+    while recording (\see EthercatCommunicator::change_period): every record has its own \a period_ns.
+    \var pdo_record_header::clock_offset_ns
+    \brief CLOCK_REALTIME - CLOCK_MONOTONIC when the file was created: adding it to a timestamp gives the wall time.
+    \var pdo_record_header::records
+    \brief The number of complete records. Incremented (release) after every record is written,
+    so that a reader can follow a file being recorded.
+    \var pdo_record_header::dropped
+    \brief The snapshots which were overwritten in the pdo_raw_ring before being recorded.
+*/
+typedef struct pdo_record_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t image_size;
+    uint32_t record_size;
+    uint32_t slave_count;
+    uint32_t period_ns;
+    uint32_t layout_size;
+    uint64_t slaves_offset;
+    uint64_t layout_offset;
+    uint64_t data_offset;
+    int64_t clock_offset_ns;
+    std::atomic<uint64_t> records;
+    std::atomic<uint64_t> dropped;
+} pdo_record_header;
+
+/** \struct pdo_record_entry
+    \brief The start of every record.
+    \var pdo_record_entry::cycle
+    \brief The id of the cycle of the snapshot.
+    \var pdo_record_entry::timestamp_ns
+    \brief The (CLOCK_MONOTONIC) wakeup time of that cycle.
+    \var pdo_record_entry::period_ns
+    \brief The period of that cycle.
+*/
+typedef struct pdo_record_entry
+{
+    uint64_t cycle;
+    uint64_t timestamp_ns;
+    uint32_t period_ns;
+    uint32_t reserved;
+} pdo_record_entry;
+
+#endif /* PDO_RECORD_LAYOUT_LIB_H */
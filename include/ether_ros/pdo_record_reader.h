@@ -0,0 +1,145 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_record_reader.h
+   \brief Header-only memory mapped reader of the record files of the PDORecorder.
+
+   For the post-processing tools: maps a record file read-only, and gives direct access to
+   the records, without copying them. Follows a file which is still being recorded.
+   Doesn't depend on ROS or the IgH Master.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_RECORD_READER_LIB_H
+#define PDO_RECORD_READER_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pdo_record_layout.h"
+
+/** \class PDORecordReader
+    \brief Reads a record file of the PDORecorder, through mmap.
+*/
+class PDORecordReader
+{
+  private:
+    uint8_t *file_;
+    size_t file_size_;
+    const pdo_record_header *header_;
+
+  public:
+    PDORecordReader() : file_(NULL), file_size_(0), header_(NULL) {}
+    ~PDORecordReader() { close(); }
+
+    /** \fn bool open(const char *path)
+    \brief Maps the record file.
+
+    \retval false if the file can't be mapped, or has an incompatible layout.
+*/
+    bool open(const char *path)
+    {
+        struct stat st;
+        int fd = ::open(path, O_RDONLY);
+
+        if (fd < 0)
+            return false;
+        if (fstat(fd, &st) || (size_t)st.st_size < sizeof(pdo_record_header))
+        {
+            ::close(fd);
+            return false;
+        }
+        file_size_ = st.st_size;
+        void *file = mmap(NULL, file_size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (file == MAP_FAILED)
+            return false;
+        file_ = (uint8_t *)file;
+        header_ = (const pdo_record_header *)file_;
+        if (header_->magic != PDO_RECORD_MAGIC || header_->version != PDO_RECORD_VERSION)
+        {
+            close();
+            return false;
+        }
+        madvise(file_, file_size_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close()
+    {
+        if (file_)
+            munmap(file_, file_size_);
+        file_ = NULL;
+        header_ = NULL;
+        file_size_ = 0;
+    }
+
+    const pdo_record_header *header() const { return header_; }
+
+    const pdo_record_slave *slave(size_t index) const
+    {
+        return (const pdo_record_slave *)(file_ + header_->slaves_offset) + index;
+    }
+
+    /** \fn const char *layout()
+    \brief The layout text (\a layout_size bytes, not null terminated).
+*/
+    const char *layout() const { return (const char *)file_ + header_->layout_offset; }
+
+    /** \fn size_t records()
+    \brief The number of complete records, which are inside the mapping.
+*/
+    size_t records() const
+    {
+        uint64_t records = header_->records.load(std::memory_order_acquire);
+        uint64_t mapped = (file_size_ - header_->data_offset) / header_->record_size;
+        return records < mapped ? records : mapped;
+    }
+
+    const pdo_record_entry *entry(size_t index) const
+    {
+        return (const pdo_record_entry *)(file_ + header_->data_offset + index * header_->record_size);
+    }
+
+    /** \fn const uint8_t *image(size_t index)
+    \brief The domain copy of the record \a index, with the PDOs at the offsets of the slave table.
+*/
+    const uint8_t *image(size_t index) const
+    {
+        return (const uint8_t *)(entry(index) + 1);
+    }
+};
+
+#endif /* PDO_RECORD_READER_LIB_H */
@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_recorder.h
+   \brief Header file for the PDORecorder class.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_RECORDER_LIB_H
+#define PDO_RECORDER_LIB_H
+
+#include <string>
+#include <pthread.h>
+#include "ros/ros.h"
+#include "pdo_raw_ring.h"
+#include "pdo_record_layout.h"
+
+/** \class PDORecorder
+    \brief The binary recorder of the domain snapshots.
+
+    Appends every snapshot of the \a pdo_raw_ring, with its cycle id and timestamp, to a binary
+    file, in a (non realtime) consumer thread. The file is written through a memory mapped window,
+    which moves along as the file grows, so there are no system calls per record. Its layout
+    is described in pdo_record_layout.h; read it with pdo_record_reader.h or scripts/pdo_record.py.
+    Enabled with \a /ethercat_slaves/recorder/enabled.
+*/
+class PDORecorder : public PDORawRingConsumer
+{
+  private:
+    bool enabled_;
+    std::string path_;
+    int fd_;
+    size_t window_size_;
+    uint64_t max_size_;
+    pdo_record_header *header_;
+    uint8_t *window_;
+    uint64_t window_offset_;
+    uint64_t position_;
+    pthread_mutex_t mutex_;
+    bool finished_;
+    bool map_window(uint64_t position);
+    void write_header(int64_t clock_offset_ns);
+
+  protected:
+    int wakeup_period_ns();
+    void consume();
+
+  public:
+    /** \fn void init(ros::NodeHandle &n)
+    \brief Initialization Method.
+
+    Creates the record file (\a /ethercat_slaves/recorder/path), writes its header and starts the
+    consumer thread. Must be called after the \a pdo_raw_ring and the \a slave_offsets have been initialized.
+    \param n The ROS Node Handle
+*/
+    /** \fn void finish()
+    \brief Records the pending snapshots and truncates the file to its records. No snapshots are recorded afterwards.
+*/
+    PDORecorder();
+    void init(ros::NodeHandle &n);
+    void finish();
+};
+
+#endif /* PDO_RECORDER_LIB_H */
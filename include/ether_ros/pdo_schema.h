@@ -0,0 +1,355 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_schema.h
+   \brief Header file for the PDO schema: PDOLayout class and PDODecoder template.
+
+   The layouts of the PDOs are declared in the \a /pdo_layouts parameters
+   (see config/ethercat_slaves.yaml) and compiled, at startup, into flat
+   offset/type tables. A PDODecoder binds such a table to the fields of a ROS message.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_SCHEMA_LIB_H
+#define PDO_SCHEMA_LIB_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "ros/ros.h"
+
+/** \enum pdo_type
+    \brief The types of the PDO variables.
+
+    The values are the same as the ones used by the PDOOutListener for the \a type strings.
+*/
+typedef enum pdo_type
+{
+    PDO_BOOL = 0,
+    PDO_UINT8,
+    PDO_INT8,
+    PDO_UINT16,
+    PDO_INT16,
+    PDO_UINT32,
+    PDO_INT32,
+    PDO_UINT64,
+    PDO_INT64,
+    PDO_INVALID
+} pdo_type;
+
+/** \struct pdo_field
+    \brief A single variable of a PDO layout.
+    \var pdo_field::name
+    \brief The name of the variable (the same as the field of the ROS message, if any).
+    \var pdo_field::type
+    \brief The type of the variable.
+    \var pdo_field::offset
+    \brief The byte offset of the variable, from the start of the slave's PDO.
+    \var pdo_field::bit
+    \brief The bit inside the byte, for the PDO_BOOL variables.
+*/
+typedef struct pdo_field
+{
+    std::string name;
+    pdo_type type;
+    uint16_t offset;
+    uint8_t bit;
+} pdo_field;
+
+/** \fn pdo_type pdo_type_from_string(const std::string &type)
+    \brief Returns the pdo_type with the given name ("bool", "uint8", ..., "int64") or PDO_INVALID.
+*/
+pdo_type pdo_type_from_string(const std::string &type);
+
+/** \fn const char *pdo_type_name(pdo_type type)
+    \brief Returns the name of the type, as in the layouts, or "invalid" for PDO_INVALID.
+*/
+const char *pdo_type_name(pdo_type type);
+
+/** \fn size_t pdo_type_size(pdo_type type)
+    \brief Returns the size of the type in bytes.
+*/
+size_t pdo_type_size(pdo_type type);
+
+/** \fn int64_t read_pdo_field(const uint8_t *data_ptr, const pdo_field &field)
+    \brief Returns the value of the \a field, from the slave's PDO starting at \a data_ptr.
+
+    Unsigned 64-bit values are returned with their bits unchanged.
+*/
+int64_t read_pdo_field(const uint8_t *data_ptr, const pdo_field &field);
+
+/** \fn int64_t read_pdo_value(const uint8_t *data_ptr, pdo_type type, size_t offset, uint8_t bit)
+    \brief Returns the variable of \a type at \a offset (and \a bit) of the PDO starting at \a data_ptr. \see read_pdo_field
+*/
+int64_t read_pdo_value(const uint8_t *data_ptr, pdo_type type, size_t offset, uint8_t bit);
+
+/** \fn void read_pdo_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves, const pdo_field &field, int64_t *column)
+    \brief Bulk decode: reads the \a field of \a slaves slaves, whose PDOs start at \a slave_offsets of the \a frame.
+
+    The type is dispatched once per call, not once per slave. \see utilities::pdo_read_column
+*/
+void read_pdo_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves,
+                     const pdo_field &field, int64_t *column);
+
+/** \fn void write_pdo_value(uint8_t *data_ptr, pdo_type type, size_t offset, uint8_t bit, int64_t value)
+    \brief Writes \a value, as a variable of \a type, at \a offset (and \a bit) of the slave's PDO starting at \a data_ptr.
+
+    The value is truncated to the size of the type.
+*/
+void write_pdo_value(uint8_t *data_ptr, pdo_type type, size_t offset, uint8_t bit, int64_t value);
+
+/** \typedef pdo_writer
+    \brief Writes a value, as a variable of a fixed type, at \a data_ptr (and \a bit, for the PDO_BOOL variables).
+*/
+typedef void (*pdo_writer)(uint8_t *data_ptr, uint8_t bit, int64_t value);
+
+/** \fn pdo_writer pdo_type_writer(pdo_type type)
+    \brief Returns the writer of the \a type, or NULL for PDO_INVALID.
+
+    For the writes dispatched through a table, resolved once, instead of a switch per write.
+*/
+pdo_writer pdo_type_writer(pdo_type type);
+
+/** \class PDOLayout
+    \brief The flat offset/type table of a slave's input or output PDO.
+*/
+class PDOLayout
+{
+  private:
+    std::vector<pdo_field> fields_;
+
+  public:
+    /** \fn bool load(ros::NodeHandle &n, const std::string &param)
+    \brief Loads the layout from a list parameter of {name, type, offset[, bit]} entries.
+
+    \retval false if the parameter doesn't exist or an entry is malformed.
+*/
+    /** \fn bool load(XmlRpc::XmlRpcValue &list, const std::string &param)
+    \brief Loads the layout from an already fetched \a list (\a param is its name, for the errors).
+
+    \retval false if \a list isn't a list or an entry is malformed.
+*/
+    /** \fn size_t span()
+    \brief The number of bytes covered by the layout (the end of its last variable).
+*/
+    /** \fn int find(const std::string &name)
+    \brief Returns the index of the variable \a name, or -1.
+*/
+    bool load(ros::NodeHandle &n, const std::string &param);
+    bool load(XmlRpc::XmlRpcValue &list, const std::string &param);
+    size_t size() const;
+    size_t span() const;
+    int find(const std::string &name) const;
+    const pdo_field &field(size_t index) const;
+};
+
+/** \struct pdo_binding
+    \brief The link between a variable name and the field of a message of type \a M.
+*/
+template <class M>
+struct pdo_binding
+{
+    const char *name;
+    void (*set)(M &msg, int64_t value);
+};
+
+/** \def PDO_BINDING(M, field)
+    \brief Creates the pdo_binding of the \a field of message \a M.
+*/
+#define PDO_BINDING(M, field) \
+    { #field, [](M &msg, int64_t value) { msg.field = value; } }
+
+/** \class PDODecoder
+    \brief Decodes a slave's PDO into a message of type \a M, in a single pass.
+
+    The variables of the layout, that don't have a binding in \a M, are ignored
+    (with a warning in \a init()).
+*/
+template <class M>
+class PDODecoder
+{
+  private:
+    std::vector<pdo_field> fields_;
+    std::vector<void (*)(M &, int64_t)> setters_;
+
+  public:
+    void init(const PDOLayout &layout, const pdo_binding<M> *bindings, size_t bindings_count)
+    {
+        fields_.clear();
+        setters_.clear();
+        for (size_t i = 0; i < layout.size(); i++)
+        {
+            size_t j;
+            for (j = 0; j < bindings_count; j++)
+            {
+                if (layout.field(i).name == bindings[j].name)
+                    break;
+            }
+            if (j == bindings_count)
+            {
+                ROS_WARN("PDO variable '%s' has no field in the message, it won't be published\n",
+                         layout.field(i).name.c_str());
+                continue;
+            }
+            fields_.push_back(layout.field(i));
+            setters_.push_back(bindings[j].set);
+        }
+    }
+
+    void decode(const uint8_t *data_ptr, M &msg) const
+    {
+        for (size_t i = 0; i < fields_.size(); i++)
+        {
+            setters_[i](msg, read_pdo_field(data_ptr, fields_[i]));
+        }
+    }
+};
+
+/** \struct pdo_column_binding
+    \brief The link between a variable name and an array field of a message of type \a M,
+    with an element per slave (struct of arrays).
+*/
+template <class M>
+struct pdo_column_binding
+{
+    const char *name;
+    void (*set)(M &msg, const size_t *slaves, size_t count, const int64_t *values);
+    void (*resize)(M &msg, size_t slaves);
+};
+
+/** \def PDO_COLUMN_BINDING(M, field)
+    \brief Creates the pdo_column_binding of the array \a field of message \a M.
+*/
+#define PDO_COLUMN_BINDING(M, field)                                                           \
+    {                                                                                          \
+        #field, [](M &msg, const size_t *slaves, size_t count, const int64_t *values) {       \
+            for (size_t k = 0; k < count; k++)                                                 \
+                msg.field[slaves[k]] = values[k];                                              \
+        },                                                                                     \
+            [](M &msg, size_t slaves) { msg.field.resize(slaves); }                            \
+    }
+
+/** \class PDOColumnDecoder
+    \brief Decodes the PDOs of every slave into a single message of type \a M, with an array per variable.
+
+    Every slave has its own layout. At \a init(), the slaves which have a variable at the same offset
+    (and type and bit) are grouped in a column: a column is decoded with a single \a read_pdo_column()
+    over the offsets of its slaves, and stored with a single call of its binding. With identical
+    layouts, that's a column per variable. The arrays of \a M are sized once, by \a prepare(), with an
+    element per slave: the elements of the slaves which don't have a variable stay 0. The variables of
+    the layouts, that don't have a binding in \a M, are ignored (with a warning in \a init()).
+*/
+template <class M>
+class PDOColumnDecoder
+{
+  private:
+    typedef struct column
+    {
+        pdo_field field;
+        void (*set)(M &msg, const size_t *slaves, size_t count, const int64_t *values);
+        std::vector<size_t> slaves;
+        std::vector<size_t> offsets; // of the PDOs of the slaves, in the frame
+    } column;
+    std::vector<column> columns_;
+    std::vector<void (*)(M &, size_t)> resizers_;
+    std::vector<int64_t> values_;
+    size_t slaves_;
+
+  public:
+    PDOColumnDecoder() : slaves_(0) {}
+
+    void init(const std::vector<const PDOLayout *> &layouts, const std::vector<size_t> &pdo_offsets,
+              const pdo_column_binding<M> *bindings, size_t bindings_count)
+    {
+        columns_.clear();
+        resizers_.clear();
+        for (size_t j = 0; j < bindings_count; j++)
+            resizers_.push_back(bindings[j].resize);
+        for (size_t s = 0; s < layouts.size(); s++)
+        {
+            for (size_t i = 0; i < layouts[s]->size(); i++)
+            {
+                const pdo_field &field = layouts[s]->field(i);
+                size_t j;
+                for (j = 0; j < bindings_count; j++)
+                {
+                    if (field.name == bindings[j].name)
+                        break;
+                }
+                if (j == bindings_count)
+                {
+                    ROS_WARN("PDO variable '%s' of slave %lu has no field in the aggregated message, it won't be published\n",
+                             field.name.c_str(), s);
+                    continue;
+                }
+                size_t c;
+                for (c = 0; c < columns_.size(); c++)
+                {
+                    const pdo_field &other = columns_[c].field;
+                    if (columns_[c].set == bindings[j].set && other.type == field.type &&
+                        other.offset == field.offset && other.bit == field.bit)
+                        break;
+                }
+                if (c == columns_.size())
+                {
+                    column new_column;
+                    new_column.field = field;
+                    new_column.set = bindings[j].set;
+                    columns_.push_back(new_column);
+                }
+                columns_[c].slaves.push_back(s);
+                columns_[c].offsets.push_back(pdo_offsets[s]);
+            }
+        }
+        slaves_ = layouts.size();
+        values_.assign(slaves_, 0);
+    }
+
+    void prepare(M &msg) const
+    {
+        for (size_t j = 0; j < resizers_.size(); j++)
+            resizers_[j](msg, slaves_);
+    }
+
+    void decode(const uint8_t *frame, M &msg)
+    {
+        for (size_t c = 0; c < columns_.size(); c++)
+        {
+            const column &col = columns_[c];
+            read_pdo_column(frame, col.offsets.data(), col.offsets.size(), col.field, values_.data());
+            col.set(msg, col.slaves.data(), col.slaves.size(), values_.data());
+        }
+    }
+};
+
+#endif /* PDO_SCHEMA_LIB_H */
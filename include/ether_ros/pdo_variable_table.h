@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_variable_table.h
+   \brief Header file for the PDOVariableTable class.
+
+   The output PDO variables of all the slaves, numbered once from their \a pdo_out layouts, for
+   the compact commands of the \a /pdo_command topic.
+*/
+
+/*****************************************************************************/
+
+#ifndef PDO_VARIABLE_TABLE_LIB_H
+#define PDO_VARIABLE_TABLE_LIB_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "pdo_schema.h"
+
+/** \struct pdo_variable_slot
+    \brief Where, and how, a variable of a slave is written.
+    \var pdo_variable_slot::offset
+    \brief The offset of the variable in the process image (the same as in process_data_buf).
+    \var pdo_variable_slot::write
+    \brief The writer of the type of the variable, or NULL if the slave doesn't have the variable.
+    \var pdo_variable_slot::type
+    \brief The type of the variable.
+    \var pdo_variable_slot::bit
+    \brief The bit inside the byte, for the PDO_BOOL variables.
+*/
+typedef struct pdo_variable_slot
+{
+    uint32_t offset;
+    pdo_writer write;
+    pdo_type type;
+    uint8_t bit;
+} pdo_variable_slot;
+
+/** \class PDOVariableTable
+    \brief The ids of the output PDO variables, and a slot per variable and slave.
+
+    The ids are the indices of the distinct variable names of the \a pdo_out layouts of all the
+    slaves, in the order they are first declared (bus order). A client resolves the names to ids
+    once, from the \a /ethercat_slaves/pdo_out_variables parameter, and then sends only numbers.
+*/
+class PDOVariableTable
+{
+  private:
+    std::vector<std::string> names_;
+    std::vector<pdo_variable_slot> slots_; // slots_[id * slaves_ + slave]
+    size_t slaves_;
+
+  public:
+    /** \fn void init()
+    \brief Builds the table from the \a pdo_out layouts of the \a ethercat_slaves and the \a slave_offsets.
+*/
+    /** \fn int find(const std::string &name)
+    \brief Returns the id of the variable \a name, or -1.
+*/
+    /** \fn const pdo_variable_slot &slot(size_t id, size_t slave)
+    \brief The slot of the variable \a id of \a slave. No bounds checks: \a id < size() and \a slave < slaves_count.
+*/
+    void init();
+    size_t size() const;
+    const std::vector<std::string> &names() const;
+    int find(const std::string &name) const;
+    inline const pdo_variable_slot &slot(size_t id, size_t slave) const
+    {
+        return slots_[id * slaves_ + slave];
+    }
+};
+
+#endif /* PDO_VARIABLE_TABLE_LIB_H */
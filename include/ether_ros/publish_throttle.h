@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file publish_throttle.h
+   \brief Header file for the PublishThrottle class.
+*/
+
+/*****************************************************************************/
+
+#ifndef PUBLISH_THROTTLE_LIB_H
+#define PUBLISH_THROTTLE_LIB_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "ros/ros.h"
+
+/** \class PublishThrottle
+    \brief The rate limiter of a monitoring topic.
+
+    Fetches from \a /ethercat_slaves/publishers/{topic} the rate of a topic (and whether it's
+    published at all), and decides, for every cycle and every slave, whether a message is due.
+    With \a on_change, the message of a slave is only published when its bytes have changed since
+    the last published message, which is detected with a (64 bit FNV-1a) hash of the slave's range.
+*/
+class PublishThrottle
+{
+  private:
+    bool enabled_;
+    double rate_;
+    bool on_change_;
+    int frequency_; //the FREQUENCY of the decimation
+    uint64_t decimation_;
+    uint64_t next_cycle_;
+    std::vector<uint64_t> hashes_;
+    std::vector<bool> published_;
+    uint64_t unchanged_;
+    void update_decimation();
+
+  public:
+    /** \fn void init(ros::NodeHandle &n, const std::string &topic, double default_rate, bool default_on_change, int slaves)
+    \brief Initialization Method.
+
+    Fetches the \a enabled, \a rate (Hz) and \a on_change parameters of the topic. A rate of 0 means
+    every cycle. The rate is turned into a decimation of the cycles, so the published messages stay
+    aligned to the cycle grid.
+    \param n The ROS Node Handle
+    \param topic The name of the topic, which is also the name of its parameters.
+    \param default_rate The rate, when it's not declared.
+    \param default_on_change The \a on_change, when it's not declared.
+    \param slaves The number of slaves (separate hashes) of the topic.
+*/
+    /** \fn bool due(uint64_t cycle)
+    \brief Whether a message of the cycle \a cycle is due, according to the rate.
+
+    Must be called with increasing cycles; a due cycle moves the next due cycle to the next multiple of the decimation.
+    The decimation follows the changes of the period, so the rate stays the same.
+*/
+    /** \fn bool changed(int slave, const uint8_t *data, size_t size)
+    \brief Whether the message of the slave must be published, according to \a on_change.
+
+    Always true without \a on_change, or for the first message of the slave.
+    \param slave The index of the slave.
+    \param data The bytes of the slave, which the message is decoded from.
+    \param size The number of bytes.
+*/
+    /** \fn int consumer_period_ns()
+    \brief The wakeup period of a PDORawRingConsumer publishing the topic: a cycle, or the period of the rate (at most a second).
+*/
+    /** \fn uint64_t unchanged()
+    \brief The number of messages not published, because the bytes of their slave hadn't changed.
+*/
+    PublishThrottle();
+    void init(ros::NodeHandle &n, const std::string &topic, double default_rate, bool default_on_change, int slaves);
+    bool due(uint64_t cycle);
+    bool changed(int slave, const uint8_t *data, size_t size);
+    bool enabled();
+    double rate();
+    uint64_t decimation();
+    bool on_change();
+    int consumer_period_ns();
+    uint64_t unchanged();
+};
+
+#endif /* PUBLISH_THROTTLE_LIB_H */
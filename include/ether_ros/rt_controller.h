@@ -0,0 +1,186 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file rt_controller.h
+   \brief Header file for the RTController interface, its RTControllerIO and the registry of the controller types.
+
+   A controller runs on the realtime thread, in the cycle, between the processing of the domains and
+   their queueing: it reads the inputs received in this very cycle, and its outputs are sent in the
+   same frame, without any ROS transport in between. A controller type is compiled in the node, and
+   registered with ETHER_ROS_REGISTER_CONTROLLER; the instances are declared in \a /ethercat_slaves/controllers.
+   \see ControllerManager
+*/
+
+/*****************************************************************************/
+
+#ifndef RT_CONTROLLER_LIB_H
+#define RT_CONTROLLER_LIB_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ros/ros.h"
+#include "pdo_schema.h"
+
+/** \struct rt_variable
+    \brief A PDO variable of a slave, resolved for the realtime side.
+    \var rt_variable::offset
+    \brief The offset of the variable in the process image (the domain1_pd).
+    \var rt_variable::type
+    \brief The type of the variable.
+    \var rt_variable::bit
+    \brief The bit inside the byte, for the PDO_BOOL variables.
+*/
+typedef struct rt_variable
+{
+    uint32_t offset;
+    pdo_type type;
+    uint8_t bit;
+} rt_variable;
+
+/** \class RTControllerIO
+    \brief The inputs and the outputs of a controller.
+
+    At init, resolves the variables of the controller (the outputs are claimed: a variable has
+    a single controller). In the cycle, reads them from the domain and writes the held outputs
+    of the controller, which the ControllerManager sends every cycle, also between two runs of the controller.
+*/
+class RTControllerIO
+{
+  private:
+    const uint8_t *inputs_;
+    uint8_t *outputs_;
+    std::string controller_;
+    std::vector<rt_variable> claims_;
+    std::vector<int> slaves_;
+    bool resolve(int slave, const std::string &name, bool output, rt_variable *var);
+    friend class ControllerManager;
+
+  public:
+    /** \fn bool input(int slave, const std::string &name, rt_variable *var)
+    \brief Non realtime: resolves the variable \a name of the \a pdo_in layout of \a slave.
+
+    \retval false (and logs) if the slave, or the variable, don't exist.
+*/
+    /** \fn bool output(int slave, const std::string &name, rt_variable *var)
+    \brief Non realtime: resolves and claims the variable \a name of the \a pdo_out layout of \a slave.
+
+    The claimed variables are no longer driven by the output image (the topics and the services),
+    but by the controller, as long as it's enabled.
+    \retval false (and logs) if the slave, or the variable, don't exist, or another controller has claimed it.
+*/
+    /** \fn int64_t read(const rt_variable &var)
+    \brief Realtime: the value of an input (or of an output, as it's being sent) in this cycle.
+*/
+    /** \fn void write(const rt_variable &var, int64_t value)
+    \brief Realtime: the new value of a claimed output. Truncated to the size of the type.
+*/
+    /** \var uint64_t cycle
+    \brief The id of the cycle. \see EthercatCommunicator::current_cycle()
+*/
+    /** \var uint64_t time_ns
+    \brief The (CLOCK_TO_USE) wakeup time of the cycle.
+*/
+    /** \var uint64_t period_ns
+    \brief The time since the previous run of the controller, on the cycle grid (\a PERIOD_NS times its divider).
+*/
+    RTControllerIO();
+    bool input(int slave, const std::string &name, rt_variable *var);
+    bool output(int slave, const std::string &name, rt_variable *var);
+    inline int64_t read(const rt_variable &var) const
+    {
+        return read_pdo_value(inputs_, var.type, var.offset, var.bit);
+    }
+    inline void write(const rt_variable &var, int64_t value)
+    {
+        write_pdo_value(outputs_, var.type, var.offset, var.bit, value);
+    }
+    uint64_t cycle;
+    uint64_t time_ns;
+    uint64_t period_ns;
+};
+
+/** \class RTController
+    \brief The interface of the controllers run on the realtime thread.
+
+    \a init() runs in the main thread, at startup: it resolves the variables and allocates
+    everything the controller needs. \a update() runs on the realtime thread, every \a divider cycles,
+    within the \a budget_ns of the controller: it must not allocate, lock, sleep, log or do any
+    I/O. With the ETHER_ROS_RT_CHECKS CMake option (the default of the Debug builds), an \a update()
+    which allocates with new, or blocks (a voluntary context switch), disables its controller.
+*/
+class RTController
+{
+  public:
+    /** \fn bool init(ros::NodeHandle &n, RTControllerIO &io, XmlRpc::XmlRpcValue &params)
+    \brief Non realtime: configures the controller from its entry of \a /ethercat_slaves/controllers (\a params).
+
+    \retval false if the configuration isn't valid: the node exits.
+*/
+    /** \fn void update(RTControllerIO &io)
+    \brief Realtime: a run of the controller, on the inputs of this cycle.
+*/
+    virtual ~RTController() {}
+    virtual bool init(ros::NodeHandle &n, RTControllerIO &io, XmlRpc::XmlRpcValue &params) = 0;
+    virtual void update(RTControllerIO &io) = 0;
+};
+
+/** \typedef rt_controller_factory
+    \brief Creates a controller of a registered type.
+*/
+typedef RTController *(*rt_controller_factory)();
+
+namespace rt_controllers
+{
+/** \fn bool register_type(const char *type, rt_controller_factory factory)
+    \brief Registers a controller type, before main(). \see ETHER_ROS_REGISTER_CONTROLLER
+*/
+/** \fn RTController *create(const std::string &type)
+    \brief A new controller of \a type, or NULL if it isn't registered.
+*/
+/** \fn std::vector<std::string> types()
+    \brief The names of the registered types.
+*/
+bool register_type(const char *type, rt_controller_factory factory);
+RTController *create(const std::string &type);
+std::vector<std::string> types();
+} // namespace rt_controllers
+
+/** \def ETHER_ROS_REGISTER_CONTROLLER(C, type)
+    \brief Registers the class \a C (default constructible) as the controller type \a type (a string).
+
+    Used once, in the source file of the controller, which must be in the SOURCES of the node.
+*/
+#define ETHER_ROS_REGISTER_CONTROLLER(C, type)          \
+    static RTController *create_##C() { return new C(); } \
+    static bool registered_##C __attribute__((unused)) = rt_controllers::register_type(type, create_##C)
+
+#endif /* RT_CONTROLLER_LIB_H */
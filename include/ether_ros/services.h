@@ -82,6 +82,10 @@
     - Start
     - Stop
     - Restart
+    - Reset the overrun fault (reset_fault), latched by the safe_outputs overrun policy
+    - Change the cycle period and the SYNC0 shift (\a period \a <period_ns> \a [<sync0_shift_ns>]), at a
+    restart of the realtime thread, and update \a /ethercat_slaves/period_ns and \a sync0_shift.
+    \see EthercatCommunicator::change_period
     (Remember that a Service Callback must always return a boolean.)
 */
 /** \fn start_ethercat_communicator()
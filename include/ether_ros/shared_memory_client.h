@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file shared_memory_client.h
+   \brief Header file for the SharedMemoryClient class.
+
+   The client library for the shared memory region of the EtherCAT Communicator.
+   Doesn't depend on ROS or the IgH Master; link with \a libether_ros_shm_client.
+*/
+
+/*****************************************************************************/
+
+#ifndef SHM_CLIENT_LIB_H
+#define SHM_CLIENT_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "shared_memory_layout.h"
+
+/** \struct shm_frame_info
+    \brief The info of the cycle that produced an input image.
+*/
+typedef struct shm_frame_info
+{
+    uint64_t cycle;
+    uint64_t timestamp_ns;
+    uint32_t working_counter;
+    uint32_t wc_state;
+} shm_frame_info;
+
+/** \class SharedMemoryClient
+    \brief Gives access to the PDOs of the EtherCAT Communicator from another process of the same host.
+
+    Reads the inputs and stages the outputs of the slaves, without any socket traffic.
+    Every slave must have at most one client staging its outputs.
+    None of the methods allocate or do system calls, except \a open() and \a close().
+*/
+class SharedMemoryClient
+{
+  private:
+    shm_header *header_;
+    size_t region_size_;
+    uint8_t *input_image_;
+    uint8_t *output_image_;
+
+  public:
+    /** \fn bool open(const char *name)
+    \brief Maps the region created by the EtherCAT Communicator.
+
+    \retval false if the region doesn't exist (yet), or has an incompatible layout.
+*/
+    /** \fn bool read_inputs(uint8_t *buffer, shm_frame_info *info)
+    \brief Copies the whole input image (\a image_size() bytes) to \a buffer.
+
+    The copy is consistent: all the bytes come from the same cycle.
+    \retval false if the communicator kept writing the image during every retry.
+*/
+    /** \fn bool read_slave_inputs(int slave, uint8_t *buffer, shm_frame_info *info)
+    \brief Copies only the input PDOs of \a slave (\a slave_entry(slave)->pdo_in_size bytes) to \a buffer.
+*/
+    /** \fn bool stage_outputs(int slave, const uint8_t *data)
+    \brief Stages the output PDOs of \a slave (\a slave_entry(slave)->pdo_out_size bytes).
+
+    From now on, the communicator sends the staged outputs of this slave, instead of the ones in the
+    \a process_data_buf, until \a release_outputs() is called.
+*/
+    /** \fn void release_outputs(int slave)
+    \brief Gives the output PDOs of \a slave back to the \a process_data_buf of the communicator.
+*/
+    /** \fn uint64_t cycle()
+    \brief The cycle of the latest input image. Can be polled to wait for a new one.
+*/
+    SharedMemoryClient();
+    ~SharedMemoryClient();
+    bool open(const char *name = SHM_DEFAULT_NAME);
+    void close();
+    bool is_open();
+    size_t image_size();
+    int slave_count();
+    const shm_slave_entry *slave_entry(int slave);
+    uint64_t cycle();
+    bool read_inputs(uint8_t *buffer, shm_frame_info *info);
+    bool read_slave_inputs(int slave, uint8_t *buffer, shm_frame_info *info);
+    bool stage_outputs(int slave, const uint8_t *data);
+    void release_outputs(int slave);
+};
+
+#endif /* SHM_CLIENT_LIB_H */
@@ -0,0 +1,119 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file shared_memory_layout.h
+   \brief Layout of the shared memory region of the EtherCAT Communicator.
+
+   Shared between the SharedMemoryMirror (inside ether_ros) and the SharedMemoryClient
+   library (inside other processes of the same host). Doesn't depend on ROS or the IgH Master.
+
+   The region consists of:
+   - The \a shm_header, with the sequence numbers, the cycle info and the per slave offsets
+   - The input image: a copy of the whole domain, updated once per cycle
+   - The output image: the output PDOs staged by the clients, in the same offsets as in the domain
+*/
+
+/*****************************************************************************/
+
+#ifndef SHM_LAYOUT_LIB_H
+#define SHM_LAYOUT_LIB_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define SHM_MAGIC 0x534f5245 // "EROS"
+#define SHM_VERSION 1
+#define SHM_MAX_SLAVES 64
+#define SHM_DEFAULT_NAME "/ether_ros"
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "The shared memory region needs lock-free 64-bit atomics"
+#endif
+
+/** \struct shm_slave_entry
+    \brief The offsets (from the start of an image) and sizes of the PDOs of a single slave.
+*/
+typedef struct shm_slave_entry
+{
+    uint32_t pdo_out_offset;
+    uint32_t pdo_out_size;
+    uint32_t pdo_in_offset;
+    uint32_t pdo_in_size;
+} shm_slave_entry;
+
+/** \struct shm_header
+    \brief The header at the start of the shared memory region.
+    \var shm_header::magic
+    \brief Always SHM_MAGIC.
+    \var shm_header::version
+    \brief The layout version (SHM_VERSION). Clients must refuse any other version.
+    \var shm_header::image_size
+    \brief The size of the input and of the output image (the domain size) in bytes.
+    \var shm_header::input_image_offset
+    \brief Offset of the input image from the start of the region.
+    \var shm_header::output_image_offset
+    \brief Offset of the output image from the start of the region.
+    \var shm_header::in_seq
+    \brief Sequence of the input image (seqlock): odd while the communicator writes it.
+    \var shm_header::cycle
+    \brief The cycle of the EtherCAT Communicator that produced the input image.
+    \var shm_header::timestamp_ns
+    \brief The (CLOCK_MONOTONIC) wakeup time of that cycle.
+    \var shm_header::working_counter
+    \brief The working counter of the first domain in that cycle.
+    \var shm_header::wc_state
+    \brief The working counter state (ec_wc_state_t) of the first domain in that cycle.
+    \var shm_header::out_seq
+    \brief Per slave sequence of the output image (seqlock), written by the client owning the slave.
+    0 means that no client stages outputs for the slave, odd that the client is writing them.
+    \var shm_header::slaves
+    \brief The per slave offsets, as given by EthercatSlave::get_pdo_out() and EthercatSlave::get_pdo_in().
+*/
+typedef struct shm_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t image_size;
+    uint32_t input_image_offset;
+    uint32_t output_image_offset;
+    uint32_t slave_count;
+    uint32_t reserved;
+    std::atomic<uint64_t> in_seq;
+    uint64_t cycle;
+    uint64_t timestamp_ns;
+    uint32_t working_counter;
+    uint32_t wc_state;
+    std::atomic<uint64_t> out_seq[SHM_MAX_SLAVES];
+    shm_slave_entry slaves[SHM_MAX_SLAVES];
+} shm_header;
+
+#endif /* SHM_LAYOUT_LIB_H */
@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file shared_memory_mirror.h
+   \brief Header file for the SharedMemoryMirror class.
+*/
+
+/*****************************************************************************/
+
+#ifndef SHM_MIRROR_LIB_H
+#define SHM_MIRROR_LIB_H
+
+#include <string>
+#include "ros/ros.h"
+#include "shared_memory_layout.h"
+
+/** \class SharedMemoryMirror
+    \brief Mirrors the domain in a POSIX shared memory region.
+
+    Optional (see the \a /ethercat_slaves/shared_memory/enabled parameter). In every cycle,
+    the EtherCAT Communicator copies the domain to the input image of the region, and the
+    outputs staged there by the clients to the domain. It gives to the processes of the
+    same host access to the PDOs without any socket traffic. See SharedMemoryClient.
+*/
+class SharedMemoryMirror
+{
+  private:
+    bool enabled_;
+    std::string name_;
+    size_t region_size_;
+    shm_header *header_;
+    uint8_t *input_image_;
+    uint8_t *output_image_;
+    uint8_t *scratch_;
+    uint64_t *applied_seq_; // the last out_seq of every slave, for feeding the output watchdog
+
+  public:
+    /** \fn void init(ros::NodeHandle &n)
+    \brief Initialization Method.
+
+    Creates and maps the region, and fills in its header. Must be called after the
+    domain has been fully configured. Does nothing if the mirror is not enabled.
+    \param n The ROS Node Handle
+*/
+    /** \fn void publish_inputs(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *domain_pd)
+    \brief Realtime side: copies the domain to the input image.
+
+    Called once per cycle, just after the domain has been processed.
+*/
+    /** \fn bool apply_outputs(uint8_t *domain_pd)
+    \brief Realtime side: copies the outputs staged by the clients to the domain.
+
+    Only the slaves owned by a client are copied, overriding the output image of the \a process_data_buf.
+    A slave whose outputs are being staged in this very moment keeps the ones already in the domain.
+    Every new staging of a slave feeds its output watchdog. \see OutputWatchdog
+    \retval true if the outputs of any slave were copied.
+*/
+    SharedMemoryMirror();
+    void init(ros::NodeHandle &n);
+    bool enabled();
+    void publish_inputs(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *domain_pd);
+    bool apply_outputs(uint8_t *domain_pd);
+};
+
+#endif /* SHM_MIRROR_LIB_H */
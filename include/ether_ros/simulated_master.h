@@ -0,0 +1,156 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file simulated_master.h
+   \brief Header file for the SimulatedMaster class.
+*/
+
+/*****************************************************************************/
+
+#ifndef SIMULATED_MASTER_LIB_H
+#define SIMULATED_MASTER_LIB_H
+
+#include <vector>
+#include "ethercat_master.h"
+
+/** \struct simulated_master_config
+    \brief The bus simulated by the SimulatedMaster, fetched from \a /ethercat_slaves/master/sim.
+    \var simulated_master_config::slaves
+    \brief The number of slaves in the (simulated) bus.
+    \var simulated_master_config::pdo_in_size
+    \brief The bytes of the input PDOs of every slave (registered with an index below 0x7000).
+    \var simulated_master_config::pdo_out_size
+    \brief The bytes of the output PDOs of every slave (registered with an index from 0x7000, the RxPDOs).
+    \var simulated_master_config::receive_ns
+    \brief The time spent in every receive(), as the IgH Master spends it in the ioctl and the network driver.
+    \var simulated_master_config::send_ns
+    \brief The time spent in every send().
+    \var simulated_master_config::jitter_ns
+    \brief A random time, up to this, added to every receive() and send().
+    \var simulated_master_config::loopback
+    \brief Whether the output PDOs of a slave come back as its input PDOs, in the next exchange of its domain.
+*/
+typedef struct simulated_master_config
+{
+    int slaves;
+    int pdo_in_size;
+    int pdo_out_size;
+    int receive_ns;
+    int send_ns;
+    int jitter_ns;
+    bool loopback;
+} simulated_master_config;
+
+/** \class SimulatedMaster
+    \brief An EthercatMaster backend without hardware.
+
+    Lays out the domains as the IgH Master does (the registered PDOs one after the other, the domains
+    one after the other, in a single process image) and exchanges them in memory: a domain queued
+    before a send() is complete (with the working counter of its PDOs) at the next process(). The
+    receive() and send() take the configured time (busy waiting, as a syscall would), so the timing
+    of the realtime loop can be measured on any machine.
+    The distributed clocks are perfect: the reference clock follows the application time. The register
+    requests succeed immediately, without any registers behind them.
+*/
+class SimulatedMaster : public EthercatMaster
+{
+  private:
+    typedef struct sim_domain
+    {
+        size_t size;
+        size_t offset;
+        unsigned int working_counter;
+        bool queued;
+        bool exchanged;
+    } sim_domain;
+    typedef struct sim_block
+    {
+        int domain;
+        size_t out_offset;
+        size_t in_offset;
+        size_t size;
+    } sim_block;
+    simulated_master_config config_;
+    std::vector<sim_domain> domains_;
+    std::vector<sim_block> loopback_;
+    std::vector<int> out_offsets_;
+    std::vector<int> in_offsets_;
+    std::vector<int> config_domains_;
+    int reg_requests_;
+    uint8_t *image_;
+    uint8_t *frame_;
+    size_t image_size_;
+    bool active_;
+    uint64_t app_time_;
+    uint32_t random_;
+    void busy_wait(int ns);
+
+  public:
+    /** \fn void init(const simulated_master_config &config)
+    \brief Initialization Method. Must be called before \a request().
+*/
+    SimulatedMaster();
+    ~SimulatedMaster();
+    void init(const simulated_master_config &config);
+    bool request(int index);
+    int info(ec_master_info_t *info);
+    void state(ec_master_state_t *state);
+    int create_domain();
+    size_t domain_size(int domain);
+    uint8_t *domain_data(int domain);
+    void domain_process(int domain);
+    void domain_state(int domain, ec_domain_state_t *state);
+    void domain_queue(int domain);
+    int slave_config(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code);
+    int reg_pdo_entry(int slave_config, uint16_t index, uint8_t subindex, int domain);
+    void config_dc(int slave_config, uint16_t assign_activate, uint32_t sync0_cycle, int32_t sync0_shift);
+    int create_reg_request(int slave_config, size_t size);
+    void reg_request_write(int request, uint16_t address, const uint8_t *data, size_t size);
+    ec_request_state_t reg_request_state(int request);
+    void slave_config_state(int slave_config, ec_slave_config_state_t *state);
+    int select_reference_clock(int slave_config);
+    int activate();
+    void receive();
+    void send();
+    void application_time(uint64_t time_ns);
+    int reference_clock_time(uint32_t *time);
+    void sync_reference_clock();
+    void sync_slave_clocks();
+    void sync_monitor_queue();
+    uint32_t sync_monitor_process();
+};
+
+/** \fn simulated_master_config load_simulated_master_config(ros::NodeHandle &n)
+    \brief Fetches the \a /ethercat_slaves/master/sim parameters. Without \a slaves, the bus has the configured slaves.
+*/
+simulated_master_config load_simulated_master_config(ros::NodeHandle &n);
+
+#endif /* SIMULATED_MASTER_LIB_H */
@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file startup_report.h
+   \brief The times of the phases of the startup, from the start of main() to the first cycle.
+
+   Every phase is marked once, when it's reached (the first cycle is marked by the realtime thread,
+   without locking or logging). The CycleStatsPublisher logs the marked phases, and sets them to the
+   \a /ethercat_slaves/startup/<phase>_ms parameters, for tracking the boot to first cycle latency.
+*/
+
+/*****************************************************************************/
+
+#ifndef STARTUP_REPORT_LIB_H
+#define STARTUP_REPORT_LIB_H
+
+#include <stdint.h>
+#include "ros/ros.h"
+
+/** \enum startup_phase
+    \brief The phases of the startup, in the order they are reached.
+*/
+typedef enum startup_phase
+{
+    STARTUP_PARAMETERS = 0, /**< the /ethercat_slaves and /pdo_layouts trees are fetched */
+    STARTUP_SLAVES,         /**< the slaves are configured */
+    STARTUP_READY,          /**< the publishers, the listeners and the services are ready */
+    STARTUP_ACTIVATED,      /**< the master is activated (at the first start of the EtherCAT Communicator) */
+    STARTUP_FIRST_CYCLE,    /**< the first cycle is sent */
+    STARTUP_PHASES
+} startup_phase;
+
+namespace startup_report
+{
+/** \fn void begin()
+    \brief Takes the start time, the zero of the phases. Called first thing in main().
+*/
+void begin();
+/** \fn void mark(startup_phase phase)
+    \brief Records the time \a phase is reached. Only the first mark of a phase counts. Realtime safe.
+*/
+void mark(startup_phase phase);
+/** \fn bool report(ros::NodeHandle &n)
+    \brief Logs the phases marked since the last report, and sets their parameters.
+
+    Single caller (the telemetry thread).
+    \retval true when every phase has been reported.
+*/
+bool report(ros::NodeHandle &n);
+} // namespace startup_report
+
+#endif /* STARTUP_REPORT_LIB_H */
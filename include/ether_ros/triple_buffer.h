@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file triple_buffer.h
+   \brief Header file for the TripleBuffer class.
+*/
+
+/*****************************************************************************/
+
+#ifndef TRIPLE_BUFFER_LIB_H
+#define TRIPLE_BUFFER_LIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/** \class TripleBuffer
+    \brief A wait-free single-producer/single-consumer triple buffer of byte images.
+
+    Used for handing over fixed size images between two threads, without any of them
+    ever blocking or spinning on the other. The producer fills the \a write_buffer() and
+    calls \a publish(). The consumer calls \a update() and, if it returns true, the
+    \a read_buffer() holds the latest published image. Intermediate images may be
+    dropped, but an image is never torn. All the memory is allocated in \a init().
+*/
+class TripleBuffer
+{
+  private:
+    static const uint8_t FRESH_BIT = 0x04;
+    static const uint8_t INDEX_MASK = 0x03;
+    uint8_t *buffers_[3];
+    size_t size_;
+    std::atomic<uint8_t> middle_;
+    uint8_t back_;
+    uint8_t front_;
+
+  public:
+    /** \fn void init(size_t size)
+    \brief Initialization Method.
+
+    Allocates (and prefaults) the three buffers of \a size bytes each.
+    Must be called before any of the threads use the object.
+    \param size The size of every image in bytes.
+*/
+    /** \fn uint8_t *write_buffer()
+    \brief Producer side: the buffer to write the next image into.
+*/
+    /** \fn void publish()
+    \brief Producer side: makes the image in \a write_buffer() the latest one.
+
+    After the call, \a write_buffer() points to another buffer, whose contents are stale.
+*/
+    /** \fn bool update()
+    \brief Consumer side: picks up the latest published image, if there is a new one.
+
+    \retval true if \a read_buffer() now holds a newly published image.
+*/
+    /** \fn const uint8_t *read_buffer()
+    \brief Consumer side: the last image picked up by \a update().
+*/
+    TripleBuffer();
+    ~TripleBuffer();
+    void init(size_t size);
+    size_t size();
+    uint8_t *write_buffer();
+    void publish();
+    bool update();
+    const uint8_t *read_buffer();
+};
+
+#endif /* TRIPLE_BUFFER_LIB_H */
@@ -34,7 +34,7 @@
    \brief Utilities header file.
 
    Includes:
-   - Functions for processing EtherCAT PDOs
+   - Functions for processing EtherCAT PDOs (inline, \see pdo_accessors.h)
    - Function for insisting write to file
    - Function for safe ascii to integer conversion
    - Function for adding two timespec structs
@@ -51,16 +51,28 @@
     \param time2
     \brief The second timespec struct, to be added to the first one.
 */
-/** \fn void check_domain1_state(void)
-    \brief Checks the domain1 state variable.
+/** \fn void copy_process_data_buffer_to_buf(uint8_t *buffer, uint64_t cycle)
+    \brief Copies the output PDOs of every slave, from the latest committed output image to \a buffer,
+    and applies the commands scheduled until \a cycle.
 
-    The checks are for the working counter states and values.
+    Only the PDOs changed since the previous cycle are copied. \see OutputImage::copy_to
 
+    Doesn't lock: it must only be called from the EtherCAT Communicator thread. \see OutputImage
+    \param buffer The destination buffer (normally the domain1_pd).
+    \param cycle The id of the current cycle.
+*/
+/** \fn void clear_outputs(uint8_t *buffer)
+    \brief Fills the output PDOs of every slave in \a buffer with its safe outputs (zeros, unless configured).
+
+    \see OutputWatchdog
+
+    \param buffer The destination buffer (normally the domain1_pd).
 */
 /** \fn check_master_state(void)
     \brief Checks the master state variable.
 
-    The checks are for AL states and slaves responding to the master.
+    Realtime side: records the AL states, the slaves responding to the master and the link
+    in the \a health_monitor, which logs their changes from its own thread. \see HealthMonitor
 */
 /** \fn bool process_input_bit(uint8_t *data_ptr, uint8_t index, uint8_t subindex)
     \brief Returns bit indexed with \a index,\a subindex of the \a data_ptr buffer.
@@ -75,7 +87,7 @@
     \param data_ptr The buffer to get the data
     \param index The unsigned byte index in the buffer
 */
-/** \fn int8_t process_input_sint8(uint8_t *data_ptr, uint8_t index)
+/** \fn int8_t process_input_int8(uint8_t *data_ptr, uint8_t index)
     \brief Returns signed byte indexed with \a index of the \a data_ptr buffer.
 
     \param data_ptr The buffer to get the data
@@ -87,18 +99,36 @@
     \param data_ptr The buffer to get the data
     \param index The unsigned 16-bit integer index in the buffer
 */
-/** \fn int16_t process_input_sint16(uint8_t *data_ptr, uint8_t index)
+/** \fn int16_t process_input_int16(uint8_t *data_ptr, uint8_t index)
     \brief Returns signed 16-bit integer indexed with \a index of the \a data_ptr buffer.
 
     \param data_ptr The buffer to get the data
     \param index The signed 16-bit integer index in the buffer
 */
-/** \fn int32_t process_input_sint32(uint8_t *data_ptr, uint8_t index)
+/** \fn int32_t process_input_int32(uint8_t *data_ptr, uint8_t index)
     \brief Returns signed 32-bit integer indexed with \a index of the \a data_ptr buffer.
 
     \param data_ptr The buffer to get the data
     \param index The signed 32-bit integer index in the buffer
 */
+/** \fn uint32_t process_input_uint32(uint8_t *data_ptr, uint8_t index)
+    \brief Returns unsigned 32-bit integer indexed with \a index of the \a data_ptr buffer.
+
+    \param data_ptr The buffer to get the data
+    \param index The unsigned 32-bit integer index in the buffer
+*/
+/** \fn int64_t process_input_int64(uint8_t *data_ptr, uint8_t index)
+    \brief Returns signed 64-bit integer indexed with \a index of the \a data_ptr buffer.
+
+    \param data_ptr The buffer to get the data
+    \param index The signed 64-bit integer index in the buffer
+*/
+/** \fn uint64_t process_input_uint64(uint8_t *data_ptr, uint8_t index)
+    \brief Returns unsigned 64-bit integer indexed with \a index of the \a data_ptr buffer.
+
+    \param data_ptr The buffer to get the data
+    \param index The unsigned 64-bit integer index in the buffer
+*/
 /** \fn ssize_t insist_write(int fd, const char *buf, size_t count)
     \brief Writes to a \a file descriptor, persistently
 
@@ -153,26 +183,55 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string>
+#include "pdo_accessors.h"
 
 namespace utilities
 {
-bool process_input_bit(uint8_t *data_ptr, uint8_t index, uint8_t subindex);
+// the inline wrappers of the accessors, kept for the existing callers
+inline bool process_input_bit(uint8_t *data_ptr, uint8_t index, uint8_t subindex)
+{
+    return pdo_read_bit(data_ptr, index, subindex);
+}
 
-uint8_t process_input_uint8(uint8_t *data_ptr, uint8_t index);
+inline uint8_t process_input_uint8(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<uint8_t>(data_ptr, index);
+}
 
-int8_t process_input_int8(uint8_t *data_ptr, uint8_t index);
+inline int8_t process_input_int8(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<int8_t>(data_ptr, index);
+}
 
-uint16_t process_input_uint16(uint8_t *data_ptr, uint8_t index);
+inline uint16_t process_input_uint16(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<uint16_t>(data_ptr, index);
+}
 
-int16_t process_input_int16(uint8_t *data_ptr, uint8_t index);
+inline int16_t process_input_int16(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<int16_t>(data_ptr, index);
+}
 
-int32_t process_input_int32(uint8_t *data_ptr, uint8_t index);
+inline int32_t process_input_int32(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<int32_t>(data_ptr, index);
+}
 
-uint32_t process_input_uint32(uint8_t *data_ptr, uint8_t index);
+inline uint32_t process_input_uint32(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<uint32_t>(data_ptr, index);
+}
 
-int64_t process_input_int64(uint8_t *data_ptr, uint8_t index);
+inline int64_t process_input_int64(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<int64_t>(data_ptr, index);
+}
 
-uint64_t process_input_uint64(uint8_t *data_ptr, uint8_t index);
+inline uint64_t process_input_uint64(uint8_t *data_ptr, uint8_t index)
+{
+    return pdo_read<uint64_t>(data_ptr, index);
+}
 
 ssize_t insist_write(int fd, const char *buf, size_t count);
 
@@ -180,11 +239,11 @@ int safe_atoi(const char *s, int *val);
 
 struct timespec timespec_add(struct timespec time1, struct timespec time2);
 
-void check_domain1_state(void);
-
 void check_master_state(void);
 
-void copy_process_data_buffer_to_buf(uint8_t *buffer);
+void copy_process_data_buffer_to_buf(uint8_t *buffer, uint64_t cycle);
+
+void clear_outputs(uint8_t *buffer);
 
 std::string &ltrim(std::string &str, const std::string &chars = "\t\n\v\f\r ");
 
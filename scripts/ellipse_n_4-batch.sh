@@ -0,0 +1,23 @@
+#! /bin/bash
+# The same variables as ellipse_n_4-v2.sh, written to every slave (slave_id: 255) in a single message:
+# they reach the slaves in the same cycle.
+# type: 0 bool, 1 uint8, 2 int8, 3 uint16, 4 int16, 5 uint32, 6 int32, 7 uint64, 8 int64
+rostopic pub -1 /pdo_listener_batch ether_ros/ModifyPDOVariablesBatch "entries: [
+  {slave_id: 255, offset: 0, bit: 4, type: 0, value: 1},
+  {slave_id: 255, offset: 1, bit: 0, type: 2, value: 3},
+  {slave_id: 255, offset: 6, bit: 0, type: 3, value: 20},
+  {slave_id: 255, offset: 12, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 14, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 16, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 18, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 20, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 22, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 24, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 26, bit: 0, type: 4, value: 590},
+  {slave_id: 255, offset: 28, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 30, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 32, bit: 0, type: 4, value: 100},
+  {slave_id: 255, offset: 34, bit: 0, type: 4, value: 0},
+  {slave_id: 255, offset: 36, bit: 0, type: 4, value: 0}]"
+
+# rosservice call /ethercat_communicatord "mode: 'start'"
@@ -0,0 +1,109 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*
+'''
+Memory mapped reader and CSV converter of the binary record files of ether_ros
+(/ethercat_slaves/recorder in config/ethercat_slaves.yaml).
+
+The layout of the files is described in include/ether_ros/pdo_record_layout.h.
+The records are not copied: every variable is a numpy view (or a cheap conversion) of
+the mapped file, so a recording of hours is opened instantly.
+
+Usage as a converter (one csv per slave, like the pdo_in_slave_* topics did):
+    pdo_record.py file.rec [output_directory]
+
+Usage as a module:
+    from pdo_record import PDORecord
+    rec = PDORecord('/tmp/ether_ros.rec')
+    knee = rec.variable(0, 'in', 'knee_angle')  # numpy array, one value per cycle
+'''
+from __future__ import print_function
+import mmap
+import os
+import struct
+import sys
+import numpy as np
+
+PDO_RECORD_MAGIC = 0x43455245
+PDO_RECORD_VERSION = 2
+PDO_RECORD_NAME_SIZE = 32
+HEADER_FORMAT = '<8I3Qq2Q'
+ENTRY_SIZE = 24  # cycle, timestamp_ns, period_ns (and 4 reserved bytes)
+SLAVE_FORMAT = '<%ds4I' % PDO_RECORD_NAME_SIZE
+TYPES = {'uint8': '<u1', 'int8': '<i1', 'uint16': '<u2', 'int16': '<i2',
+         'uint32': '<u4', 'int32': '<i4', 'uint64': '<u8', 'int64': '<i8'}
+
+
+class PDORecord(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, version, self.header_size, self.image_size, self.record_size, slave_count,
+         self.period_ns, layout_size, slaves_offset, layout_offset, self.data_offset,
+         self.clock_offset_ns, records, self.dropped) = struct.unpack_from(HEADER_FORMAT, self.mm, 0)
+        if magic != PDO_RECORD_MAGIC or version != PDO_RECORD_VERSION:
+            raise ValueError('%s is not a record file of version %d' % (path, PDO_RECORD_VERSION))
+        # a file still being recorded has more (zero) pages than records
+        self.records = min(records, (len(self.mm) - self.data_offset) // self.record_size)
+
+        self.slaves = []
+        for i in range(slave_count):
+            name, out_offset, out_size, in_offset, in_size = struct.unpack_from(
+                SLAVE_FORMAT, self.mm, slaves_offset + i * struct.calcsize(SLAVE_FORMAT))
+            self.slaves.append({'name': name.rstrip(b'\0').decode(), 'out': out_offset, 'out_size': out_size,
+                                'in': in_offset, 'in_size': in_size, 'variables': {'in': [], 'out': []}})
+        layout = self.mm[layout_offset:layout_offset + layout_size].decode()
+        for line in layout.splitlines():
+            slave, direction, name, type_name, offset, bit = line.split()
+            self.slaves[int(slave)]['variables'][direction].append((name, type_name, int(offset), int(bit)))
+
+        # every record: cycle, timestamp, period and a copy of the whole domain
+        self.frames = np.ndarray((self.records, self.record_size), dtype=np.uint8, buffer=self.mm,
+                                 offset=self.data_offset)
+        entries = np.ndarray((self.records, self.record_size // 8), dtype='<u8', buffer=self.mm,
+                             offset=self.data_offset)
+        self.cycle = entries[:, 0]
+        self.timestamp_ns = entries[:, 1]
+        # the period of every record: it changes with ethercat_communicatord period
+        self.cycle_period_ns = (entries[:, 2] & 0xffffffff).astype(np.uint32)
+
+    def wall_time(self):
+        '''The wall clock time (s) of every record.'''
+        return (self.timestamp_ns.astype(np.int64) + self.clock_offset_ns) / 1e9
+
+    def missed_cycles(self):
+        '''The number of cycles missing between the records (the snapshots dropped while recording).'''
+        return int(np.count_nonzero(np.diff(self.cycle.astype(np.int64)) - 1)) if self.records else 0
+
+    def variable(self, slave, direction, name):
+        '''The values of a variable of a slave ("in" or "out"), one per record.'''
+        for var_name, type_name, offset, bit in self.slaves[slave]['variables'][direction]:
+            if var_name != name:
+                continue
+            start = ENTRY_SIZE + self.slaves[slave][direction] + offset
+            if type_name == 'bool':
+                return (self.frames[:, start] >> bit) & 1
+            size = np.dtype(TYPES[type_name]).itemsize
+            return self.frames[:, start:start + size].copy().view(TYPES[type_name])[:, 0]
+        raise KeyError('slave %d has no %s variable %s' % (slave, direction, name))
+
+    def to_csv(self, directory):
+        '''Writes a csv per slave, with the cycle, the time and every input variable.'''
+        for i, slave in enumerate(self.slaves):
+            names = [v[0] for v in slave['variables']['in']]
+            columns = [self.cycle, self.wall_time()] + [self.variable(i, 'in', n) for n in names]
+            path = os.path.join(directory, 'pdo_in_slave_%d.csv' % i)
+            np.savetxt(path, np.column_stack(columns), delimiter=',', fmt=['%d', '%.9f'] + ['%d'] * len(names),
+                       header=','.join(['cycle', 'time'] + names), comments='')
+            print('%s: %d records of %s' % (path, self.records, slave['name']))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) not in (2, 3):
+        print('usage: pdo_record.py file.rec [output_directory]')
+        sys.exit(1)
+    record = PDORecord(sys.argv[1])
+    print('%d records, %d dropped, %d cycles missing' % (record.records, record.dropped, record.missed_cycles()))
+    output = sys.argv[2] if len(sys.argv) == 3 else '.'
+    if not os.path.isdir(output):
+        os.makedirs(output)
+    record.to_csv(output)
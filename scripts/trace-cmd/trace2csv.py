@@ -9,6 +9,7 @@ csv_file_name = sys.argv[1].replace(".txt",".csv")
 print("Name of the output csv file: " + csv_file_name)
 
 function_stack = []
+last_marker = None
 output_csv_list = []
 with open(os.path.abspath(trace_file_path+trace_file_name), 'r') as trace_data:
     lines = trace_data.readlines()
@@ -50,6 +51,13 @@ for line in lines:
                 output_csv_list.append(line_list[0:6])
             else:
                 print("Unsupported event:{}".format(line_list))
+        # the phases of the realtime cycle (ETHER_ROS_TRACE): a phase lasts until the next marker
+        if(line_list[3] == "print:" and len(line_list) > 7 and line_list[5] == "ether_ros"):
+            time_us = float(line_list[2].strip(":")) * 1e6
+            if(last_marker is not None):
+                output_csv_list[last_marker[0]][5] = "{:.3f}".format(time_us - last_marker[1])
+            output_csv_list.append([line_list[0], line_list[1], line_list[2], "marker", line_list[6], "-"])
+            last_marker = (len(output_csv_list) - 1, time_us)
 
 print(output_csv_list[:10])
 columns = ["Process","CPU","Time", "TypeOfTrace", "Function", "Duration"]
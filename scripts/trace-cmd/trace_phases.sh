@@ -0,0 +1,7 @@
+#!/bin/bash
+# Records the phases of the realtime cycle (ether_ros built with -DETHER_ROS_TRACE=ON), along with the
+# scheduler events of the ether_ros threads. Every "ether_ros <phase> <cycle>" marker starts a phase,
+# which lasts until the next marker: open the trace.dat with kernelshark, or convert it with
+# "trace-cmd report > phases.txt" and "trace2csv.py phases.txt".
+ether_ros_pids=$(for i in `ps -e -T | grep ether_ros | awk '{print  $2}'`; do echo "-P $i";done)
+sudo trace-cmd record -e ftrace:print -e sched:sched_switch -e sched:sched_wakeup $ether_ros_pids
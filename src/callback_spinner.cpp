@@ -0,0 +1,146 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file callback_spinner.cpp
+   \brief Implementation of CallbackSpinner class.
+
+   Used for serving the command path (\a pdo_listener, \a pdo_listener_batch, \a pdo_command) and the telemetry path
+   (\a pdo_out_timer, \a cycle_stats) from separate callback queues and threads.
+   More than one command thread is safe: the immediate commands write through the writer lock of the
+   OutputImage, and the scheduled ones are built and scheduled under the schedule mutex of the PDOOutListener.
+*/
+
+/*****************************************************************************/
+
+#include "callback_spinner.h"
+#include "ether_ros.h"
+#include <string.h>
+
+void CallbackSpinner::init(ros::NodeHandle &n, const std::string &name, int default_threads)
+{
+    std::string root = "/ethercat_slaves/callbacks/" + name;
+    std::vector<int> cpus;
+    int rt_cpu, cpus_count = sysconf(_SC_NPROCESSORS_CONF);
+
+    name_ = name;
+    n.param(root + "/threads", threads_count_, default_threads);
+    n.param(root + "/cpus", cpus, std::vector<int>());
+    n.param("/ethercat_slaves/realtime/cpu", rt_cpu, 3);
+    if (threads_count_ < 1)
+    {
+        ROS_FATAL("%s/threads must be at least 1\n", root.c_str());
+        exit(1);
+    }
+
+    CPU_ZERO(&cpuset_);
+    if (cpus.empty())
+    {
+        for (int cpu = 0; cpu < cpus_count; cpu++)
+            CPU_SET(cpu, &cpuset_);
+    }
+    for (size_t i = 0; i < cpus.size(); i++)
+    {
+        if (cpus[i] < 0 || cpus[i] >= cpus_count)
+        {
+            ROS_FATAL("%s/cpus: CPU %d doesn't exist (%d CPUs)\n", root.c_str(), cpus[i], cpus_count);
+            exit(1);
+        }
+        CPU_SET(cpus[i], &cpuset_);
+    }
+    // the isolated core belongs to the realtime thread only
+    if (rt_cpu >= 0 && CPU_ISSET(rt_cpu, &cpuset_))
+    {
+        if (!cpus.empty())
+            ROS_WARN("%s/cpus includes the realtime CPU %d: it's left out\n", root.c_str(), rt_cpu);
+        CPU_CLR(rt_cpu, &cpuset_);
+    }
+    if (!CPU_COUNT(&cpuset_))
+    {
+        ROS_FATAL("%s/cpus: no CPU left, besides the realtime one\n", root.c_str());
+        exit(1);
+    }
+
+    node_handle_ = ros::NodeHandle();
+    node_handle_.setCallbackQueue(&queue_);
+    ROS_INFO("Callbacks %s: %d threads on %d CPUs\n", name_.c_str(), threads_count_, CPU_COUNT(&cpuset_));
+}
+
+ros::NodeHandle &CallbackSpinner::node_handle()
+{
+    return node_handle_;
+}
+
+void CallbackSpinner::start()
+{
+    pthread_attr_t attr;
+    int ret;
+
+    threads_.resize(threads_count_);
+    pthread_attr_init(&attr);
+    ret = pthread_attr_setaffinity_np(&attr, sizeof(cpuset_), &cpuset_);
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_attr_setaffinity_np");
+    }
+    for (int i = 0; i < threads_count_; i++)
+    {
+        ret = pthread_create(&threads_[i], &attr, &CallbackSpinner::run, this);
+        if (ret != 0)
+        {
+            handle_error_en(ret, "pthread_create");
+        }
+    }
+    pthread_attr_destroy(&attr);
+}
+
+void CallbackSpinner::join()
+{
+    for (size_t i = 0; i < threads_.size(); i++)
+        pthread_join(threads_[i], NULL);
+    threads_.clear();
+}
+
+const cpu_set_t &CallbackSpinner::cpuset() const
+{
+    return cpuset_;
+}
+
+void *CallbackSpinner::run(void *arg)
+{
+    CallbackSpinner *spinner = (CallbackSpinner *)arg;
+
+    while (ros::ok())
+    {
+        // the timeout bounds the reaction to the shutdown of the node
+        spinner->queue_.callAvailable(ros::WallDuration(0.1));
+    }
+    return NULL;
+}
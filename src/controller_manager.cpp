@@ -0,0 +1,310 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file controller_manager.cpp
+   \brief Implementation of the ControllerManager class.
+
+   The controllers are created and initialized at startup; on the realtime thread, they are only
+   dispatched, timed and checked. Their statistics are atomics, read by the HealthMonitor.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "controller_manager.h"
+#include "pdo_accessors.h"
+#include "ether_ros.h"
+
+#ifdef ETHER_ROS_RT_CHECKS
+#include <stdlib.h>
+#include <new>
+#include <sys/resource.h>
+
+// the allocations of this thread, counted while one of its controllers runs
+static __thread bool rt_checks_armed = false;
+static __thread uint64_t rt_checks_allocations = 0;
+
+void *operator new(size_t size)
+{
+    if (rt_checks_armed)
+        rt_checks_allocations++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (rt_checks_armed && ptr)
+        rt_checks_allocations++;
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+// the voluntary context switches of this thread: a controller which waited on anything blocked
+static uint64_t voluntary_context_switches()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_nvcsw;
+}
+#endif
+
+static int controller_int(XmlRpc::XmlRpcValue &entry, const std::string &name, const char *key, int default_value)
+{
+    if (!entry.hasMember(key))
+        return default_value;
+    if (entry[key].getType() != XmlRpc::XmlRpcValue::TypeInt)
+    {
+        ROS_FATAL("Controller %s: /ethercat_slaves/controllers: %s must be an integer\n", name.c_str(), key);
+        exit(1);
+    }
+    return static_cast<int &>(entry[key]);
+}
+
+static std::string controller_string(XmlRpc::XmlRpcValue &entry, const char *key)
+{
+    if (!entry.hasMember(key) || entry[key].getType() != XmlRpc::XmlRpcValue::TypeString)
+    {
+        ROS_FATAL("/ethercat_slaves/controllers: every controller must have a %s string\n", key);
+        exit(1);
+    }
+    return static_cast<std::string &>(entry[key]);
+}
+
+// two claims of the same bytes (or of the same bit)
+static bool claims_overlap(const rt_variable &a, const rt_variable &b)
+{
+    if (a.type == PDO_BOOL && b.type == PDO_BOOL)
+        return a.offset == b.offset && a.bit == b.bit;
+    return a.offset < b.offset + pdo_type_size(b.type) && b.offset < a.offset + pdo_type_size(a.type);
+}
+
+ControllerManager::ControllerManager() : outputs_(NULL)
+{
+}
+
+void ControllerManager::load(ros::NodeHandle &n, XmlRpc::XmlRpcValue &entry, size_t index)
+{
+    rt_controller_slot *slot = new rt_controller_slot();
+
+    if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+        ROS_FATAL("/ethercat_slaves/controllers: entry %lu must be a map\n", index);
+        exit(1);
+    }
+    slot->name = controller_string(entry, "name");
+    slot->type = controller_string(entry, "type");
+    slot->divider = controller_int(entry, slot->name, "divider", 1);
+    slot->phase = controller_int(entry, slot->name, "phase", 0);
+    slot->budget_ns = controller_int(entry, slot->name, "budget_ns", 0);
+    slot->disable_on_overrun = true;
+    if (entry.hasMember("disable_on_overrun"))
+    {
+        if (entry["disable_on_overrun"].getType() != XmlRpc::XmlRpcValue::TypeBoolean)
+        {
+            ROS_FATAL("Controller %s: /ethercat_slaves/controllers: disable_on_overrun must be a boolean\n", slot->name.c_str());
+            exit(1);
+        }
+        slot->disable_on_overrun = static_cast<bool &>(entry["disable_on_overrun"]);
+    }
+    if (slot->divider < 1 || slot->phase < 0 || slot->phase >= slot->divider || slot->budget_ns < 0)
+    {
+        ROS_FATAL("Controller %s: invalid divider %d, phase %d or budget_ns %ld\n", slot->name.c_str(),
+                  slot->divider, slot->phase, slot->budget_ns);
+        exit(1);
+    }
+
+    slot->controller = rt_controllers::create(slot->type);
+    if (!slot->controller)
+    {
+        std::vector<std::string> types = rt_controllers::types();
+        std::string registered;
+        for (size_t i = 0; i < types.size(); i++)
+            registered += (i ? ", " : "") + types[i];
+        ROS_FATAL("Controller %s: no controller type %s (registered: %s)\n", slot->name.c_str(),
+                  slot->type.c_str(), registered.c_str());
+        exit(1);
+    }
+    slot->io.controller_ = slot->name;
+    slot->io.outputs_ = outputs_;
+    if (!slot->controller->init(n, slot->io, entry))
+    {
+        ROS_FATAL("Controller %s: failed to initialize the %s controller\n", slot->name.c_str(), slot->type.c_str());
+        exit(1);
+    }
+
+    // a variable is driven by a single controller
+    for (size_t i = 0; i < slot->io.claims_.size(); i++)
+    {
+        for (size_t j = 0; j < slots_.size(); j++)
+        {
+            for (size_t k = 0; k < slots_[j]->io.claims_.size(); k++)
+            {
+                if (claims_overlap(slot->io.claims_[i], slots_[j]->io.claims_[k]))
+                {
+                    ROS_FATAL("Controller %s: an output variable is already claimed by the controller %s\n",
+                              slot->name.c_str(), slots_[j]->name.c_str());
+                    exit(1);
+                }
+            }
+        }
+    }
+    slot->ran = false;
+    slot->enabled.store(true, std::memory_order_relaxed);
+    slot->runs.store(0, std::memory_order_relaxed);
+    slot->overruns.store(0, std::memory_order_relaxed);
+    slot->violations.store(0, std::memory_order_relaxed);
+    slot->last_exec_ns.store(0, std::memory_order_relaxed);
+    slot->max_exec_ns.store(0, std::memory_order_relaxed);
+    slots_.push_back(slot);
+    ROS_INFO("Controller %s (%s): every %d cycles (phase %d), %lu output variables\n", slot->name.c_str(),
+             slot->type.c_str(), slot->divider, slot->phase, slot->io.claims_.size());
+}
+
+void ControllerManager::init(ros::NodeHandle &n, XmlRpc::XmlRpcValue &params)
+{
+    if (!params.hasMember("controllers"))
+        return;
+    XmlRpc::XmlRpcValue &controllers = params["controllers"];
+    if (controllers.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+        ROS_FATAL("/ethercat_slaves/controllers must be a list\n");
+        exit(1);
+    }
+    outputs_ = new uint8_t[total_process_data];
+    memset(outputs_, 0, total_process_data);
+    for (int i = 0; i < controllers.size(); i++)
+        load(n, controllers[i], i);
+}
+
+void ControllerManager::apply_outputs(const rt_controller_slot *slot, uint8_t *domain_pd)
+{
+    const std::vector<rt_variable> &claims = slot->io.claims_;
+
+    for (size_t i = 0; i < claims.size(); i++)
+    {
+        const rt_variable &var = claims[i];
+        if (var.type == PDO_BOOL)
+            utilities::pdo_write_bit(domain_pd, var.offset, var.bit, utilities::pdo_read_bit(outputs_, var.offset, var.bit));
+        else
+            memcpy(domain_pd + var.offset, outputs_ + var.offset, pdo_type_size(var.type));
+    }
+}
+
+bool ControllerManager::update(uint64_t cycle, uint64_t time_ns, uint8_t *domain_pd)
+{
+    bool released = false;
+
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        rt_controller_slot *slot = slots_[i];
+        struct timespec start_time, end_time;
+
+        if (!slot->enabled.load(std::memory_order_relaxed))
+            continue;
+        if (cycle % slot->divider == (uint64_t)slot->phase)
+        {
+            int period_ns = PERIOD_NS.load(std::memory_order_relaxed);
+            slot->io.inputs_ = domain_pd;
+            slot->io.cycle = cycle;
+            slot->io.time_ns = time_ns;
+            slot->io.period_ns = (uint64_t)period_ns * slot->divider;
+
+            clock_gettime(CLOCK_TO_USE, &start_time);
+#ifdef ETHER_ROS_RT_CHECKS
+            uint64_t context_switches = voluntary_context_switches();
+            rt_checks_allocations = 0;
+            rt_checks_armed = true;
+#endif
+            slot->controller->update(slot->io);
+#ifdef ETHER_ROS_RT_CHECKS
+            rt_checks_armed = false;
+            bool violation = rt_checks_allocations || voluntary_context_switches() != context_switches;
+#else
+            bool violation = false;
+#endif
+            clock_gettime(CLOCK_TO_USE, &end_time);
+
+            uint64_t exec_ns = DIFF_NS(start_time, end_time);
+            int64_t budget_ns = slot->budget_ns ? slot->budget_ns : period_ns / 10;
+            slot->runs.store(slot->runs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            slot->last_exec_ns.store(exec_ns, std::memory_order_relaxed);
+            if (exec_ns > slot->max_exec_ns.load(std::memory_order_relaxed))
+                slot->max_exec_ns.store(exec_ns, std::memory_order_relaxed);
+            bool overrun = (int64_t)exec_ns > budget_ns;
+            if (overrun)
+                slot->overruns.store(slot->overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (violation)
+                slot->violations.store(slot->violations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (violation || (overrun && slot->disable_on_overrun))
+            {
+                // its variables go back to the output image, in the next copy
+                slot->enabled.store(false, std::memory_order_relaxed);
+                released = true;
+                continue;
+            }
+            slot->ran = true;
+            for (size_t j = 0; j < slot->io.slaves_.size(); j++)
+                output_watchdog.feed(slot->io.slaves_[j]);
+        }
+        if (slot->ran)
+            apply_outputs(slot, domain_pd);
+    }
+    return released;
+}
+
+bool ControllerManager::enabled() const
+{
+    return !slots_.empty();
+}
+
+size_t ControllerManager::size() const
+{
+    return slots_.size();
+}
+
+const rt_controller_slot &ControllerManager::slot(size_t index) const
+{
+    return *slots_[index];
+}
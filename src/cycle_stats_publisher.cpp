@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file cycle_stats_publisher.cpp
+   \brief Implementation of CycleStatsPublisher class.
+
+   Used for publishing the timing statistics of the realtime thread to the \a /cycle_stats topic,
+   while it runs.
+*/
+
+/*****************************************************************************/
+
+#include "cycle_stats_publisher.h"
+#include "ether_ros/CycleStats.h"
+#include "ether_ros.h"
+#include "startup_report.h"
+
+void CycleStatsPublisher::init(ros::NodeHandle &n)
+{
+    double rate;
+
+    n.param("/ethercat_slaves/cycle_stats_rate", rate, 1.0);
+    if (rate <= 0)
+    {
+        ROS_FATAL("/ethercat_slaves/cycle_stats_rate must be positive\n");
+        exit(1);
+    }
+
+    // the startup report is logged from here, as the phases are reached
+    n_ = n;
+    startup_reported_ = false;
+
+    cycle_stats_pub_ = n.advertise<ether_ros::CycleStats>("cycle_stats", 10);
+    if (!cycle_stats_pub_)
+    {
+        ROS_FATAL("Unable to start publisher in CycleStatsPublisher\n");
+        exit(1);
+    }
+    cycle_stats_timer_ = n.createTimer(ros::Duration(1.0 / rate), &CycleStatsPublisher::timer_callback, this);
+    if (!cycle_stats_timer_)
+    {
+        ROS_FATAL("Unable to start the timer of CycleStatsPublisher\n");
+        exit(1);
+    }
+}
+
+void CycleStatsPublisher::fill_latency_stats(const LatencyHistogram &histogram, ether_ros::LatencyStats &stats)
+{
+    histogram.snapshot(&snapshot_);
+    stats.count = snapshot_.count;
+    stats.min = snapshot_.min;
+    stats.mean = snapshot_.count ? snapshot_.sum / snapshot_.count : 0;
+    stats.p50 = LatencyHistogram::percentile(snapshot_, 50.0);
+    stats.p90 = LatencyHistogram::percentile(snapshot_, 90.0);
+    stats.p99 = LatencyHistogram::percentile(snapshot_, 99.0);
+    stats.p999 = LatencyHistogram::percentile(snapshot_, 99.9);
+    stats.max = snapshot_.max;
+}
+
+void CycleStatsPublisher::timer_callback(const ros::TimerEvent &event)
+{
+    ether_ros::CycleStats cycle_stats;
+
+    if (!startup_reported_)
+        startup_reported_ = startup_report::report(n_);
+    cycle_stats.header.stamp = ros::Time::now();
+    fill_latency_stats(EthercatCommunicator::wakeup_latency_histogram(), cycle_stats.wakeup_latency);
+    fill_latency_stats(EthercatCommunicator::period_histogram(), cycle_stats.period);
+    fill_latency_stats(EthercatCommunicator::exec_histogram(), cycle_stats.exec);
+    cycle_stats.cycles = cycle_stats.exec.count;
+
+    const DCServo &dc_servo = EthercatCommunicator::dc_servo();
+    cycle_stats.dc_mode = dc_servo.mode();
+    cycle_stats.dc_diff_ns = dc_servo.diff_ns();
+    cycle_stats.dc_adjust_ns = dc_servo.adjust_ns();
+    cycle_stats.dc_locked = dc_servo.locked();
+    cycle_stats.dc_lock_losses = dc_servo.lock_losses();
+    fill_latency_stats(dc_servo.diff_histogram(), cycle_stats.dc_diff_abs);
+    cycle_stats.system_time_errors = EthercatCommunicator::system_time_errors();
+    cycle_stats.overrun_policy = EthercatCommunicator::overrun_policy();
+    cycle_stats.overruns = EthercatCommunicator::overruns();
+    cycle_stats.missed_cycles = EthercatCommunicator::missed_cycles();
+    cycle_stats.overrun_fault = EthercatCommunicator::overrun_fault();
+    fill_latency_stats(output_image.command_latency_histogram(), cycle_stats.command_latency);
+    cycle_stats.applied_commands = output_image.applied_commands();
+    cycle_stats.late_commands = output_image.late_commands();
+    cycle_stats.domains.resize(domains_count);
+    for (int i = 0; i < domains_count; i++)
+    {
+        ether_ros::DomainStats &domain_stats = cycle_stats.domains[i];
+        domain_stats.name = ethercat_domains[i].get_name();
+        domain_stats.divider = ethercat_domains[i].get_divider();
+        domain_stats.size = ethercat_domains[i].get_size();
+        domain_stats.exchanges = ethercat_domains[i].exchanges();
+        domain_stats.wkc_errors = ethercat_domains[i].wkc_errors();
+        domain_stats.working_counter = ethercat_domains[i].working_counter();
+        domain_stats.wc_state = ethercat_domains[i].wc_state();
+    }
+    cycle_stats_pub_.publish(cycle_stats);
+}
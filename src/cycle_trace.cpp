@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file cycle_trace.cpp
+   \brief Implementation of the trace markers of the realtime cycle.
+*/
+
+/*****************************************************************************/
+
+#include "cycle_trace.h"
+
+#ifdef ETHER_ROS_TRACE
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "ros/ros.h"
+
+namespace cycle_trace
+{
+int trace_fd = -1;
+
+void init()
+{
+    if (trace_fd >= 0)
+        return;
+    trace_fd = open("/sys/kernel/tracing/trace_marker", O_WRONLY);
+    if (trace_fd < 0)
+        trace_fd = open("/sys/kernel/debug/tracing/trace_marker", O_WRONLY);
+    if (trace_fd < 0)
+        ROS_WARN("Unable to open the trace_marker (tracefs mounted? root?): the cycle phases aren't traced\n");
+    else
+        ROS_INFO("Tracing the cycle phases to the trace_marker\n");
+}
+
+void mark(const char *prefix, size_t prefix_size, uint64_t cycle)
+{
+    char line[96], digits[20];
+    size_t n = 0;
+
+    if (prefix_size > sizeof(line) - sizeof(digits) - 1)
+        prefix_size = sizeof(line) - sizeof(digits) - 1;
+    memcpy(line, prefix, prefix_size);
+    // no snprintf in the realtime cycle
+    do
+    {
+        digits[n++] = '0' + cycle % 10;
+        cycle /= 10;
+    } while (cycle);
+    while (n)
+        line[prefix_size++] = digits[--n];
+    line[prefix_size++] = '\n';
+    // fails while the markers are turned off (trace_options), which must not stop the cycle
+    if (write(trace_fd, line, prefix_size) < 0)
+        return;
+}
+} // namespace cycle_trace
+
+#endif /* ETHER_ROS_TRACE */
@@ -0,0 +1,194 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file dc_servo.cpp
+   \brief Implementation of DCServo class.
+
+   Used for the synchronization of the distributed clocks, by the EtherCAT Communicator.
+*/
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include "dc_servo.h"
+
+DCServo::DCServo()
+    : mode_(DC_REF_TO_MASTER), kp_(0.1), ki_(0.005), max_adjust_ns_(1000), lock_threshold_ns_(100),
+      lock_cycles_(1000), started_(false), integral_ns_(0), cycles_in_threshold_(0)
+{
+    diff_ns_.store(0, std::memory_order_relaxed);
+    adjust_ns_.store(0, std::memory_order_relaxed);
+    locked_.store(false, std::memory_order_relaxed);
+    lock_losses_.store(0, std::memory_order_relaxed);
+}
+
+void DCServo::init(ros::NodeHandle &n)
+{
+    std::string mode;
+    int max_adjust_ns;
+
+#ifdef SYNC_MASTER_TO_REF
+    n.param<std::string>("/ethercat_slaves/dc/mode", mode, "master_to_ref");
+#else
+    n.param<std::string>("/ethercat_slaves/dc/mode", mode, "ref_to_master");
+#endif
+    n.param("/ethercat_slaves/dc/kp", kp_, 0.1);
+    n.param("/ethercat_slaves/dc/ki", ki_, 0.005);
+    n.param("/ethercat_slaves/dc/max_adjust_ns", max_adjust_ns, 1000);
+    n.param("/ethercat_slaves/dc/lock_threshold_ns", lock_threshold_ns_, 100);
+    n.param("/ethercat_slaves/dc/lock_cycles", lock_cycles_, 1000);
+
+    if (mode == "ref_to_master")
+        mode_ = DC_REF_TO_MASTER;
+    else if (mode == "master_to_ref")
+        mode_ = DC_MASTER_TO_REF;
+    else
+    {
+        ROS_FATAL("Unknown dc/mode '%s' (use ref_to_master or master_to_ref)\n", mode.c_str());
+        exit(1);
+    }
+    if (kp_ < 0 || ki_ < 0 || kp_ >= 1.0 || max_adjust_ns <= 0 || lock_threshold_ns_ <= 0 || lock_cycles_ <= 0)
+    {
+        ROS_FATAL("dc: expected 0 <= kp < 1, ki >= 0 and positive max_adjust_ns, lock_threshold_ns, lock_cycles\n");
+        exit(1);
+    }
+    max_adjust_ns_ = max_adjust_ns;
+    ROS_INFO("DC mode: %s, kp: %f, ki: %f, max adjustment: %ld ns\n", mode.c_str(), kp_, ki_, max_adjust_ns_);
+}
+
+int32_t DCServo::normalize(int32_t diff_ns, int32_t period_ns)
+{
+    int64_t diff = ((int64_t)diff_ns + period_ns / 2) % period_ns;
+    if (diff < 0)
+        diff += period_ns;
+    return diff - period_ns / 2;
+}
+
+void DCServo::record(int32_t diff_ns)
+{
+    bool locked = locked_.load(std::memory_order_relaxed);
+
+    diff_ns_.store(diff_ns, std::memory_order_relaxed);
+    diff_histogram_.record(diff_ns < 0 ? -(int64_t)diff_ns : diff_ns);
+    if (labs(diff_ns) <= lock_threshold_ns_)
+    {
+        if (cycles_in_threshold_ < lock_cycles_)
+            cycles_in_threshold_++;
+        if (!locked && cycles_in_threshold_ >= lock_cycles_)
+            locked_.store(true, std::memory_order_relaxed);
+    }
+    else
+    {
+        cycles_in_threshold_ = 0;
+        if (locked)
+        {
+            locked_.store(false, std::memory_order_relaxed);
+            lock_losses_.store(lock_losses_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+}
+
+int64_t DCServo::update(int32_t diff_ns, int32_t period_ns)
+{
+    double output;
+    int64_t adjust;
+
+    diff_ns = normalize(diff_ns, period_ns);
+    if (!started_)
+    {
+        // the reference clock time isn't available before the first frames return
+        started_ = (diff_ns != 0);
+        if (!started_)
+            return 0;
+    }
+    record(diff_ns);
+
+    integral_ns_ += ki_ * diff_ns;
+    if (integral_ns_ > max_adjust_ns_)
+        integral_ns_ = max_adjust_ns_;
+    if (integral_ns_ < -max_adjust_ns_)
+        integral_ns_ = -max_adjust_ns_;
+
+    output = kp_ * diff_ns + integral_ns_;
+    if (output > max_adjust_ns_)
+        output = max_adjust_ns_;
+    if (output < -max_adjust_ns_)
+        output = -max_adjust_ns_;
+
+    adjust = llround(output);
+    adjust_ns_.store(adjust, std::memory_order_relaxed);
+    return adjust;
+}
+
+void DCServo::observe(uint32_t deviation_ns)
+{
+    // 0xffffffff: the sync monitor datagram didn't return
+    if (deviation_ns == 0xffffffff)
+        return;
+    started_ = true;
+    record(deviation_ns > INT32_MAX ? INT32_MAX : (int32_t)deviation_ns);
+}
+
+dc_sync_mode DCServo::mode() const
+{
+    return mode_;
+}
+
+bool DCServo::started() const
+{
+    return started_;
+}
+
+int32_t DCServo::diff_ns() const
+{
+    return diff_ns_.load(std::memory_order_relaxed);
+}
+
+int64_t DCServo::adjust_ns() const
+{
+    return adjust_ns_.load(std::memory_order_relaxed);
+}
+
+bool DCServo::locked() const
+{
+    return locked_.load(std::memory_order_relaxed);
+}
+
+uint64_t DCServo::lock_losses() const
+{
+    return lock_losses_.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram &DCServo::diff_histogram() const
+{
+    return diff_histogram_;
+}
@@ -85,6 +85,7 @@
 #include "utilities.h"
 #include "services.h"
 #include "ether_ros.h"
+#include "startup_report.h"
 
 /*****************************************************************************/
 
@@ -93,32 +94,48 @@
 uint8_t *domain1_pd;
 uint8_t *process_data_buf;
 size_t total_process_data;
-size_t num_process_data_in;
-size_t num_process_data_out;
-int log_fd;
-ec_master_t *master;
+size_t total_pdo_in;
+size_t total_pdo_out;
+EthercatMaster *ethercat_master;
 ec_master_state_t master_state;
 ec_master_info_t master_info;
-ec_domain_t *domain1;
-ec_domain_state_t domain1_state;
+EthercatDomain *ethercat_domains;
+int domains_count;
 slave_struct *ethercat_slaves;
-pthread_spinlock_t lock;
+int slaves_count;
+slave_pd_offsets *slave_offsets;
+OutputImage output_image;
 EthercatCommunicator ethercat_comm;
 PDOInPublisher pdo_in_publisher;
 PDOOutPublisher pdo_out_publisher;
 PDOOutListener pdo_out_listener;
 PDOOutPublisherTimer pdo_out_publisher_timer;
-int FREQUENCY;
+PDORawRing pdo_raw_ring;
+PDORawPublisher pdo_raw_publisher;
+CallbackSpinner command_spinner;
+CallbackSpinner telemetry_spinner;
+PDORecorder pdo_recorder;
+SharedMemoryMirror shared_memory_mirror;
+CycleStatsPublisher cycle_stats_publisher;
+HealthMonitor health_monitor;
+OutputWatchdog output_watchdog;
+ControllerManager controller_manager;
+std::atomic<int> FREQUENCY;
 int RUN_TIME;
-int PERIOD_NS;
+std::atomic<int> PERIOD_NS;
 
 /****************************************************************************/
 
 int main(int argc, char **argv)
 {
     int ret;
-    std::string slave_names[4] = {"front_left_leg", "front_right_leg", "back_right_leg", "back_left_leg"};
+    int ring_capacity;
+    int period_ns = 0;
+    std::vector<std::string> slave_names;
+    XmlRpc::XmlRpcValue slaves_params;
+    XmlRpc::XmlRpcValue layouts_params;
 
+    startup_report::begin();
     ros::init(argc, argv, "ether_ros");
 
     ros::NodeHandle n;
@@ -129,33 +146,27 @@ int main(int argc, char **argv)
         exit(1);
     }
 
-    ret = pthread_spin_init(&lock, PTHREAD_PROCESS_SHARED); // It doesn't matter for our application what pshared value we use
-    if (ret != 0)
-    {
-        handle_error_en(ret, "pthread_spin_lock_init");
-    }
-
-    master = ecrt_request_master(0);
-    if (!master)
+    // the whole configuration in two round trips, once the parameter server has it
+    if (!fetch_parameters(n, "/ethercat_slaves", slaves_params, PARAMETERS_TIMEOUT_MS))
     {
-        ROS_FATAL("Failed to get master.\n");
+        ROS_FATAL("No /ethercat_slaves in the parameter server after %d ms\n", PARAMETERS_TIMEOUT_MS);
         exit(1);
     }
+    if (!fetch_parameters(n, "/pdo_layouts", layouts_params, 0))
+        ROS_WARN("No /pdo_layouts in the parameter server\n");
+    startup_report::mark(STARTUP_PARAMETERS);
 
-    ret = ecrt_master(master, &master_info);
+    // the IgH Master, or a simulated bus (master/backend)
+    ethercat_master = create_ethercat_master(n);
+
+    ret = ethercat_master->info(&master_info);
     if (ret != 0)
     {
         handle_error_en(ret, "ecrt_master_info");
     }
-    domain1 = ecrt_master_create_domain(master);
-    if (!domain1)
-    {
-        ROS_FATAL("Failed to create domain.\n");
-        exit(1);
-    }
-    if (n.getParam("/ethercat_slaves/period_ns", PERIOD_NS))
+    if (n.getParam("/ethercat_slaves/period_ns", period_ns))
     {
-        ROS_INFO("Got param: /ethercat_slaves/period_ns = %d\n", PERIOD_NS);
+        ROS_INFO("Got param: /ethercat_slaves/period_ns = %d\n", period_ns);
     }
     else
     {
@@ -170,39 +181,88 @@ int main(int argc, char **argv)
     {
         ROS_FATAL("Failed to get param '/ethercat_slaves/run_time'\n");
     }
-    FREQUENCY = (NSEC_PER_SEC / PERIOD_NS);
+    PERIOD_NS = period_ns;
+    FREQUENCY = (NSEC_PER_SEC / period_ns);
+    init_ethercat_domains(n);
 
     ROS_INFO("Number of slaves in bus: %u", master_info.slave_count);
-    ethercat_slaves = new slave_struct[master_info.slave_count];
-    for (int i = 0; i < master_info.slave_count; i++)
+    slave_names = find_configured_slaves(slaves_params);
+    slaves_count = slave_names.size();
+    if (!slaves_count)
+    {
+        ROS_FATAL("No slaves in /ethercat_slaves\n");
+        exit(1);
+    }
+    if ((unsigned int)slaves_count > master_info.slave_count)
+    {
+        ROS_FATAL("%d slaves configured, but only %u in bus\n", slaves_count, master_info.slave_count);
+        exit(1);
+    }
+    if ((unsigned int)slaves_count < master_info.slave_count)
+        ROS_WARN("%u slaves in bus, but only %d configured: the rest are left in PREOP\n", master_info.slave_count, slaves_count);
+    ethercat_slaves = new slave_struct[slaves_count];
+    for (int i = 0; i < slaves_count; i++)
     {
         ethercat_slaves[i].id = i;
         ethercat_slaves[i].slave_name = slave_names[i];
-        ethercat_slaves[i].slave.init(ethercat_slaves[i].slave_name, n);
+        ethercat_slaves[i].slave.init(ethercat_slaves[i].slave_name, slaves_params, layouts_params);
     }
+    startup_report::mark(STARTUP_SLAVES);
 
     /******************************************
     *    Application domain data              *
     *******************************************/
 
-    total_process_data = ecrt_domain_size(domain1);
+    // the domains are mapped one after the other, in a single process image
+    total_process_data = 0;
+    for (int i = 0; i < domains_count; i++)
+    {
+        ethercat_domains[i].set_offset(total_process_data);
+        total_process_data += ethercat_domains[i].get_size();
+    }
+    for (int i = 0; i < slaves_count; i++)
+        ethercat_slaves[i].slave.relocate(ethercat_domains[ethercat_slaves[i].slave.get_domain()].get_offset());
     ROS_INFO("Number of total process data bytes: %lu\n", total_process_data);
-    num_process_data_in = total_process_data - ethercat_slaves[master_info.slave_count - 1].slave.get_pdo_in();
-    ROS_INFO("Number of process data input bytes for every slave: %lu\n", num_process_data_in);
-    num_process_data_out = ethercat_slaves[master_info.slave_count - 1].slave.get_pdo_in() - ethercat_slaves[master_info.slave_count - 1].slave.get_pdo_out();
-    ROS_INFO("Number of process data output bytes for every slave: %lu\n", num_process_data_out);
+    init_slave_offsets();
+    ROS_INFO("Number of process data input bytes: %lu, output bytes: %lu\n", total_pdo_in, total_pdo_out);
 
-    process_data_buf = (uint8_t *)malloc(total_process_data * sizeof(uint8_t));
-    memset(process_data_buf, 0, total_process_data); // fill the buffer with zeros
+    std::vector<utilities::output_range> output_regions(slaves_count);
+    for (int i = 0; i < slaves_count; i++)
+    {
+        output_regions[i].offset = slave_offsets[i].pdo_out;
+        output_regions[i].size = slave_offsets[i].pdo_out_size;
+    }
+    // allocates the process_data_buf, filled with zeros
+    output_image.init(total_process_data, output_regions.data(), output_regions.size());
+    ROS_INFO("The output PDOs are copied in %lu ranges\n", output_image.ranges_count());
+    output_watchdog.init(slaves_params);
+    controller_manager.init(n, slaves_params);
 
-    n.setParam("/ethercat_slaves/slaves_count", (int)master_info.slave_count); // set the slaves_count to the actual slaves found and configured
+    n.setParam("/ethercat_slaves/slaves_count", slaves_count); // set the slaves_count to the actual slaves found and configured
+
+    // the ring must be ready before the publishers attach to it
+    n.param("/ethercat_slaves/ring_capacity", ring_capacity, 1024);
+    pdo_raw_ring.init(ring_capacity, total_process_data);
+    shared_memory_mirror.init(n);
+
+    // the commands and the telemetry are served by their own callback queues, so they don't wait for each other;
+    // the telemetry CPUs are also the ones of the ring consumers
+    command_spinner.init(n, "command", 1);
+    telemetry_spinner.init(n, "telemetry", 1);
 
     //Initialize the Ethercat Communicator and the Ethercat Data Handlers
     ethercat_comm.init(n);
+    pdo_raw_publisher.init(n);
+    pdo_recorder.init(n);
     pdo_in_publisher.init(n);
-    // pdo_out_publisher.init(n);
-    pdo_out_listener.init(n);
-    pdo_out_publisher_timer.init(n);
+    pdo_out_publisher.init(n);
+
+    pdo_out_listener.init(command_spinner.node_handle());
+    pdo_out_publisher_timer.init(telemetry_spinner.node_handle());
+    cycle_stats_publisher.init(telemetry_spinner.node_handle());
+    health_monitor.init(telemetry_spinner.node_handle());
+    command_spinner.start();
+    telemetry_spinner.start();
 
 
     /******************************************
@@ -210,25 +270,13 @@ int main(int argc, char **argv)
     *******************************************/
     ros::ServiceServer ethercat_communicatord_service = n.advertiseService("ethercat_communicatord", ethercat_communicatord);
     ROS_INFO("Ready to communicate via EtherCAT.");
+    startup_report::mark(STARTUP_READY);
 
-#ifdef LOGGING
-    /******************************************
-    *           Open Log file                 *
-    *******************************************/
-
-    static char file_name[100];
-    sprintf(file_name, "./outputs/measure_test_2/nort_ectest_dc_res_time_%d_%d_Hz_%d_s.csv", NUM_SLAVES, FREQUENCY, RUN_TIME);
-    mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
-    int flags = O_WRONLY | O_CREAT | O_TRUNC;
-    log_fd = open(file_name, flags, mode);
-    if (log_fd < 0)
-    {
-        ROS_FATAL("Could not open fd");
-        exit(1);
-    }
-#endif
-
+    // the global queue serves only the ethercat_communicatord service
     ros::spin();
+    command_spinner.join();
+    telemetry_spinner.join();
+    pdo_recorder.finish();
 }
 
 /*****************************************************************************/
@@ -32,8 +32,8 @@
    \file ethercat_communicator.cpp
    \brief Implementation of EthercatCommunicator class.
 
-   Used for real-time communication with the EtherCAT slaves, via the IgH Master module. The new PD are sent
-   to the  \a /ethercat_data_raw topic.
+   Used for real-time communication with the EtherCAT slaves, via the IgH Master module. The new PD are written
+   to the \a pdo_raw_ring, once per cycle.
 */
 
 /*****************************************************************************/
@@ -41,29 +41,42 @@
 #include "utilities.h"
 #include "ethercat_slave.h"
 #include "ether_ros.h"
-#include "ether_ros/PDORaw.h"
 #include "deadline_scheduler.h"
+#include "cycle_trace.h"
+#include "startup_report.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
 
 int EthercatCommunicator::cleanup_pop_arg_ = 0;
-bool EthercatCommunicator::running_thread_ = false;
+std::atomic<bool> EthercatCommunicator::running_thread_(false);
+std::atomic<bool> EthercatCommunicator::stop_requested_(false);
+bool EthercatCommunicator::joinable_thread_ = false;
+bool EthercatCommunicator::master_activated_ = false;
 pthread_t EthercatCommunicator::communicator_thread_ = {};
-ros::Publisher EthercatCommunicator::pdo_raw_pub_;
 
 uint64_t EthercatCommunicator::dc_start_time_ns_ = 0LL;
-uint64_t EthercatCommunicator::dc_time_ns_ = 0;
+std::atomic<uint64_t> EthercatCommunicator::dc_time_ns_(0);
 int64_t EthercatCommunicator::system_time_base_ = 0LL;
-#ifdef SYNC_MASTER_TO_REF
-    uint8_t EthercatCommunicator::dc_started_ = 0;
-    int32_t EthercatCommunicator::dc_diff_ns_ = 0;
-    int32_t EthercatCommunicator::prev_dc_diff_ns_ = 0;
-    int64_t EthercatCommunicator::dc_diff_total_ns_ = 0LL;
-    int64_t EthercatCommunicator::dc_delta_total_ns_ = 0LL;
-    int EthercatCommunicator::dc_filter_idx_ = 0;
-    int64_t EthercatCommunicator::dc_adjust_ns_;
-#endif
-#ifdef LOGGING
-    statistics_struct stat_struct;
-#endif
+realtime_config EthercatCommunicator::rt_config_ = {};
+LatencyHistogram EthercatCommunicator::wakeup_latency_histogram_;
+LatencyHistogram EthercatCommunicator::period_histogram_;
+LatencyHistogram EthercatCommunicator::exec_histogram_;
+int32_t EthercatCommunicator::dc_diff_ns_ = 0;
+DCServo EthercatCommunicator::dc_servo_;
+std::atomic<uint64_t> EthercatCommunicator::system_time_errors_(0);
+std::atomic<uint64_t> EthercatCommunicator::overruns_(0);
+std::atomic<uint64_t> EthercatCommunicator::missed_cycles_(0);
+std::atomic<bool> EthercatCommunicator::overrun_fault_(false);
+std::atomic<uint64_t> EthercatCommunicator::cycle_(1);
+std::atomic<bool> EthercatCommunicator::reconfiguring_(false);
+std::atomic<uint64_t> EthercatCommunicator::run_start_time_ns_(0);
+uint64_t EthercatCommunicator::run_first_cycle_ = 0;
+std::atomic<int> EthercatCommunicator::calibration_state_(CALIBRATION_NONE);
+std::atomic<uint64_t> EthercatCommunicator::calibration_exec_ns_(0);
+std::atomic<uint64_t> EthercatCommunicator::calibration_runtime_ns_(0);
+std::atomic<int> EthercatCommunicator::calibration_errno_(0);
+std::atomic<bool> EthercatCommunicator::run_time_expired_(false);
 //--------------------------------------------------------------------------//
 
 /** Get the time in ns for the current cpu, adjusted by system_time_base_.
@@ -83,9 +96,8 @@ uint64_t EthercatCommunicator::system_time_ns(void)
 
     if (system_time_base_ > (int64_t)time_ns)
     {
-        ROS_INFO(" system_time_ns error: system_time_base_ greater than"
-                  " system time (system_time_base_: %ld, time: %lu\n",
-                   system_time_base_, (int64_t) time_ns);
+        // system_time_base_ greater than the system time: counted (and published), never logged from here
+        system_time_errors_.store(system_time_errors_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
         return time_ns;
     }
     else
@@ -100,28 +112,32 @@ uint64_t EthercatCommunicator::system_time_ns(void)
  */
 void EthercatCommunicator::sync_distributed_clocks(void)
 {
-#ifdef SYNC_MASTER_TO_REF
     uint32_t ref_time = 0;
-    uint64_t prev_app_time = dc_time_ns_;
-#endif
+    uint64_t prev_app_time = dc_time_ns_.load(std::memory_order_relaxed);
+    uint64_t app_time = system_time_ns();
 
-    dc_time_ns_ = system_time_ns();
+    // also read by change_period(), for the start time of the SYNC0 of the slaves
+    dc_time_ns_.store(app_time, std::memory_order_relaxed);
 
     // set master time in nano-seconds
-    ecrt_master_application_time(master, dc_time_ns_);
+    ethercat_master->application_time(app_time);
 
-#ifdef SYNC_MASTER_TO_REF
-    // get reference clock time to synchronize master cycle
-    ecrt_master_reference_clock_time(master, &ref_time);
-    dc_diff_ns_ = (uint32_t)prev_app_time - ref_time;
-#endif
-#ifdef SYNC_REF_TO_MASTER
-    // sync reference clock to master
-    ecrt_master_sync_reference_clock(master);
-#endif
+    if (dc_servo_.mode() == DC_MASTER_TO_REF)
+    {
+        // get reference clock time to synchronize master cycle
+        ethercat_master->reference_clock_time(&ref_time);
+        dc_diff_ns_ = (uint32_t)prev_app_time - ref_time;
+    }
+    else
+    {
+        // sync reference clock to master
+        ethercat_master->sync_reference_clock();
+    }
 
     // call to sync slaves to ref slave
-    ecrt_master_sync_slave_clocks(master);
+    ethercat_master->sync_slave_clocks();
+    // measure the deviation of the slave clocks (processed in the next cycle)
+    ethercat_master->sync_monitor_queue();
 }
 
 //--------------------------------------------------------------------------//
@@ -133,103 +149,259 @@ void EthercatCommunicator::sync_distributed_clocks(void)
  */
 void EthercatCommunicator::update_master_clock(void)
 {
-#ifdef SYNC_MASTER_TO_REF
-    // calc drift (via un-normalised time diff)
-    int32_t delta = dc_diff_ns_ - prev_dc_diff_ns_;
-    prev_dc_diff_ns_ = dc_diff_ns_;
+    if (dc_servo_.mode() != DC_MASTER_TO_REF)
+        return;
 
-    // normalise the time diff
-    dc_diff_ns_ =
-        ((dc_diff_ns_ + (PERIOD_NS / 2)) % PERIOD_NS) - (PERIOD_NS / 2);
-
-    // only update if primary master
-    if (dc_started_)
+    bool started = dc_servo_.started();
+    // add the correction of the servo to the time base
+    system_time_base_ += dc_servo_.update(dc_diff_ns_, PERIOD_NS);
+    if (!started && dc_servo_.started())
     {
+        // record the time of this initial cycle
+        dc_start_time_ns_ = dc_time_ns_.load(std::memory_order_relaxed);
+    }
+}
 
-        // add to totals
-        dc_diff_total_ns_ += dc_diff_ns_;
-        dc_delta_total_ns_ += delta;
-        dc_filter_idx_++;
+//--------------------------------------------------------------------------//
 
-        if (dc_filter_idx_ >= DC_FILTER_CNT)
-        {
-            // add rounded delta average
-            dc_adjust_ns_ +=
-                ((dc_delta_total_ns_ + (DC_FILTER_CNT / 2)) / DC_FILTER_CNT);
+/** Process the sync monitor datagram of the previous cycle
+ *
+ * In the ref to master mode, the deviation of the slave clocks is the only measure of the lock.
+ */
+void EthercatCommunicator::process_sync_monitor(void)
+{
+    uint32_t deviation_ns = ethercat_master->sync_monitor_process();
+    if (dc_servo_.mode() == DC_REF_TO_MASTER)
+        dc_servo_.observe(deviation_ns);
+}
 
-            // and add adjustment for general diff (to pull in drift)
-            dc_adjust_ns_ += sign(dc_diff_total_ns_ / DC_FILTER_CNT);
+//--------------------------------------------------------------------------//
 
-            // limit crazy numbers (0.1% of std cycle time)
-            if (dc_adjust_ns_ < -1000)
-            {
-                dc_adjust_ns_ = -1000;
-            }
-            if (dc_adjust_ns_ > 1000)
-            {
-                dc_adjust_ns_ = 1000;
-            }
+uint64_t EthercatCommunicator::current_cycle()
+{
+    return cycle_.load(std::memory_order_relaxed);
+}
+//--------------------------------------------------------------------------//
+bool EthercatCommunicator::has_running_thread()
+{
+    return running_thread_.load(std::memory_order_acquire);
+}
+//--------------------------------------------------------------------------//
+const LatencyHistogram &EthercatCommunicator::wakeup_latency_histogram()
+{
+    return wakeup_latency_histogram_;
+}
+const LatencyHistogram &EthercatCommunicator::period_histogram()
+{
+    return period_histogram_;
+}
+const LatencyHistogram &EthercatCommunicator::exec_histogram()
+{
+    return exec_histogram_;
+}
+const DCServo &EthercatCommunicator::dc_servo()
+{
+    return dc_servo_;
+}
+uint64_t EthercatCommunicator::system_time_errors()
+{
+    return system_time_errors_.load(std::memory_order_relaxed);
+}
+int EthercatCommunicator::overrun_policy()
+{
+    return rt_config_.overrun_policy;
+}
+uint64_t EthercatCommunicator::overruns()
+{
+    return overruns_.load(std::memory_order_relaxed);
+}
+uint64_t EthercatCommunicator::missed_cycles()
+{
+    return missed_cycles_.load(std::memory_order_relaxed);
+}
+bool EthercatCommunicator::overrun_fault()
+{
+    return overrun_fault_.load(std::memory_order_relaxed);
+}
+void EthercatCommunicator::reset_overrun_fault()
+{
+    overrun_fault_.store(false, std::memory_order_relaxed);
+}
+int EthercatCommunicator::deadline_calibration(uint64_t *max_exec_ns, uint64_t *runtime_ns, int *err)
+{
+    int state = calibration_state_.load(std::memory_order_acquire);
 
-            // reset
-            dc_diff_total_ns_ = 0LL;
-            dc_delta_total_ns_ = 0LL;
-            dc_filter_idx_ = 0;
-        }
+    *max_exec_ns = calibration_exec_ns_.load(std::memory_order_relaxed);
+    *runtime_ns = calibration_runtime_ns_.load(std::memory_order_relaxed);
+    *err = calibration_errno_.load(std::memory_order_relaxed);
+    return state;
+}
+//--------------------------------------------------------------------------//
+/** Apply the overrun policy
+ *
+ * Called when the cycle ended \a late_ns after the next wakeup. Moves the \a wakeup_time forward,
+ * on the cycle grid (the SYNC0 phase is kept), over the cycles that won't be run.
+ */
+void EthercatCommunicator::handle_overrun(struct timespec *wakeup_time, int64_t late_ns)
+{
+    int64_t missed = late_ns / PERIOD_NS + 1; // the wakeups that are already in the past
+    int64_t skipped = missed;
 
-        // add cycles adjustment to time base (including a spot adjustment)
-        system_time_base_ += dc_adjust_ns_ + sign(dc_diff_ns_);
-    }
-    else
-    {
-        dc_started_ = (dc_diff_ns_ != 0);
+    overruns_.store(overruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    missed_cycles_.store(missed_cycles_.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
 
-        if (dc_started_)
-        {
-            // output first diff
-            ROS_INFO("First master diff: %d.\n", dc_diff_ns_);
+    if (rt_config_.overrun_policy == OVERRUN_CATCH_UP)
+        skipped = missed > rt_config_.max_catch_up_cycles ? missed - rt_config_.max_catch_up_cycles : 0;
+    else if (rt_config_.overrun_policy == OVERRUN_SAFE_OUTPUTS)
+        overrun_fault_.store(true, std::memory_order_relaxed);
 
-            // record the time of this initial cycle
-            dc_start_time_ns_ = dc_time_ns_;
-        }
+    if (skipped)
+    {
+        int64_t skipped_ns = skipped * PERIOD_NS;
+        struct timespec skipped_time = {(time_t)(skipped_ns / NSEC_PER_SEC), (long)(skipped_ns % NSEC_PER_SEC)};
+        *wakeup_time = utilities::timespec_add(*wakeup_time, skipped_time);
     }
-#endif
 }
-
 //--------------------------------------------------------------------------//
+/** Returns a hint for the errors of the scheduling related system calls.
+ */
+static const char *sched_error_hint(int err)
+{
+    switch (err)
+    {
+    case EPERM:
+        return "Run as root (or with CAP_SYS_NICE and a sufficient RLIMIT_RTPRIO). For SCHED_DEADLINE, "
+               "the CPU affinity must span the whole root domain: use an exclusive cpuset "
+               "(see scripts/optimizations/isolate_cpus.sh) or set realtime/cpu to -1.";
+    case EBUSY:
+        return "The SCHED_DEADLINE admission test failed: the total bandwidth exceeds "
+               "/proc/sys/kernel/sched_rt_runtime_us / sched_rt_period_us. Lower the runtime.";
+    case EINVAL:
+        return "Check that 1024 <= runtime <= deadline <= period, that the priority is in range, "
+               "and that the CPU exists and belongs to the cpuset of the process.";
+    default:
+        return "";
+    }
+}
+//--------------------------------------------------------------------------//
+void EthercatCommunicator::load_realtime_config(ros::NodeHandle &n)
+{
+    std::string policy, overrun;
+    int runtime_ns, deadline_ns;
+    int period_ns = PERIOD_NS;
+    int fifo_min = sched_get_priority_min(SCHED_FIFO), fifo_max = sched_get_priority_max(SCHED_FIFO);
 
-bool EthercatCommunicator::has_running_thread()
+#ifdef DEADLINE_SCHEDULING
+    n.param<std::string>("/ethercat_slaves/realtime/policy", policy, "deadline");
+#else
+    n.param<std::string>("/ethercat_slaves/realtime/policy", policy, "fifo");
+#endif
+    n.param("/ethercat_slaves/realtime/cpu", rt_config_.cpu, 3);
+    n.param("/ethercat_slaves/realtime/priority", rt_config_.priority, 80);
+    n.param("/ethercat_slaves/realtime/deadline_runtime_ns", runtime_ns, 0);
+    n.param("/ethercat_slaves/realtime/deadline_ns", deadline_ns, 0);
+    n.param("/ethercat_slaves/realtime/calibration_cycles", rt_config_.calibration_cycles, 1000);
+    n.param("/ethercat_slaves/realtime/runtime_margin", rt_config_.runtime_margin, 1.5);
+    n.param<std::string>("/ethercat_slaves/realtime/overrun_policy", overrun, "skip");
+    n.param("/ethercat_slaves/realtime/max_catch_up_cycles", rt_config_.max_catch_up_cycles, 1);
+    n.param("/ethercat_slaves/realtime/stop_safe_cycles", rt_config_.stop_safe_cycles, 10);
+    n.param("/ethercat_slaves/realtime/stop_timeout_ms", rt_config_.stop_timeout_ms, 100);
+
+    if (policy == "fifo")
+        rt_config_.policy = SCHED_FIFO;
+    else if (policy == "other") // no realtime privileges needed, e.g. with the simulated master
+        rt_config_.policy = SCHED_OTHER;
+    else if (policy == "deadline")
+        rt_config_.policy = SCHED_DEADLINE;
+    else
+    {
+        ROS_FATAL("Unknown realtime/policy '%s' (use fifo, deadline or other)\n", policy.c_str());
+        exit(1);
+    }
+    if (rt_config_.policy == SCHED_OTHER)
+        rt_config_.priority = 0;
+    else if (rt_config_.priority < fifo_min || rt_config_.priority > fifo_max)
+    {
+        ROS_FATAL("realtime/priority %d out of the SCHED_FIFO range [%d, %d]\n",
+                  rt_config_.priority, fifo_min, fifo_max);
+        exit(1);
+    }
+    if (rt_config_.cpu >= sysconf(_SC_NPROCESSORS_CONF))
+    {
+        ROS_FATAL("realtime/cpu %d doesn't exist (%ld CPUs)\n", rt_config_.cpu, sysconf(_SC_NPROCESSORS_CONF));
+        exit(1);
+    }
+    if (runtime_ns < 0 || deadline_ns < 0 || deadline_ns > period_ns || runtime_ns > (deadline_ns ? deadline_ns : period_ns))
+    {
+        ROS_FATAL("realtime: expected 0 <= deadline_runtime_ns <= deadline_ns <= period_ns\n");
+        exit(1);
+    }
+    if (rt_config_.calibration_cycles <= 0 || rt_config_.runtime_margin < 1.0)
+    {
+        ROS_FATAL("realtime: expected calibration_cycles > 0 and runtime_margin >= 1.0\n");
+        exit(1);
+    }
+    if (overrun == "skip")
+        rt_config_.overrun_policy = OVERRUN_SKIP;
+    else if (overrun == "catch_up")
+        rt_config_.overrun_policy = OVERRUN_CATCH_UP;
+    else if (overrun == "safe_outputs")
+        rt_config_.overrun_policy = OVERRUN_SAFE_OUTPUTS;
+    else
+    {
+        ROS_FATAL("Unknown realtime/overrun_policy '%s' (use skip, catch_up or safe_outputs)\n", overrun.c_str());
+        exit(1);
+    }
+    if (rt_config_.max_catch_up_cycles < 0)
+    {
+        ROS_FATAL("realtime: expected max_catch_up_cycles >= 0\n");
+        exit(1);
+    }
+    if (rt_config_.stop_safe_cycles < 0 || rt_config_.stop_timeout_ms <= 0)
+    {
+        ROS_FATAL("realtime: expected stop_safe_cycles >= 0 and stop_timeout_ms > 0\n");
+        exit(1);
+    }
+    rt_config_.runtime_ns = runtime_ns;
+    rt_config_.deadline_ns = deadline_ns ? deadline_ns : period_ns;
+}
+//--------------------------------------------------------------------------//
+/** Switches the calling thread to SCHED_DEADLINE.
+ *
+ * Doesn't log: it's also called from the cycles, after the calibration.
+ * \ret 0 or the errno of sched_setattr().
+ */
+int EthercatCommunicator::set_deadline_scheduling(uint64_t runtime_ns)
 {
-    return running_thread_;
+    struct sched_attr sched_attr_ = {};
+    int err;
+
+    sched_attr_.size = sizeof(struct sched_attr);
+    sched_attr_.sched_policy = SCHED_DEADLINE;
+    sched_attr_.sched_priority = 0;
+    sched_attr_.sched_runtime = runtime_ns;
+    sched_attr_.sched_deadline = rt_config_.deadline_ns;
+    sched_attr_.sched_period = PERIOD_NS;
+    if (sched_setattr(0, &sched_attr_, 0))
+    {
+        err = errno;
+        return err;
+    }
+    return 0;
 }
 //--------------------------------------------------------------------------//
 void EthercatCommunicator::init(ros::NodeHandle &n)
 {
 
-    const struct sched_param sched_param_ = {.sched_priority = 80};
+    struct sched_param sched_param_ = {};
     struct sched_param act_param = {};
     int act_policy;
     int ret;
 
-    /******************************************
-     * Initialize the timing sampling buffers.
-    *******************************************/
-#ifdef LOGGING
-#ifdef LOGGING_SAMPLING
-    statistics_struct stat_struct = {0, 0, 0, 0};
-    stat_struct.latency_min_ns = (uint32_t *)malloc(RUN_TIME * SAMPLING_FREQ * (sizeof(uint32_t)));
-    stat_struct.latency_max_ns = (uint32_t *)malloc(RUN_TIME * SAMPLING_FREQ * (sizeof(uint32_t)));
-    stat_struct.period_min_ns = (uint32_t *)malloc(RUN_TIME * SAMPLING_FREQ * (sizeof(uint32_t)));
-    stat_struct.period_max_ns = (uint32_t *)malloc(RUN_TIME * SAMPLING_FREQ * (sizeof(uint32_t)));
-    stat_struct.exec_min_ns = (uint32_t *)malloc(RUN_TIME * SAMPLING_FREQ * (sizeof(uint32_t)));
-    stat_struct.exec_max_ns = (uint32_t *)malloc(RUN_TIME * SAMPLING_FREQ * (sizeof(uint32_t)));
-#endif
-#ifdef LOGGING_NO_SAMPLING
-    statistics_struct stat_struct = {0};
-    stat_struct.latency_ns = (uint32_t *)malloc(RUN_TIME * FREQUENCY * (sizeof(uint32_t)));
-    stat_struct.period_ns = (uint32_t *)malloc(RUN_TIME * FREQUENCY * (sizeof(uint32_t)));
-    stat_struct.exec_ns = (uint32_t *)malloc(RUN_TIME * FREQUENCY * (sizeof(uint32_t)));
-#endif
-#endif
+    load_realtime_config(n);
+    dc_servo_.init(n);
+    CYCLE_TRACE_INIT();
+    sched_param_.sched_priority = rt_config_.priority;
 
     if (pthread_attr_init(&current_thattr_))
     {
@@ -248,9 +420,10 @@ void EthercatCommunicator::init(ros::NodeHandle &n)
     }
 
     /*
-    * Use the SCHED_FIFO for now. It should be tested later if there is a better scheduler (see: SCHED_DEADLINE, EDF + CBS)
+    * The thread is created with SCHED_FIFO (or SCHED_OTHER, with the other policy). With the SCHED_DEADLINE policy, it switches itself
+    * to SCHED_DEADLINE in run(), after the calibration cycles if the runtime isn't configured.
     */
-    if (pthread_attr_setschedpolicy(&current_thattr_, SCHED_FIFO))
+    if (pthread_attr_setschedpolicy(&current_thattr_, rt_config_.policy == SCHED_OTHER ? SCHED_OTHER : SCHED_FIFO))
     {
         ROS_FATAL("Attribute set schedule policy\n");
         exit(1);
@@ -272,14 +445,9 @@ void EthercatCommunicator::init(ros::NodeHandle &n)
         handle_error_en(ret, "pthread_attr_getschedpolicy");
     }
     ROS_WARN("Actual pthread attribute values are: %d , %d\n", act_policy, act_param.sched_priority);
-
-    //Create  ROS publisher for the Ethercat RAW data
-    pdo_raw_pub_ = n.advertise<ether_ros::PDORaw>("pdo_raw", 1000);
-
-
 }
 //--------------------------------------------------------------------------//
-void EthercatCommunicator::start()
+void EthercatCommunicator::activate_master()
 {
     int ret;
 #ifdef SYNC_MASTER_TO_REF
@@ -297,149 +465,73 @@ void EthercatCommunicator::start()
      */
     // ecrt_master_application_time(master, dc_start_time_ns_);
 #endif
-    ret = ecrt_master_select_reference_clock(master, ethercat_slaves[0].slave.get_slave_config());
+    ret = ethercat_master->select_reference_clock(ethercat_slaves[0].slave.get_slave_config());
     if (ret < 0)
     {
         handle_error_en(ret, "Failed to select reference clock. \n");
     }
 
     ROS_INFO("Activating master...\n");
-    if (ecrt_master_activate(master))
+    if (ethercat_master->activate())
     {
         ROS_FATAL("Failed to activate master.\n");
         exit(1);
     }
     domain1_pd = NULL;
-    if (!(domain1_pd = ecrt_domain_data(domain1)))
+    if (!(domain1_pd = ethercat_master->domain_data(ethercat_domains[0].get_domain())))
     {
         ROS_FATAL("Failed to set domain data.\n");
         exit(1);
     }
-    running_thread_ = true;
-
-    ret = pthread_create(&communicator_thread_, &current_thattr_, &EthercatCommunicator::run, NULL);
-    if (ret != 0)
-    {
-        handle_error_en(ret, "pthread_create");
-    }
-    ROS_INFO("Starting cyclic thread.\n");
+    for (int i = 0; i < domains_count; i++)
+        ethercat_domains[i].activate(domain1_pd);
+    master_activated_ = true;
+    startup_report::mark(STARTUP_ACTIVATED);
 }
 //--------------------------------------------------------------------------//
-void EthercatCommunicator::cleanup_handler(void *arg)
-{
-    ROS_INFO("Called clean-up handler\n");
-}
-//--------------------------------------------------------------------------//
-#ifdef LOGGING
-void EthercatCommunicator::log_statistics_to_file(statistics_struct *ss)
+void EthercatCommunicator::start()
 {
-    int i;
-    char log_string[100];
-#ifdef LOGGING_SAMPLING
-    for (i = 0; i < RUN_TIME * SAMPLING_FREQ; i++)
+    int ret;
+
+    // the master stays active across the restarts, only the cycles are re-phased
+    if (!master_activated_)
+        activate_master();
+    // the previous thread may have stopped by itself, at the end of the RUN_TIME
+    if (joinable_thread_)
     {
-        snprintf(log_string, 100, "%10u , %10u , 10u , %10u , 10u , %10u\n",
-                 ss->period_min_ns[i], ss->period_max_ns[i], ss->exec_min_ns[i], ss->exec_max_ns[i],
-                 ss->latency_min_ns[i], ss->latency_max_ns[i]);
-        dprintf(log_fd, "%s", log_string);
+        pthread_join(communicator_thread_, NULL);
+        joinable_thread_ = false;
     }
-#endif
-#ifdef LOGGING_NO_SAMPLING
-    for (i = 0; i < RUN_TIME * FREQUENCY; i++)
-    {
-        if (i % 10000 == 0)
-            ROS_INFO("Current line written is: %d\n", i);
-        snprintf(log_string, sizeof(log_string), "%10u , %10u , %10u\n",
-                 ss->period_ns[i], ss->exec_ns[i], ss->latency_ns[i]);
-        if ((uint32_t)utilities::insist_write(log_fd, log_string, strlen(log_string)) != strlen(log_string))
+    if (rt_config_.cpu >= 0)
+    {
+        cpu_set_t cpuset_;
+        CPU_ZERO(&cpuset_);
+        CPU_SET(rt_config_.cpu, &cpuset_);
+        ret = pthread_attr_setaffinity_np(&current_thattr_, sizeof(cpuset_), &cpuset_);
+        if (ret != 0)
         {
-            ROS_FATAL("ec_thread: insist_write");
+            ROS_FATAL("Set pthread affinity to CPU %d: %s. %s\n", rt_config_.cpu, strerror(ret), sched_error_hint(ret));
             exit(1);
         }
     }
-#endif
+    stop_requested_.store(false, std::memory_order_relaxed);
+    running_thread_.store(true, std::memory_order_release);
 
-    if (close(log_fd))
+    ret = pthread_create(&communicator_thread_, &current_thattr_, &EthercatCommunicator::run, NULL);
+    if (ret != 0)
     {
-        ROS_ERROR("ec_thread: close log fd");
+        ROS_FATAL("pthread_create (SCHED_FIFO, priority %d, CPU %d): %s. %s\n",
+                  rt_config_.priority, rt_config_.cpu, strerror(ret), sched_error_hint(ret));
         exit(1);
     }
+    joinable_thread_ = true;
+    ROS_INFO("Starting cyclic thread.\n");
 }
-#endif
-//--------------------------------------------------------------------------//
-#ifdef LOGGING
-void EthercatCommunicator::create_statistics(statistics_struct * ss, struct timespec * wakeup_time_p)
-{
-#ifdef LOGGING_SAMPLING
-    ss->latency_ns = DIFF_NS(*wakeup_time_p, ss->start_time);
-    ss->period_ns = DIFF_NS(ss->last_start_time, ss->start_time);
-    ss->exec_ns = DIFF_NS(ss->last_start_time, ss->end_time);
-
-    if (ss->latency_ns > ss->latency_max_ns[ss->statistics_id])
-    {
-        ss->latency_max_ns[ss->statistics_id] = ss->latency_ns;
-    }
-    if (ss->latency_ns < ss->latency_min_ns[ss->statistics_id])
-    {
-        ss->latency_min_ns[ss->statistics_id] = ss->latency_ns;
-    }
-    if (ss->period_ns > ss->period_max_ns[ss->statistics_id])
-    {
-        ss->period_max_ns[ss->statistics_id] = ss->period_ns;
-    }
-    if (ss->period_ns < ss->period_min_ns[ss->statistics_id])
-    {
-        ss->period_min_ns[ss->statistics_id] = ss->period_ns;
-    }
-    if (ss->exec_ns > ss->exec_max_ns[ss->statistics_id])
-    {
-        ss->exec_max_ns[ss->statistics_id] = ss->exec_ns;
-    }
-    if (ss->exec_ns < ss->exec_min_ns[ss->statistics_id])
-    {
-        ss->exec_min_ns[ss->statistics_id] = ss->exec_ns;
-    }
-#ifdef LOGGING_NO_SAMPLING
-    ss->latency_ns[ss->statistics_id] = DIFF_NS(*wakeup_time_p, ss->start_time);
-    ss->period_ns[ss->statistics_id] = DIFF_NS(ss->last_start_time, ss->start_time);
-    ss->exec_ns[ss->statistics_id] = DIFF_NS(ss->last_start_time, ss->end_time);
-#endif
-#endif
-}
-#endif
 //--------------------------------------------------------------------------//
-#ifdef LOGGING
-void EthercatCommunicator::create_new_statistics_sample(statistics_struct *ss, unsigned int * sampling_counter)
+void EthercatCommunicator::cleanup_handler(void *arg)
 {
-
-#ifdef LOGGING_SAMPLING
-    *sampling_counter = FREQUENCY / SAMPLING_FREQ;
-#endif
-#ifdef LOGGING_NO_SAMPLING
-    *sampling_counter = 0;
-#endif
-    ss->statistics_id++;
-
-
-#if defined(LOGGING) && defined(LOGGING_SAMPLING)
-    // output timing stats
-    // printf("period     %10u ... %10u\n",
-    //         period_min_ns, period_max_ns);
-    // printf("exec       %10u ... %10u\n",
-    //         exec_min_ns, exec_max_ns);
-    // printf("latency    %10u ... %10u\n",
-    //         latency_min_ns, latency_max_ns);
-
-    period_max_ns[ss->statistics_id] = 0;
-    period_min_ns[ss->statistics_id] = 0xffffffff;
-    exec_max_ns[ss->statistics_id] = 0;
-    exec_min_ns[ss->statistics_id] = 0xffffffff;
-    latency_max_ns[ss->statistics_id] = 0;
-    latency_min_ns[ss->statistics_id] = 0xffffffff;
-#endif
+    ROS_INFO("Called clean-up handler\n");
 }
-#endif
-
 //--------------------------------------------------------------------------//
 void *EthercatCommunicator::run(void *arg)
 {
@@ -447,94 +539,126 @@ void *EthercatCommunicator::run(void *arg)
 
     unsigned int sampling_counter = 0;
     unsigned int sync_ref_counter = 0;
+    // the cycle ids go on across restarts, so that a command can't be scheduled for a past run
+    uint64_t cycle = cycle_.load(std::memory_order_relaxed);
+    const uint64_t first_cycle = cycle;
     const struct timespec cycletime = {0, PERIOD_NS};
     struct timespec break_time, current_time, offset_time = {RUN_TIME, 0}, wakeup_time;
-    int ret;
-    cpu_set_t cpuset_;
-#ifdef DEADLINE_SCHEDULING
-    struct sched_attr sched_attr_;
-    sched_attr_.size = sizeof(struct sched_attr);
-    sched_attr_.sched_policy = SCHED_DEADLINE;
-    sched_attr_.sched_priority = 0;
-    sched_attr_.sched_runtime = 30000;
-    sched_attr_.sched_deadline = 100000;
-    sched_attr_.sched_period = PERIOD_NS;
-#endif
-#ifdef FIFO_SCHEDULING
-    CPU_SET(3, &cpuset_);
-
-    // set pthread affinity to CPU 3
-    if (pthread_setaffinity_np(communicator_thread_, sizeof(cpuset_), &cpuset_))
-    {
-        ROS_FATAL("Set pthread affinity, not portable\n");
-        exit(1);
-    }
-#endif
-#ifdef DEADLINE_SCHEDULING
-    ROS_INFO("Size: %d, Policy: %u, Priority: %u, Runtime: %llu, Deadline: %llu, Period: %llu",
-             sched_attr_.size, sched_attr_.sched_policy,
-             sched_attr_.sched_priority, sched_attr_.sched_runtime, sched_attr_.sched_deadline, sched_attr_.sched_period);
-    if (sched_setattr(0, &sched_attr_, 0))
+    // the cycles left with the safe outputs, once stopping
+    int safe_cycles = rt_config_.stop_safe_cycles;
+    bool stopping = false;
+    struct timespec cycle_start_time, last_cycle_start_time;
+    // the cycles left for measuring the execution time, before switching to SCHED_DEADLINE
+    int calibration_cycles = 0;
+    uint64_t max_exec_ns = 0;
+
+    if (rt_config_.policy == SCHED_DEADLINE)
     {
-        ROS_FATAL("Set schedule attributes for DEADLINE scheduling\n");
-        exit(1);
+        if (rt_config_.runtime_ns)
+        {
+            int err = set_deadline_scheduling(rt_config_.runtime_ns);
+            if (err)
+            {
+                ROS_FATAL("Set schedule attributes for DEADLINE scheduling: %s. %s\n", strerror(err), sched_error_hint(err));
+                exit(1);
+            }
+            ROS_INFO("SCHED_DEADLINE: runtime %lu ns, deadline %lu ns, period %d ns\n", rt_config_.runtime_ns,
+                     rt_config_.deadline_ns, (int)PERIOD_NS);
+        }
+        else
+        {
+            calibration_cycles = rt_config_.calibration_cycles;
+            calibration_state_.store(CALIBRATION_RUNNING, std::memory_order_release);
+            ROS_INFO("Measuring the execution time for %d cycles, before switching to SCHED_DEADLINE\n",
+                     calibration_cycles);
+        }
     }
-#endif
+    // the domain may have been changed since the last run
+    output_image.invalidate();
     // get current time
     clock_gettime(CLOCK_TO_USE, &wakeup_time);
     clock_gettime(CLOCK_TO_USE, &break_time);
     break_time = utilities::timespec_add(break_time, offset_time);
-    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL); //PTHREAD_CANCEL_DEFERRED is the default but nevertheless
 
-    do
+    // canceled only by a stop() timing out, at the clock_nanosleep (which is a cancellation point)
+    for (;;)
     {
-        // check if there is a request for cancel
-        pthread_testcancel();
-        //set the cancel state to DISABLE
-        ret = pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
-        if (ret != 0)
-        {
-            handle_error_en(ret, "pthread_setcancelstate");
-        }
+        // a single relaxed load per cycle; the stop is noticed within one cycle
+        if (!stopping && stop_requested_.load(std::memory_order_relaxed))
+            stopping = true; // logged by stop()
+        if (stopping && safe_cycles-- <= 0)
+            break;
         wakeup_time = utilities::timespec_add(wakeup_time, cycletime);
         clock_nanosleep(CLOCK_TO_USE, TIMER_ABSTIME, &wakeup_time, NULL);
-#ifdef LOGGING
-        clock_gettime(CLOCK_TO_USE, & stat_struct.start_time);
-        create_statistics(&stat_struct, &wakeup_time);
-        stat_struct.last_start_time = stat_struct.start_time;
-#endif
+        clock_gettime(CLOCK_TO_USE, &cycle_start_time);
+        CYCLE_TRACE("wakeup", cycle);
+        wakeup_latency_histogram_.record(DIFF_NS(wakeup_time, cycle_start_time));
+        if (cycle != first_cycle)
+            period_histogram_.record(DIFF_NS(last_cycle_start_time, cycle_start_time));
+        last_cycle_start_time = cycle_start_time;
 
         // receive EtherCAT frame
-        ecrt_master_receive(master);
-        // receive process data
-        ecrt_domain_process(domain1);
-        // check the state of the domain
-        utilities::check_domain1_state();
+        CYCLE_TRACE("receive", cycle);
+        ethercat_master->receive();
+        CYCLE_TRACE("domain_process", cycle);
+        // receive process data, of the domains exchanged in the previous cycle, and check their state
+        for (int i = 0; i < domains_count; i++)
+            ethercat_domains[i].process();
+        EthercatCommunicator::process_sync_monitor();
+        // mirror the new inputs to the shared memory clients, as early as possible
+        if (shared_memory_mirror.enabled())
+            shared_memory_mirror.publish_inputs(cycle, TIMESPEC2NS(wakeup_time), domain1_pd);
 
         // get statistics if the flags are enabled
         if (!sampling_counter) //if sampling_counter is 0
         {
-            // do this at 10 Hz
-        #ifdef LOGGING
-            create_new_statistics_sample(&stat_struct, &sampling_counter);
-        #endif
-            // check for master state (optional)
+            // record the master state, at 10 Hz (one more ioctl), for the health monitor
             utilities::check_master_state();
+            sampling_counter = FREQUENCY / 10;
         }
         else sampling_counter--;
 
-        // move the data from process_data_buf to domain1_pd buf carefuly
-        utilities::copy_process_data_buffer_to_buf(domain1_pd);
-
+        CYCLE_TRACE("output_copy", cycle);
+        // a slave commanded again after a time out gets its whole outputs from the image
+        if (output_watchdog.update(TIMESPEC2NS(wakeup_time)))
+            output_image.invalidate();
+        // move the latest committed output image to domain1_pd buf, without locking,
+        // along with the commands scheduled for this cycle
+        utilities::copy_process_data_buffer_to_buf(domain1_pd, cycle);
+        // the outputs staged by the shared memory clients override the ones of their slaves
+        if (shared_memory_mirror.enabled() && shared_memory_mirror.apply_outputs(domain1_pd))
+            output_image.invalidate();
+        CYCLE_TRACE("controllers", cycle);
+        // the controllers run on the inputs of this cycle, and their outputs go out in this frame
+        if (controller_manager.enabled() && controller_manager.update(cycle, TIMESPEC2NS(wakeup_time), domain1_pd))
+            output_image.invalidate();
+        // after an overrun, with the safe_outputs policy, nobody drives the slaves until the fault is reset,
+        // and nobody drives them while stopping, or while their SYNC0 is reconfigured
+        if (stopping || overrun_fault_.load(std::memory_order_relaxed) || reconfiguring_.load(std::memory_order_relaxed))
+        {
+            utilities::clear_outputs(domain1_pd);
+            output_image.invalidate();
+        }
+        else
+            output_watchdog.apply(domain1_pd); // the slaves without recent commands get their safe outputs
 
-        // queue the EtherCAT data to domain buffer
-        ecrt_domain_queue(domain1);
+        CYCLE_TRACE("domain_queue", cycle);
+        // queue the EtherCAT data to domain buffer, of the domains exchanged in this cycle
+        for (int i = 0; i < domains_count; i++)
+            ethercat_domains[i].queue(cycle);
 
         // sync distributed clock just before master_send to set
         // most accurate master clock time. The two modes MASTER2REF and REF2MASTER should be supported.
         // However if the REF2MASTER doesn't work for some reason, comment the following line and comment out the
         // following ones.
+        CYCLE_TRACE("dc_sync", cycle);
         EthercatCommunicator::sync_distributed_clocks();
+        if (cycle == first_cycle)
+        {
+            // the phase of the cycles of this run, for restarting the SYNC0 of the slaves on them
+            run_first_cycle_ = cycle;
+            run_start_time_ns_.store(dc_time_ns_.load(std::memory_order_relaxed), std::memory_order_release);
+        }
 
         // write application time to master
 #ifdef SYNC_REF_TO_MASTER
@@ -545,83 +669,236 @@ void *EthercatCommunicator::run(void *arg)
         // ecrt_master_sync_slave_clocks(master);
 #endif
         // send EtherCAT frame
-        ecrt_master_send(master);
-
-        // send the raw data to the raw data topic
-        EthercatCommunicator::publish_raw_data();
-        // update the master clock with the drift, if SYNC_MASTER_TO_REF defined
+        CYCLE_TRACE("send", cycle);
+        ethercat_master->send();
+        if (cycle == 1)
+            startup_report::mark(STARTUP_FIRST_CYCLE);
+
+        // write the raw data to the ring, for the publishers and loggers
+        CYCLE_TRACE("publish", cycle);
+        EthercatCommunicator::publish_raw_data(cycle, TIMESPEC2NS(wakeup_time));
+        cycle_.store(++cycle, std::memory_order_relaxed);
+        // update the master clock with the correction of the DC servo, in the master_to_ref mode
         EthercatCommunicator::update_master_clock();
-        int ret = pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL); //set the cancel state to ENABLE
-        if (ret != 0)
+        CYCLE_TRACE("end", cycle - 1);
+        clock_gettime(CLOCK_TO_USE, &current_time);
+        uint64_t exec_ns = DIFF_NS(cycle_start_time, current_time);
+        exec_histogram_.record(exec_ns);
+        // deadline miss: the cycle ended after the next wakeup
+        int64_t late_ns = DIFF_NS(utilities::timespec_add(wakeup_time, cycletime), current_time);
+        if (late_ns >= 0)
+            EthercatCommunicator::handle_overrun(&wakeup_time, late_ns);
+        if (calibration_cycles)
+        {
+            if (exec_ns > max_exec_ns)
+                max_exec_ns = exec_ns;
+            if (!--calibration_cycles)
+            {
+                // never below the minimum runtime the kernel accepts (1024 ns)
+                uint64_t runtime_ns = (uint64_t)(max_exec_ns * rt_config_.runtime_margin);
+                if (runtime_ns < 1024)
+                    runtime_ns = 1024;
+                int state = CALIBRATION_DONE;
+                // recorded for the health monitor, which logs it
+                calibration_exec_ns_.store(max_exec_ns, std::memory_order_relaxed);
+                calibration_runtime_ns_.store(runtime_ns, std::memory_order_relaxed);
+                if (runtime_ns > rt_config_.deadline_ns)
+                    state = CALIBRATION_OVER_DEADLINE;
+                else
+                {
+                    int err = set_deadline_scheduling(runtime_ns);
+                    calibration_errno_.store(err, std::memory_order_relaxed);
+                    if (err)
+                        state = CALIBRATION_FAILED;
+                }
+                calibration_state_.store(state, std::memory_order_release);
+            }
+        }
+        if (!stopping && DIFF_NS(current_time, break_time) <= 0)
         {
-            handle_error_en(ret, "pthread_setcancelstate");
+            stopping = true;
+            run_time_expired_.store(true, std::memory_order_relaxed);
         }
-#ifdef LOGGING
-        clock_gettime(CLOCK_TO_USE, & stat_struct.end_time);
-#endif
-        clock_gettime(CLOCK_TO_USE, &current_time);
-    } while (DIFF_NS(current_time, break_time) > 0);
+    }
 
-#ifdef LOGGING
-    // write the statistics to file
-    log_statistics_to_file();
-#endif
     pthread_cleanup_pop(cleanup_pop_arg_);
-    running_thread_ = false;
-    exit(0);
+    running_thread_.store(false, std::memory_order_release);
+    // after the cycles: the realtime loop itself never logs
+    if (run_time_expired_.exchange(false, std::memory_order_relaxed))
+        ROS_INFO("The run time (%d s) expired: the cyclic thread stopped after %d cycles with the safe outputs, at cycle %lu\n",
+                 RUN_TIME, rt_config_.stop_safe_cycles, cycle);
+    else
+        ROS_INFO("The cyclic thread stopped, at cycle %lu\n", cycle);
+    return NULL;
 }
 //--------------------------------------------------------------------------//
 void EthercatCommunicator::stop()
 {
+    stop_thread(true);
+}
 
+void EthercatCommunicator::stop_thread(bool clear_outputs)
+{
     int ret;
     void *res;
-
-    ROS_INFO("stop(): sending cancellation request\n");
-    ret = pthread_cancel(communicator_thread_);
-    if (ret != 0)
-        handle_error_en(ret, "pthread_cancel");
-
-    /* Join with thread to see what its exit status was */
-
-    ret = pthread_join(communicator_thread_, &res);
+    int64_t timeout_ns = (int64_t)rt_config_.stop_timeout_ms * 1000000 + (int64_t)rt_config_.stop_safe_cycles * PERIOD_NS;
+    struct timespec timeout, timeout_time = {(time_t)(timeout_ns / NSEC_PER_SEC), (long)(timeout_ns % NSEC_PER_SEC)};
+
+    ROS_INFO("stop(): requesting the communicator thread to stop, after %d cycles with the safe outputs\n",
+             rt_config_.stop_safe_cycles);
+    stop_requested_.store(true, std::memory_order_relaxed);
+
+    // pthread_timedjoin_np waits on CLOCK_REALTIME
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout = utilities::timespec_add(timeout, timeout_time);
+    ret = pthread_timedjoin_np(communicator_thread_, &res, &timeout);
+    if (ret == ETIMEDOUT)
+    {
+        ROS_ERROR("stop(): the communicator thread didn't stop in %ld ms, canceling it\n", timeout_ns / 1000000);
+        ret = pthread_cancel(communicator_thread_);
+        if (ret != 0)
+            handle_error_en(ret, "pthread_cancel");
+        ret = pthread_join(communicator_thread_, &res);
+    }
+    joinable_thread_ = false;
     // ecrt_master_deactivate_slaves(master);
 
-    memset(process_data_buf, 0, total_process_data); // fill the buffer with zeros
+    // the scheduled commands are meant for this run only
+    output_image.discard_scheduled();
+
+    // kept across a change of the period, which holds the safe outputs through reconfiguring_ only
+    if (clear_outputs)
+    {
+        output_image.begin_write();
+        memset(process_data_buf, 0, total_process_data); // fill the buffer with zeros
+        output_image.commit();
+    }
     if (ret != 0)
         handle_error_en(ret, "pthread_join");
 
     if (res == PTHREAD_CANCELED)
+        ROS_WARN("stop(): communicator thread was canceled, the outputs may not be safe\n");
+    else
+        ROS_INFO("stop(): communicator thread stopped\n");
+    running_thread_.store(false, std::memory_order_release);
+}
+//--------------------------------------------------------------------------//
+/** The first SYNC0 pulse of a slave, restarted on the cycle grid of the current run
+ *
+ * The first exchange of the slave's domain at least DC_START_LEAD_NS after the latest cycle, shifted by
+ * \a sync0_shift, in application (system) time.
+ */
+uint64_t EthercatCommunicator::sync0_start_time_ns(int divider, int phase, int32_t sync0_shift)
+{
+    uint64_t start_ns = run_start_time_ns_.load(std::memory_order_acquire);
+    uint64_t now_ns = dc_time_ns_.load(std::memory_order_relaxed);
+    uint64_t cycle_ns = (uint64_t)PERIOD_NS * divider;
+    // the cycles of the domain, from the first cycle of the run
+    uint64_t first_ns = start_ns + ((phase + divider - run_first_cycle_ % divider) % divider) * (uint64_t)PERIOD_NS;
+
+    return first_ns + ((now_ns + DC_START_LEAD_NS - first_ns) / cycle_ns + 1) * cycle_ns + sync0_shift;
+}
+//--------------------------------------------------------------------------//
+/** Restart the SYNC0 of the DC slaves, with the current period
+ *
+ * Called with the realtime thread running (it carries out the register writes), and the safe outputs.
+ * \ret false if a slave couldn't be reconfigured.
+ */
+bool EthercatCommunicator::restart_sync0()
+{
+    uint64_t last_start_ns = 0;
+    int waited_ms = 0;
+
+    // the first cycle of the run sets the phase of the new cycles
+    while (!run_start_time_ns_.load(std::memory_order_acquire))
     {
-        ROS_INFO("stop(): communicator thread  was canceled\n");
-        running_thread_ = false;
+        if (waited_ms++ >= DC_REQUEST_TIMEOUT_MS || !running_thread_.load(std::memory_order_acquire))
+            return false;
+        usleep(1000);
     }
-    else
-        ROS_INFO("stop(): communicator thread wasn't canceled (shouldn't happen!)\n");
+    // first all of them off, so that no slave runs on the old cycle time next to the new ones
+    for (int i = 0; i < slaves_count; i++)
+        if (ethercat_slaves[i].slave.has_dc() && !ethercat_slaves[i].slave.stop_dc())
+            return false;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        EthercatSlave &slave = ethercat_slaves[i].slave;
+        EthercatDomain &domain = ethercat_domains[slave.get_domain()];
+
+        if (!slave.has_dc())
+            continue;
+        uint64_t start_ns = sync0_start_time_ns(domain.get_divider(), domain.get_phase(), slave.get_sync0_shift());
+        if (!slave.start_dc(start_ns))
+            return false;
+        last_start_ns = std::max(last_start_ns, start_ns);
+    }
+    // the outputs stay zero until every slave is synchronous again
+    while (dc_time_ns_.load(std::memory_order_relaxed) < last_start_ns)
+    {
+        if (!running_thread_.load(std::memory_order_acquire))
+            return false;
+        usleep(1000);
+    }
+    return true;
+}
+//--------------------------------------------------------------------------//
+bool EthercatCommunicator::change_period(int period_ns, int32_t sync0_shift)
+{
+    bool running = running_thread_.load(std::memory_order_acquire);
+    // a deadline equal to the period follows it
+    uint64_t deadline_ns = rt_config_.deadline_ns == (uint64_t)PERIOD_NS || rt_config_.deadline_ns > (uint64_t)period_ns
+                               ? period_ns : rt_config_.deadline_ns;
+
+    if (period_ns <= 0 || period_ns >= NSEC_PER_SEC || sync0_shift < 0 || sync0_shift >= period_ns)
+    {
+        ROS_ERROR("change_period(): expected 0 < period_ns < 1 s and 0 <= sync0_shift < period_ns\n");
+        return false;
+    }
+    if (rt_config_.runtime_ns > deadline_ns)
+    {
+        ROS_ERROR("change_period(): the realtime/deadline_runtime_ns (%lu ns) exceeds the new deadline (%lu ns)\n",
+                  rt_config_.runtime_ns, deadline_ns);
+        return false;
+    }
+    // the new SYNC0 of the slaves is written by the frames of the realtime thread
+    if (master_activated_ && !running)
+    {
+        ROS_ERROR("change_period(): the master is active: start the communicator, before changing the period\n");
+        return false;
+    }
+    if (running)
+    {
+        reconfiguring_.store(true, std::memory_order_relaxed);
+        stop_thread(false);
+    }
+    PERIOD_NS = period_ns;
+    FREQUENCY = NSEC_PER_SEC / period_ns;
+    rt_config_.deadline_ns = deadline_ns;
+    // kept by the master for its next configuration of the slaves (at the activation, or after an error)
+    for (int i = 0; i < slaves_count; i++)
+        ethercat_slaves[i].slave.configure_dc(sync0_shift);
+    ROS_INFO("change_period(): period %d ns, SYNC0 shift %d ns\n", period_ns, sync0_shift);
+    if (!running)
+        return true;
+
+    // the new run re-phases the cycles, to the time of its start
+    run_start_time_ns_.store(0, std::memory_order_relaxed);
+    start();
+    if (!restart_sync0())
+    {
+        ROS_ERROR("change_period(): the SYNC0 of the slaves couldn't be restarted, stopping the communicator\n");
+        if (running_thread_.load(std::memory_order_acquire))
+            stop();
+        reconfiguring_.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    reconfiguring_.store(false, std::memory_order_relaxed);
+    ROS_INFO("change_period(): the slaves are synchronous to the new period\n");
+    return true;
 }
 //--------------------------------------------------------------------------//
-void EthercatCommunicator::publish_raw_data()
-{
-    std::vector<uint8_t> input_data_raw, output_data_raw;
-    //Create input data raw string
-    std::vector<uint8_t> input_vec, output_vec;
-    unsigned char *raw_data_pointer;
-    for (int i = 0; i < master_info.slave_count; i++)
-    {
-        raw_data_pointer = (unsigned char *)domain1_pd + ethercat_slaves[i].slave.get_pdo_in();
-        input_vec.insert(std::end(input_vec), raw_data_pointer, raw_data_pointer + num_process_data_in);
-    }
-    input_data_raw.insert(std::end(input_data_raw), std::begin(input_vec), std::end(input_vec));
-    //Create output data raw string
-    for (int i = 0; i < master_info.slave_count; i++)
-    {
-        raw_data_pointer = (unsigned char *)domain1_pd + ethercat_slaves[i].slave.get_pdo_out();
-        output_vec.insert(std::end(output_vec), raw_data_pointer, raw_data_pointer + num_process_data_out);
-    }
-    output_data_raw.insert(std::end(output_data_raw), std::begin(output_vec), std::end(output_vec));
-    //Send both strings to the topic
-    ether_ros::PDORaw raw_data;
-    raw_data.pdo_in_raw = input_data_raw;
-    raw_data.pdo_out_raw = output_data_raw;
-    pdo_raw_pub_.publish(raw_data);
+void EthercatCommunicator::publish_raw_data(uint64_t cycle, uint64_t timestamp_ns)
+{
+    // a single copy of the domain to the ring; the readers do the rest in their own threads
+    pdo_raw_ring.write(cycle, timestamp_ns, domain1_pd);
 }
@@ -0,0 +1,227 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file ethercat_domain.cpp
+   \brief Implementation of EthercatDomain class.
+
+   Used for exchanging the PDOs of a group of slaves at its own rate, and for monitoring
+   its working counter. The domains are fetched from the ROS Parameter Server
+   (after they are loaded from ethercat_slaves.yaml).
+*/
+
+/*****************************************************************************/
+
+#include "ethercat_domain.h"
+#include "ether_ros.h"
+
+void EthercatDomain::init(const std::string &name, int divider, int phase)
+{
+    name_ = name;
+    divider_ = divider;
+    phase_ = phase;
+    offset_ = 0;
+    size_ = 0;
+    state_.working_counter = 0;
+    state_.wc_state = EC_WC_ZERO;
+    queued_ = false;
+    exchanges_.store(0, std::memory_order_relaxed);
+    wkc_errors_.store(0, std::memory_order_relaxed);
+    working_counter_.store(0, std::memory_order_relaxed);
+    wc_state_.store(EC_WC_ZERO, std::memory_order_relaxed);
+
+    domain_ = ethercat_master->create_domain();
+    if (domain_ < 0)
+    {
+        ROS_FATAL("Failed to create domain %s.\n", name_.c_str());
+        exit(1);
+    }
+    ROS_INFO("Domain %s: exchanged every %d cycles (phase %d)\n", name_.c_str(), divider_, phase_);
+}
+
+void EthercatDomain::set_offset(size_t offset)
+{
+    offset_ = offset;
+    size_ = ethercat_master->domain_size(domain_);
+    ROS_INFO("Domain %s: %lu bytes at offset %lu of the process image\n", name_.c_str(), size_, offset_);
+}
+
+void EthercatDomain::activate(uint8_t *process_image)
+{
+    uint8_t *pd = ethercat_master->domain_data(domain_);
+
+    if (size_ && pd != process_image + offset_)
+    {
+        ROS_FATAL("The data of domain %s aren't at offset %lu of the process image\n", name_.c_str(), offset_);
+        exit(1);
+    }
+}
+
+void EthercatDomain::process()
+{
+    ec_domain_state_t ds;
+
+    // the datagrams of the domain are in the frame, only in the cycle after the one it was queued
+    if (!queued_)
+        return;
+    ethercat_master->domain_process(domain_);
+    ethercat_master->domain_state(domain_, &ds);
+
+    // only recorded: the health monitor logs the drops of the working counter, outside of the realtime thread
+    state_ = ds;
+    exchanges_.store(exchanges_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ds.wc_state != EC_WC_COMPLETE)
+        wkc_errors_.store(wkc_errors_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    working_counter_.store(ds.working_counter, std::memory_order_relaxed);
+    wc_state_.store(ds.wc_state, std::memory_order_relaxed);
+}
+
+void EthercatDomain::queue(uint64_t cycle)
+{
+    queued_ = (int)(cycle % divider_) == phase_;
+    if (queued_)
+        ethercat_master->domain_queue(domain_);
+}
+
+const std::string &EthercatDomain::get_name()
+{
+    return name_;
+}
+
+int EthercatDomain::get_divider()
+{
+    return divider_;
+}
+
+int EthercatDomain::get_phase()
+{
+    return phase_;
+}
+
+int EthercatDomain::get_domain()
+{
+    return domain_;
+}
+
+size_t EthercatDomain::get_offset()
+{
+    return offset_;
+}
+
+size_t EthercatDomain::get_size()
+{
+    return size_;
+}
+
+uint64_t EthercatDomain::exchanges() const
+{
+    return exchanges_.load(std::memory_order_relaxed);
+}
+
+uint64_t EthercatDomain::wkc_errors() const
+{
+    return wkc_errors_.load(std::memory_order_relaxed);
+}
+
+unsigned int EthercatDomain::working_counter() const
+{
+    return working_counter_.load(std::memory_order_relaxed);
+}
+
+int EthercatDomain::wc_state() const
+{
+    return wc_state_.load(std::memory_order_relaxed);
+}
+
+void init_ethercat_domains(ros::NodeHandle &n)
+{
+    XmlRpc::XmlRpcValue list;
+
+    if (!n.getParam("/ethercat_slaves/domains", list))
+    {
+        domains_count = 1;
+        ethercat_domains = new EthercatDomain[domains_count];
+        ethercat_domains[0].init("main", 1, 0);
+        return;
+    }
+    if (list.getType() != XmlRpc::XmlRpcValue::TypeArray || list.size() == 0)
+    {
+        ROS_FATAL("/ethercat_slaves/domains must be a non empty list\n");
+        exit(1);
+    }
+    domains_count = list.size();
+    ethercat_domains = new EthercatDomain[domains_count];
+    for (int i = 0; i < domains_count; i++)
+    {
+        XmlRpc::XmlRpcValue &entry = list[i];
+        int divider, phase;
+
+        if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("name") ||
+            entry["name"].getType() != XmlRpc::XmlRpcValue::TypeString)
+        {
+            ROS_FATAL("/ethercat_slaves/domains[%d]: every domain needs a name string\n", i);
+            exit(1);
+        }
+        if ((entry.hasMember("divider") && entry["divider"].getType() != XmlRpc::XmlRpcValue::TypeInt) ||
+            (entry.hasMember("phase") && entry["phase"].getType() != XmlRpc::XmlRpcValue::TypeInt))
+        {
+            ROS_FATAL("/ethercat_slaves/domains[%d]: the divider and the phase must be integers\n", i);
+            exit(1);
+        }
+        std::string name = static_cast<std::string &>(entry["name"]);
+        divider = entry.hasMember("divider") ? static_cast<int &>(entry["divider"]) : 1;
+        phase = entry.hasMember("phase") ? static_cast<int &>(entry["phase"]) : 0;
+        if (divider < 1 || phase < 0 || phase >= divider)
+        {
+            ROS_FATAL("/ethercat_slaves/domains[%d]: the divider must be positive and the phase less than it\n", i);
+            exit(1);
+        }
+        // only the domains before this one are initialized
+        for (int j = 0; j < i; j++)
+        {
+            if (ethercat_domains[j].get_name() == name)
+            {
+                ROS_FATAL("/ethercat_slaves/domains[%d]: duplicate domain %s\n", i, name.c_str());
+                exit(1);
+            }
+        }
+        ethercat_domains[i].init(name, divider, phase);
+    }
+}
+
+int find_ethercat_domain(const std::string &name)
+{
+    for (int i = 0; i < domains_count; i++)
+    {
+        if (ethercat_domains[i].get_name() == name)
+            return i;
+    }
+    return -1;
+}
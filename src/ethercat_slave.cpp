@@ -39,109 +39,192 @@
 
 /*****************************************************************************/
 #include <iostream>
+#include <algorithm>
+#include <unistd.h>
 #include "ethercat_slave.h"
 #include "ether_ros.h"
 
-void EthercatSlave::init(std::string slave, ros::NodeHandle &n)
+// an integer of the map of a slave, or exits
+static int slave_int(XmlRpc::XmlRpcValue &entry, const std::string &slave, const char *key)
 {
-
-    slave_id_ = slave;
-    std::string slave_root_loc = std::string("/ethercat_slaves/") + slave + "/";
-
-    while (!n.getParam(slave_root_loc + "vendor_id", vendor_id_))
+    if (!entry.hasMember(key) || entry[key].getType() != XmlRpc::XmlRpcValue::TypeInt)
     {
-        ROS_INFO("Waiting the parameter server to initialize\n");
+        ROS_FATAL("Slave %s: /ethercat_slaves/%s/%s must be an integer\n", slave.c_str(), slave.c_str(), key);
+        exit(1);
     }
-    ROS_INFO("Got param: slave_root_loc + vendor_id = %2.2x\n", vendor_id_);
+    return static_cast<int &>(entry[key]);
+}
 
-    if (n.getParam(slave_root_loc + "alias", alias_))
-    {
-        ROS_INFO("Got param: slave_root_loc + alias = %d\n", alias_);
-    }
-    else
+// a string of the map of a slave, or default_value
+static std::string slave_string(XmlRpc::XmlRpcValue &entry, const std::string &slave, const char *key,
+                                const std::string &default_value)
+{
+    if (!entry.hasMember(key))
+        return default_value;
+    if (entry[key].getType() != XmlRpc::XmlRpcValue::TypeString)
     {
-        ROS_FATAL("Failed to get param 'slave_root_loc + alias'\n");
+        ROS_FATAL("Slave %s: /ethercat_slaves/%s/%s must be a string\n", slave.c_str(), slave.c_str(), key);
+        exit(1);
     }
+    return static_cast<std::string &>(entry[key]);
+}
 
-    if (n.getParam(slave_root_loc + "position", position_))
-    {
-        ROS_INFO("Got param: slave_root_loc + position = %d\n", position_);
-    }
-    else
-    {
-        ROS_FATAL("Failed to get param 'slave_root_loc + position'\n");
-    }
+void EthercatSlave::init(std::string slave, XmlRpc::XmlRpcValue &params, XmlRpc::XmlRpcValue &layouts)
+{
+    XmlRpc::XmlRpcValue &entry = params[slave];
 
-    if (n.getParam(slave_root_loc + "product_code", product_code_))
-    {
-        ROS_INFO("Got param: slave_root_loc + product_code = %2.2x\n", product_code_);
-    }
-    else
+    slave_id_ = slave;
+    // everything comes from the trees fetched once: no round trip to the parameter server
+    vendor_id_ = slave_int(entry, slave, "vendor_id");
+    alias_ = entry.hasMember("alias") ? slave_int(entry, slave, "alias") : 0;
+    position_ = slave_int(entry, slave, "position");
+    product_code_ = slave_int(entry, slave, "product_code");
+    assign_activate_ = slave_int(entry, slave, "assign_activate");
+    input_port_ = slave_int(entry, slave, "input_port");
+    output_port_ = slave_int(entry, slave, "output_port");
+    if (!params.hasMember("sync0_shift") || params["sync0_shift"].getType() != XmlRpc::XmlRpcValue::TypeInt)
     {
-        ROS_FATAL("Failed to get param 'slave_root_loc + product_code'\n");
+        ROS_FATAL("/ethercat_slaves/sync0_shift must be an integer\n");
+        exit(1);
     }
+    sync0_shift_ = static_cast<int &>(params["sync0_shift"]);
 
-    if (n.getParam(slave_root_loc + "assign_activate", assign_activate_))
+    std::string pdo_layout = slave_string(entry, slave, "pdo_layout", "");
+    if (!pdo_layout.empty())
     {
-        ROS_INFO("Got param: slave_root_loc + assign_activate = %2.2x\n", assign_activate_);
+        if (layouts.getType() != XmlRpc::XmlRpcValue::TypeStruct || !layouts.hasMember(pdo_layout) ||
+            layouts[pdo_layout].getType() != XmlRpc::XmlRpcValue::TypeStruct ||
+            !layouts[pdo_layout].hasMember("pdo_in") || !layouts[pdo_layout].hasMember("pdo_out") ||
+            !pdo_in_layout_.load(layouts[pdo_layout]["pdo_in"], "/pdo_layouts/" + pdo_layout + "/pdo_in") ||
+            !pdo_out_layout_.load(layouts[pdo_layout]["pdo_out"], "/pdo_layouts/" + pdo_layout + "/pdo_out"))
+        {
+            ROS_FATAL("Failed to load the PDO layout '%s'\n", pdo_layout.c_str());
+            exit(1);
+        }
     }
     else
     {
-        ROS_FATAL("Failed to get param 'slave_root_loc + assign_activate'\n");
+        ROS_WARN("No param '/ethercat_slaves/%s/pdo_layout': the PDOs of %s won't be decoded\n", slave.c_str(), slave.c_str());
     }
 
-    if (n.getParam(slave_root_loc + "input_port", input_port_))
-    {
-        ROS_INFO("Got param: slave_root_loc + input_port = %2.2x\n", input_port_);
-    }
-    else
+    std::string domain = slave_string(entry, slave, "domain", ethercat_domains[0].get_name());
+    domain_ = find_ethercat_domain(domain);
+    if (domain_ < 0)
     {
-        ROS_FATAL("Failed to get param 'slave_root_loc + input_port'\n");
+        ROS_FATAL("Slave %s: no domain %s in /ethercat_slaves/domains\n", slave.c_str(), domain.c_str());
+        exit(1);
     }
+    int ec_domain = ethercat_domains[domain_].get_domain();
 
-    if (n.getParam(slave_root_loc + "output_port", output_port_))
-    {
-        ROS_INFO("Got param: slave_root_loc + output_port = %2.2x\n", output_port_);
-    }
-    else
-    {
-        ROS_FATAL("Failed to get param 'slave_root_loc + output_port'\n");
-    }
-    ethercat_slave_ = ecrt_master_slave_config(master, alias_, position_, vendor_id_, product_code_);
-    if (!ethercat_slave_)
+    ethercat_slave_ = ethercat_master->slave_config(alias_, position_, vendor_id_, product_code_);
+    if (ethercat_slave_ < 0)
     {
         ROS_FATAL("Failed to get slave configuration.\n");
         exit(1);
     }
-    pdo_out_ = ecrt_slave_config_reg_pdo_entry(ethercat_slave_, output_port_, 1, domain1, NULL);
+    pdo_out_ = ethercat_master->reg_pdo_entry(ethercat_slave_, output_port_, 1, ec_domain);
     if (pdo_out_ < 0)
     {
         ROS_FATAL("Failed to configure pdo out.\n");
         exit(1);
     }
-    ROS_INFO("Offset pdo out is: %d\n", pdo_out_);
 
-    pdo_in_ = ecrt_slave_config_reg_pdo_entry(ethercat_slave_, input_port_, 1, domain1, NULL);
+    pdo_in_ = ethercat_master->reg_pdo_entry(ethercat_slave_, input_port_, 1, ec_domain);
     if (pdo_in_ < 0)
     {
         ROS_FATAL("Failed to configure pdo in.\n");
         exit(1);
     }
-    ROS_INFO("Offset pdo in is: %d\n", pdo_in_);
+    // configure SYNC signals for this slave
+    //For XMC use: 0x0300
+    //For Beckhoff FB1111 use: 0x0700
+    configure_dc(sync0_shift_);
+    // the DC registers are rewritten through it when the period changes, after the activation
+    dc_request_ = -1;
+    if (assign_activate_)
+    {
+        dc_request_ = ethercat_master->create_reg_request(ethercat_slave_, 8);
+        if (dc_request_ < 0)
+        {
+            ROS_FATAL("Failed to create the register request of the slave.\n");
+            exit(1);
+        }
+    }
+    ROS_INFO("Slave %s: %d:%d, vendor 0x%x, product 0x%x, ports 0x%x/0x%x, layout '%s', domain %s, pdo out at %d, pdo in at %d\n",
+             slave.c_str(), alias_, position_, vendor_id_, product_code_, output_port_, input_port_,
+             pdo_layout.c_str(), domain.c_str(), pdo_out_, pdo_in_);
+}
 
-    if (n.getParam("/ethercat_slaves/sync0_shift", sync0_shift_))
+void EthercatSlave::configure_dc(int32_t sync0_shift)
+{
+    sync0_shift_ = sync0_shift;
+    //Use the exchange period of the slave's domain as the period
+    ethercat_master->config_dc(ethercat_slave_, assign_activate_, PERIOD_NS * ethercat_domains[domain_].get_divider(), sync0_shift_);
+}
+
+bool EthercatSlave::write_register(uint16_t address, const uint8_t *data, size_t size)
+{
+    ec_request_state_t state;
+    int waited_ms = 0;
+
+    ethercat_master->reg_request_write(dc_request_, address, data, size);
+    // carried out with the frames of the realtime thread
+    while ((state = ethercat_master->reg_request_state(dc_request_)) == EC_REQUEST_BUSY ||
+           state == EC_REQUEST_UNUSED)
     {
-        ROS_INFO("Got param: /ethercat_slaves/sync0_shift = %2.2x\n", sync0_shift_);
+        if (waited_ms >= DC_REQUEST_TIMEOUT_MS)
+            break;
+        usleep(1000);
+        waited_ms++;
     }
-    else
+    if (state != EC_REQUEST_SUCCESS)
     {
-        ROS_FATAL("Failed to get param '/ethercat_slaves/sync0_shift'\n");
+        ROS_ERROR("Slave %s: failed to write the register 0x%04x%s\n", slave_id_.c_str(), address,
+                  state == EC_REQUEST_ERROR ? "" : " (timed out)");
+        return false;
     }
-    // configure SYNC signals for this slave
-    //For XMC use: 0x0300
-    //For Beckhoff FB1111 use: 0x0700
-    //Use PERIOD_NS as the period, and 50 μs shift time
-    ecrt_slave_config_dc(ethercat_slave_, assign_activate_, PERIOD_NS, sync0_shift_, 0, 0);
+    return true;
+}
+
+bool EthercatSlave::stop_dc()
+{
+    uint8_t data[8];
+
+    // the cyclic operation must be off, for the cycle times and the start time to be taken
+    EC_WRITE_U16(data, 0);
+    if (!write_register(0x0980, data, 2))
+        return false;
+    EC_WRITE_U32(data, PERIOD_NS * ethercat_domains[domain_].get_divider());
+    EC_WRITE_U32(data + 4, 0);
+    return write_register(0x09A0, data, 8);
+}
+
+bool EthercatSlave::start_dc(uint64_t start_time_ns)
+{
+    uint8_t data[8];
+
+    EC_WRITE_U64(data, start_time_ns);
+    if (!write_register(0x0990, data, 8))
+        return false;
+    EC_WRITE_U16(data, assign_activate_);
+    return write_register(0x0980, data, 2);
+}
+
+bool EthercatSlave::has_dc()
+{
+    return assign_activate_ != 0;
+}
+
+int32_t EthercatSlave::get_sync0_shift()
+{
+    return sync0_shift_;
+}
+
+void EthercatSlave::relocate(int domain_offset)
+{
+    // from offsets in the domain, to offsets in the process image
+    pdo_out_ += domain_offset;
+    pdo_in_ += domain_offset;
 }
 
 int EthercatSlave::get_pdo_in()
@@ -153,7 +236,120 @@ int EthercatSlave::get_pdo_out()
 {
     return pdo_out_;
 }
-ec_slave_config_t *EthercatSlave::get_slave_config()
+int EthercatSlave::get_domain()
+{
+    return domain_;
+}
+
+int EthercatSlave::get_slave_config()
 {
     return ethercat_slave_;
 }
+
+const PDOLayout &EthercatSlave::get_pdo_in_layout()
+{
+    return pdo_in_layout_;
+}
+
+const PDOLayout &EthercatSlave::get_pdo_out_layout()
+{
+    return pdo_out_layout_;
+}
+
+bool fetch_parameters(ros::NodeHandle &n, const std::string &name, XmlRpc::XmlRpcValue &value, int timeout_ms)
+{
+    int waited_ms = 0;
+    int backoff_ms = PARAMETERS_BACKOFF_MIN_MS;
+
+    // a single round trip for the whole tree; the parameter server may still be loading it
+    while (!n.getParam(name, value))
+    {
+        if (waited_ms >= timeout_ms)
+            return false;
+        if (!waited_ms)
+            ROS_INFO("Waiting for %s in the parameter server (at most %d ms)\n", name.c_str(), timeout_ms);
+        usleep(backoff_ms * 1000);
+        waited_ms += backoff_ms;
+        backoff_ms = std::min(2 * backoff_ms, PARAMETERS_BACKOFF_MAX_MS);
+    }
+    return true;
+}
+
+std::vector<std::string> find_configured_slaves(XmlRpc::XmlRpcValue &params)
+{
+    std::vector<std::pair<std::pair<int, int>, std::string> > slaves;
+    std::vector<std::string> names;
+
+    if (params.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+        ROS_FATAL("/ethercat_slaves must be a map\n");
+        exit(1);
+    }
+    // every map with a position is a slave
+    for (XmlRpc::XmlRpcValue::iterator it = params.begin(); it != params.end(); it++)
+    {
+        XmlRpc::XmlRpcValue &entry = it->second;
+        if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("position"))
+            continue;
+        int alias = entry.hasMember("alias") ? slave_int(entry, it->first, "alias") : 0;
+        slaves.push_back(std::make_pair(std::make_pair(alias, slave_int(entry, it->first, "position")), it->first));
+    }
+    // in the order of the bus
+    std::sort(slaves.begin(), slaves.end());
+    for (size_t i = 0; i < slaves.size(); i++)
+        names.push_back(slaves[i].second);
+    return names;
+}
+
+std::vector<std::string> find_configured_slaves(ros::NodeHandle &n)
+{
+    XmlRpc::XmlRpcValue params;
+
+    if (!fetch_parameters(n, "/ethercat_slaves", params, PARAMETERS_TIMEOUT_MS))
+    {
+        ROS_FATAL("No /ethercat_slaves in the parameter server after %d ms\n", PARAMETERS_TIMEOUT_MS);
+        exit(1);
+    }
+    return find_configured_slaves(params);
+}
+
+void init_slave_offsets()
+{
+    slave_offsets = new slave_pd_offsets[slaves_count];
+    total_pdo_in = 0;
+    total_pdo_out = 0;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        EthercatSlave &slave = ethercat_slaves[i].slave;
+        EthercatDomain &domain = ethercat_domains[slave.get_domain()];
+        // the inputs end where the next PDOs of the domain begin (or with the domain)
+        size_t pdo_in_end = domain.get_offset() + domain.get_size();
+
+        for (int j = 0; j < slaves_count; j++)
+        {
+            EthercatSlave &other = ethercat_slaves[j].slave;
+            if (other.get_domain() != slave.get_domain())
+                continue;
+            if (other.get_pdo_out() > slave.get_pdo_in() && (size_t)other.get_pdo_out() < pdo_in_end)
+                pdo_in_end = other.get_pdo_out();
+            if (other.get_pdo_in() > slave.get_pdo_in() && (size_t)other.get_pdo_in() < pdo_in_end)
+                pdo_in_end = other.get_pdo_in();
+        }
+        if (slave.get_pdo_in() < slave.get_pdo_out())
+        {
+            ROS_FATAL("Slave %s: the input PDOs precede the output PDOs in the domain\n", ethercat_slaves[i].slave_name.c_str());
+            exit(1);
+        }
+        slave_offsets[i].pdo_out = slave.get_pdo_out();
+        slave_offsets[i].pdo_out_size = slave.get_pdo_in() - slave.get_pdo_out();
+        slave_offsets[i].pdo_in = slave.get_pdo_in();
+        slave_offsets[i].pdo_in_size = pdo_in_end - slave.get_pdo_in();
+        slave_offsets[i].raw_out = total_pdo_out;
+        slave_offsets[i].raw_in = total_pdo_in;
+        total_pdo_out += slave_offsets[i].pdo_out_size;
+        total_pdo_in += slave_offsets[i].pdo_in_size;
+        ROS_INFO("Slave %s: %u output bytes at %u, %u input bytes at %u\n", ethercat_slaves[i].slave_name.c_str(),
+                 slave_offsets[i].pdo_out_size, slave_offsets[i].pdo_out,
+                 slave_offsets[i].pdo_in_size, slave_offsets[i].pdo_in);
+    }
+}
@@ -0,0 +1,385 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file health_monitor.cpp
+   \brief Implementation of the HealthMonitor class.
+
+   The states of the master and of the domains are recorded by the realtime thread without logging;
+   they are checked, logged and published to \a /diagnostics from the telemetry callbacks.
+*/
+
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "health_monitor.h"
+#include "ether_ros.h"
+
+static void add_value(diagnostic_msgs::DiagnosticStatus &status, const std::string &key, const std::string &value)
+{
+    diagnostic_msgs::KeyValue key_value;
+
+    key_value.key = key;
+    key_value.value = value;
+    status.values.push_back(key_value);
+}
+
+static void add_value(diagnostic_msgs::DiagnosticStatus &status, const std::string &key, uint64_t value)
+{
+    add_value(status, key, std::to_string((unsigned long long)value));
+}
+
+static void add_rate(diagnostic_msgs::DiagnosticStatus &status, const std::string &key, double rate)
+{
+    char value[32];
+
+    snprintf(value, sizeof(value), "%.6f", rate);
+    add_value(status, key, std::string(value));
+}
+
+HealthMonitor::HealthMonitor()
+    : rt_master_state_(), rt_recorded_(false), slaves_responding_(0), al_states_(0), link_up_(false),
+      link_downs_(0), al_state_changes_(0), wkc_error_rate_warn_(0), slaves_responding_seen_(0),
+      al_states_seen_(0), link_up_seen_(false), link_downs_seen_(0), al_state_changes_seen_(0),
+      calibration_seen_(CALIBRATION_NONE)
+{
+}
+
+void HealthMonitor::init(ros::NodeHandle &n)
+{
+    double rate;
+
+    n.param("/ethercat_slaves/health/rate", rate, 1.0);
+    n.param("/ethercat_slaves/health/wkc_error_rate_warn", wkc_error_rate_warn_, 0.001);
+    if (rate <= 0 || wkc_error_rate_warn_ < 0)
+    {
+        ROS_FATAL("/ethercat_slaves/health: expected rate > 0 and wkc_error_rate_warn >= 0\n");
+        exit(1);
+    }
+    domain_health d = {};
+    domains_.assign(domains_count, d);
+    slave_health s = {};
+    slaves_.assign(slaves_count, s);
+    controllers_enabled_seen_.assign(controller_manager.size(), true);
+
+    diagnostics_pub_ = n.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+    if (!diagnostics_pub_)
+    {
+        ROS_FATAL("Unable to start publisher in HealthMonitor\n");
+        exit(1);
+    }
+    health_timer_ = n.createTimer(ros::Duration(1.0 / rate), &HealthMonitor::timer_callback, this);
+    if (!health_timer_)
+    {
+        ROS_FATAL("Unable to start the timer of HealthMonitor\n");
+        exit(1);
+    }
+}
+
+void HealthMonitor::record_master_state(const ec_master_state_t &state)
+{
+    // the changes are counted here, so the ones between two samples of the timer aren't lost
+    if (rt_recorded_)
+    {
+        if (rt_master_state_.link_up && !state.link_up)
+            link_downs_.store(link_downs_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (rt_master_state_.al_states != state.al_states)
+            al_state_changes_.store(al_state_changes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    rt_master_state_ = state;
+    rt_recorded_ = true;
+    slaves_responding_.store(state.slaves_responding, std::memory_order_relaxed);
+    al_states_.store(state.al_states, std::memory_order_relaxed);
+    link_up_.store(state.link_up, std::memory_order_relaxed);
+}
+
+void HealthMonitor::check_calibration()
+{
+    uint64_t max_exec_ns, runtime_ns;
+    int err;
+    int state = EthercatCommunicator::deadline_calibration(&max_exec_ns, &runtime_ns, &err);
+
+    // measured and applied by the realtime thread, which doesn't log
+    if (state == calibration_seen_)
+        return;
+    calibration_seen_ = state;
+    if (state == CALIBRATION_DONE)
+        ROS_INFO("Maximum measured execution time: %lu ns; SCHED_DEADLINE with a runtime of %lu ns\n",
+                 (unsigned long)max_exec_ns, (unsigned long)runtime_ns);
+    else if (state == CALIBRATION_OVER_DEADLINE)
+        ROS_ERROR("Maximum measured execution time: %lu ns; the derived runtime (%lu ns) exceeds the deadline, staying in SCHED_FIFO\n",
+                  (unsigned long)max_exec_ns, (unsigned long)runtime_ns);
+    else if (state == CALIBRATION_FAILED)
+        ROS_ERROR("Set schedule attributes for DEADLINE scheduling (runtime %lu ns): %s. Staying in SCHED_FIFO\n",
+                  (unsigned long)runtime_ns, strerror(err));
+}
+
+void HealthMonitor::check_master(diagnostic_msgs::DiagnosticArray &diagnostics)
+{
+    diagnostic_msgs::DiagnosticStatus status;
+    unsigned int responding = slaves_responding_.load(std::memory_order_relaxed);
+    unsigned int al_states = al_states_.load(std::memory_order_relaxed);
+    bool link_up = link_up_.load(std::memory_order_relaxed);
+    uint64_t link_downs = link_downs_.load(std::memory_order_relaxed);
+    uint64_t al_state_changes = al_state_changes_.load(std::memory_order_relaxed);
+    char message[64];
+
+    if (link_downs != link_downs_seen_)
+        ROS_WARN("Link went down %lu time(s), it's %s.\n", (unsigned long)(link_downs - link_downs_seen_), link_up ? "up" : "down");
+    else if (link_up != link_up_seen_)
+        ROS_INFO("Link is %s.\n", link_up ? "up" : "down");
+    if (responding != slaves_responding_seen_)
+        ROS_INFO("%u slave(s).\n", responding);
+    if (al_states != al_states_seen_ || al_state_changes != al_state_changes_seen_)
+        ROS_INFO("AL states: 0x%02X (%lu change(s)).\n", al_states, (unsigned long)(al_state_changes - al_state_changes_seen_));
+
+    status.name = "ether_ros: master";
+    status.hardware_id = "EtherCAT master";
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "OK";
+    if (!EthercatCommunicator::has_running_thread())
+    {
+        status.level = diagnostic_msgs::DiagnosticStatus::STALE;
+        status.message = "The EtherCAT Communicator isn't running";
+    }
+    else if (!link_up)
+    {
+        status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+        status.message = "Link down";
+    }
+    else if ((int)responding < slaves_count)
+    {
+        snprintf(message, sizeof(message), "%u of %d slaves responding", responding, slaves_count);
+        status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+        status.message = message;
+    }
+    else if (link_downs != link_downs_seen_)
+    {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message = "Link flapping";
+    }
+    add_value(status, "link_up", link_up ? "true" : "false");
+    add_value(status, "slaves_responding", responding);
+    snprintf(message, sizeof(message), "0x%02X", al_states);
+    add_value(status, "al_states", std::string(message));
+    add_value(status, "link_downs", link_downs);
+    add_value(status, "al_state_changes", al_state_changes);
+    diagnostics.status.push_back(status);
+
+    slaves_responding_seen_ = responding;
+    al_states_seen_ = al_states;
+    link_up_seen_ = link_up;
+    link_downs_seen_ = link_downs;
+    al_state_changes_seen_ = al_state_changes;
+}
+
+void HealthMonitor::check_domains(diagnostic_msgs::DiagnosticArray &diagnostics)
+{
+    for (int i = 0; i < domains_count; i++)
+    {
+        diagnostic_msgs::DiagnosticStatus status;
+        EthercatDomain &domain = ethercat_domains[i];
+        domain_health &health = domains_[i];
+        uint64_t exchanges = domain.exchanges();
+        uint64_t wkc_errors = domain.wkc_errors();
+        uint64_t new_exchanges = exchanges - health.exchanges;
+        uint64_t new_errors = wkc_errors - health.wkc_errors;
+
+        health.error_rate = new_exchanges ? (double)new_errors / new_exchanges : 0;
+        if (new_errors)
+            ROS_WARN("Domain %s: %lu of %lu exchanges with an incomplete working counter (WC %u, state %d).\n",
+                     domain.get_name().c_str(), (unsigned long)new_errors, (unsigned long)new_exchanges,
+                     domain.working_counter(), domain.wc_state());
+        status.name = "ether_ros: domain " + domain.get_name();
+        status.hardware_id = "EtherCAT domain " + domain.get_name();
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.message = "OK";
+        if (!new_exchanges)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::STALE;
+            status.message = "Not exchanged";
+        }
+        else if (domain.wc_state() != EC_WC_COMPLETE)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+            status.message = domain.wc_state() == EC_WC_ZERO ? "Working counter zero" : "Working counter incomplete";
+        }
+        else if (health.error_rate > wkc_error_rate_warn_)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+            status.message = "Working counter drops";
+        }
+        add_value(status, "working_counter", domain.working_counter());
+        add_value(status, "wc_state", domain.wc_state());
+        add_value(status, "exchanges", exchanges);
+        add_value(status, "wkc_errors", wkc_errors);
+        add_rate(status, "wkc_error_rate", health.error_rate);
+        diagnostics.status.push_back(status);
+
+        health.exchanges = exchanges;
+        health.wkc_errors = wkc_errors;
+    }
+}
+
+void HealthMonitor::check_slaves(diagnostic_msgs::DiagnosticArray &diagnostics)
+{
+    char message[64];
+
+    for (int i = 0; i < slaves_count; i++)
+    {
+        diagnostic_msgs::DiagnosticStatus status;
+        EthercatSlave &slave = ethercat_slaves[i].slave;
+        slave_health &health = slaves_[i];
+        ec_slave_config_state_t state;
+        double domain_error_rate = domains_[slave.get_domain()].error_rate;
+
+        // a query of the master, from this (non realtime) thread
+        ethercat_master->slave_config_state(slave.get_slave_config(), &state);
+        if (health.samples && (state.online != health.state.online || state.operational != health.state.operational ||
+                               state.al_state != health.state.al_state))
+        {
+            ROS_WARN("Slave %s: %s, %s, AL state 0x%02X.\n", ethercat_slaves[i].slave_name.c_str(),
+                     state.online ? "online" : "offline", state.operational ? "operational" : "not operational",
+                     state.al_state);
+            health.state_changes++;
+        }
+        health.state = state;
+        health.samples++;
+        if (!state.online || !state.operational)
+            health.errors++;
+
+        status.name = "ether_ros: slave " + ethercat_slaves[i].slave_name;
+        status.hardware_id = "EtherCAT slave " + ethercat_slaves[i].slave_name;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.message = "OK";
+        if (!state.online)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+            status.message = "Offline";
+        }
+        else if (!state.operational)
+        {
+            snprintf(message, sizeof(message), "Not operational (AL state 0x%02X)", state.al_state);
+            status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+            status.message = message;
+        }
+        else if (domain_error_rate > wkc_error_rate_warn_)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+            status.message = "Working counter drops in its domain";
+        }
+        else if (output_watchdog.expired(i))
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+            status.message = "No recent commands, safe outputs";
+        }
+        add_value(status, "online", state.online ? "true" : "false");
+        add_value(status, "operational", state.operational ? "true" : "false");
+        snprintf(message, sizeof(message), "0x%02X", state.al_state);
+        add_value(status, "al_state", std::string(message));
+        add_value(status, "state_changes", health.state_changes);
+        // the share of the samples where the slave wasn't operational, since the start
+        add_rate(status, "error_rate", (double)health.errors / health.samples);
+        add_value(status, "domain", ethercat_domains[slave.get_domain()].get_name());
+        add_rate(status, "domain_wkc_error_rate", domain_error_rate);
+        if (output_watchdog.timeout_ns(i))
+        {
+            add_value(status, "safe_outputs", output_watchdog.expired(i) ? "true" : "false");
+            add_value(status, "output_timeouts", output_watchdog.expirations(i));
+        }
+        diagnostics.status.push_back(status);
+    }
+}
+
+void HealthMonitor::check_controllers(diagnostic_msgs::DiagnosticArray &diagnostics)
+{
+    for (size_t i = 0; i < controller_manager.size(); i++)
+    {
+        diagnostic_msgs::DiagnosticStatus status;
+        const rt_controller_slot &slot = controller_manager.slot(i);
+        bool enabled = slot.enabled.load(std::memory_order_relaxed);
+        uint64_t overruns = slot.overruns.load(std::memory_order_relaxed);
+        uint64_t violations = slot.violations.load(std::memory_order_relaxed);
+
+        // disabled by the realtime thread, which doesn't log
+        if (controllers_enabled_seen_[i] && !enabled)
+            ROS_ERROR("Controller %s: disabled, after %s: its outputs are driven by the output image\n", slot.name.c_str(),
+                      violations ? "an allocation or a block on the realtime thread" : "a run over its budget");
+        controllers_enabled_seen_[i] = enabled;
+
+        status.name = "ether_ros: controller " + slot.name;
+        status.hardware_id = "ether_ros";
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.message = "OK";
+        if (!enabled)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+            status.message = violations ? "Disabled: allocated or blocked" : "Disabled: over its budget";
+        }
+        else if (overruns)
+        {
+            status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+            status.message = "Runs over its budget";
+        }
+        add_value(status, "type", slot.type);
+        add_value(status, "enabled", enabled ? "true" : "false");
+        add_value(status, "runs", slot.runs.load(std::memory_order_relaxed));
+        add_value(status, "overruns", overruns);
+        add_value(status, "violations", violations);
+        add_value(status, "last_exec_ns", slot.last_exec_ns.load(std::memory_order_relaxed));
+        add_value(status, "max_exec_ns", slot.max_exec_ns.load(std::memory_order_relaxed));
+        diagnostics.status.push_back(status);
+    }
+}
+
+void HealthMonitor::timer_callback(const ros::TimerEvent &event)
+{
+    diagnostic_msgs::DiagnosticArray diagnostics;
+
+    diagnostics.header.stamp = ros::Time::now();
+    check_calibration();
+    check_master(diagnostics);
+    // the slaves use the error rates of their domains, of this period
+    check_domains(diagnostics);
+    check_slaves(diagnostics);
+    check_controllers(diagnostics);
+    diagnostics_pub_.publish(diagnostics);
+}
+
+uint64_t HealthMonitor::link_downs() const
+{
+    return link_downs_.load(std::memory_order_relaxed);
+}
+
+uint64_t HealthMonitor::al_state_changes() const
+{
+    return al_state_changes_.load(std::memory_order_relaxed);
+}
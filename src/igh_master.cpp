@@ -0,0 +1,223 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file igh_master.cpp
+   \brief Implementation of IghMaster class, and of the backend selection.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include "igh_master.h"
+#include "simulated_master.h"
+
+IghMaster::IghMaster() : master_(NULL)
+{
+}
+
+bool IghMaster::request(int index)
+{
+    master_ = ecrt_request_master(index);
+    return master_ != NULL;
+}
+
+int IghMaster::info(ec_master_info_t *info)
+{
+    return ecrt_master(master_, info);
+}
+
+void IghMaster::state(ec_master_state_t *state)
+{
+    ecrt_master_state(master_, state);
+}
+
+int IghMaster::create_domain()
+{
+    ec_domain_t *domain = ecrt_master_create_domain(master_);
+
+    if (!domain)
+        return -1;
+    domains_.push_back(domain);
+    return domains_.size() - 1;
+}
+
+size_t IghMaster::domain_size(int domain)
+{
+    return ecrt_domain_size(domains_[domain]);
+}
+
+uint8_t *IghMaster::domain_data(int domain)
+{
+    return ecrt_domain_data(domains_[domain]);
+}
+
+void IghMaster::domain_process(int domain)
+{
+    ecrt_domain_process(domains_[domain]);
+}
+
+void IghMaster::domain_state(int domain, ec_domain_state_t *state)
+{
+    ecrt_domain_state(domains_[domain], state);
+}
+
+void IghMaster::domain_queue(int domain)
+{
+    ecrt_domain_queue(domains_[domain]);
+}
+
+int IghMaster::slave_config(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code)
+{
+    ec_slave_config_t *sc = ecrt_master_slave_config(master_, alias, position, vendor_id, product_code);
+
+    if (!sc)
+        return -1;
+    slave_configs_.push_back(sc);
+    return slave_configs_.size() - 1;
+}
+
+int IghMaster::reg_pdo_entry(int slave_config, uint16_t index, uint8_t subindex, int domain)
+{
+    return ecrt_slave_config_reg_pdo_entry(slave_configs_[slave_config], index, subindex, domains_[domain], NULL);
+}
+
+void IghMaster::config_dc(int slave_config, uint16_t assign_activate, uint32_t sync0_cycle, int32_t sync0_shift)
+{
+    ecrt_slave_config_dc(slave_configs_[slave_config], assign_activate, sync0_cycle, sync0_shift, 0, 0);
+}
+
+int IghMaster::create_reg_request(int slave_config, size_t size)
+{
+    ec_reg_request_t *request = ecrt_slave_config_create_reg_request(slave_configs_[slave_config], size);
+
+    if (!request)
+        return -1;
+    reg_requests_.push_back(request);
+    return reg_requests_.size() - 1;
+}
+
+void IghMaster::reg_request_write(int request, uint16_t address, const uint8_t *data, size_t size)
+{
+    memcpy(ecrt_reg_request_data(reg_requests_[request]), data, size);
+    ecrt_reg_request_write(reg_requests_[request], address, size);
+}
+
+ec_request_state_t IghMaster::reg_request_state(int request)
+{
+    return ecrt_reg_request_state(reg_requests_[request]);
+}
+
+void IghMaster::slave_config_state(int slave_config, ec_slave_config_state_t *state)
+{
+    ecrt_slave_config_state(slave_configs_[slave_config], state);
+}
+
+int IghMaster::select_reference_clock(int slave_config)
+{
+    return ecrt_master_select_reference_clock(master_, slave_configs_[slave_config]);
+}
+
+int IghMaster::activate()
+{
+    return ecrt_master_activate(master_);
+}
+
+void IghMaster::receive()
+{
+    ecrt_master_receive(master_);
+}
+
+void IghMaster::send()
+{
+    ecrt_master_send(master_);
+}
+
+void IghMaster::application_time(uint64_t time_ns)
+{
+    ecrt_master_application_time(master_, time_ns);
+}
+
+int IghMaster::reference_clock_time(uint32_t *time)
+{
+    return ecrt_master_reference_clock_time(master_, time);
+}
+
+void IghMaster::sync_reference_clock()
+{
+    ecrt_master_sync_reference_clock(master_);
+}
+
+void IghMaster::sync_slave_clocks()
+{
+    ecrt_master_sync_slave_clocks(master_);
+}
+
+void IghMaster::sync_monitor_queue()
+{
+    ecrt_master_sync_monitor_queue(master_);
+}
+
+uint32_t IghMaster::sync_monitor_process()
+{
+    return ecrt_master_sync_monitor_process(master_);
+}
+
+//--------------------------------------------------------------------------//
+
+EthercatMaster *create_ethercat_master(ros::NodeHandle &n)
+{
+    std::string backend;
+    int index;
+    EthercatMaster *master;
+
+    n.param<std::string>("/ethercat_slaves/master/backend", backend, "igh");
+    n.param("/ethercat_slaves/master/index", index, 0);
+    if (backend == "igh")
+        master = new IghMaster();
+    else if (backend == "sim")
+    {
+        SimulatedMaster *sim = new SimulatedMaster();
+        sim->init(load_simulated_master_config(n));
+        master = sim;
+    }
+    else
+    {
+        ROS_FATAL("Unknown master/backend '%s' (use igh or sim)\n", backend.c_str());
+        exit(1);
+    }
+    if (!master->request(index))
+    {
+        ROS_FATAL("Failed to get master.\n");
+        exit(1);
+    }
+    ROS_INFO("EtherCAT master %d, backend %s\n", index, backend.c_str());
+    return master;
+}
@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file latency_histogram.cpp
+   \brief Implementation of LatencyHistogram class.
+
+   Used for recording the wakeup latency, the period and the execution time of every cycle
+   of the EtherCAT Communicator, in fixed memory.
+*/
+
+/*****************************************************************************/
+
+#include "latency_histogram.h"
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        counts_[i].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    min_.store(UINT64_MAX, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::snapshot(histogram_snapshot *snap) const
+{
+    snap->count = count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        snap->counts[i] = counts_[i].load(std::memory_order_relaxed);
+    snap->sum = sum_.load(std::memory_order_relaxed);
+    snap->max = max_.load(std::memory_order_relaxed);
+    snap->min = snap->count ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index)
+{
+    if (index < (1 << HISTOGRAM_SUB_BITS))
+        return index;
+    if (index >= HISTOGRAM_BUCKETS - 1)
+        return UINT64_MAX;
+    int shift = (index >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t sub_bucket = (index & ((1 << HISTOGRAM_SUB_BITS) - 1)) + (1 << HISTOGRAM_SUB_BITS);
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(const histogram_snapshot &snap, double p)
+{
+    uint64_t total = 0, rank, seen = 0;
+
+    // the buckets may hold a few more values than the count, see snapshot()
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        total += snap.counts[i];
+    if (!total)
+        return 0;
+    rank = (uint64_t)(p / 100.0 * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += snap.counts[i];
+        if (seen >= rank)
+        {
+            uint64_t bound = bucket_upper_bound(i);
+            return bound < snap.max ? bound : snap.max;
+        }
+    }
+    return snap.max;
+}
@@ -0,0 +1,303 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file output_image.cpp
+   \brief Implementation of OutputImage class.
+
+   Replaces the shared spinlock around the \a process_data_buf, so that the
+   realtime thread never waits for the writers of the output PDOs.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "output_image.h"
+#include "ether_ros.h"
+
+/*
+ * Every published image is followed by a trailer: the number of the scheduled commands folded
+ * in it, the cycle of the inputs it was computed from, and its commit.
+ */
+typedef struct image_trailer
+{
+    uint64_t folded;
+    uint64_t based_on_cycle;
+    uint64_t seq;
+} image_trailer;
+
+void OutputImage::init(size_t size, const utilities::output_range *regions, size_t count)
+{
+    int ret;
+
+    size_ = size;
+    process_data_buf = (uint8_t *)malloc(size_ * sizeof(uint8_t));
+    memset(process_data_buf, 0, size_); // fill the buffer with zeros
+    published_ = (uint8_t *)calloc(size_, sizeof(uint8_t));
+    images_.init(size_ + sizeof(image_trailer));
+
+    utilities::merge_output_ranges(regions, count, ranges_);
+    changed_ = new std::atomic<uint64_t>[ranges_.size()];
+    for (size_t i = 0; i < ranges_.size(); i++)
+        changed_[i].store(0, std::memory_order_relaxed);
+    commit_seq_ = 0;
+    copied_seq_ = 0;
+    force_copy_ = true;
+    fresh_ = false;
+    current_seq_ = 0;
+
+    for (int i = 0; i < OUTPUT_SCHEDULE_SLOTS; i++)
+    {
+        patches_[i].target_cycle = 0;
+        patches_[i].based_on_cycle = 0;
+        patches_[i].count = 0;
+        patches_[i].writes = (output_write *)calloc(OUTPUT_PATCH_MAX_WRITES, sizeof(output_write));
+    }
+    head_.store(0, std::memory_order_relaxed);
+    applied_.store(0, std::memory_order_relaxed);
+    consumed_.store(0, std::memory_order_relaxed);
+    folded_ = 0;
+    current_folded_ = 0;
+    applied_commands_.store(0, std::memory_order_relaxed);
+    late_commands_.store(0, std::memory_order_relaxed);
+
+    ret = pthread_mutex_init(&writer_mutex_, NULL);
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_mutex_init");
+    }
+}
+
+void OutputImage::apply_patch(uint8_t *buffer, const output_patch &patch)
+{
+    for (size_t i = 0; i < patch.count; i++)
+    {
+        const output_write &write = patch.writes[i];
+        uint8_t *p = buffer + write.offset;
+        for (int j = 0; j < write.size; j++)
+            p[j] = (p[j] & ~write.mask[j]) | (write.data[j] & write.mask[j]);
+    }
+}
+
+void OutputImage::fold_applied()
+{
+    uint64_t applied = applied_.load(std::memory_order_acquire);
+    for (; folded_ < applied; folded_++)
+        apply_patch(process_data_buf, patches_[folded_ % OUTPUT_SCHEDULE_SLOTS]);
+}
+
+void OutputImage::publish_image(uint64_t based_on_cycle)
+{
+    uint8_t *image = images_.write_buffer();
+    image_trailer trailer = {folded_, based_on_cycle, ++commit_seq_};
+
+    // the ranges this commit changes; published along with the image
+    for (size_t i = 0; i < ranges_.size(); i++)
+    {
+        const utilities::output_range &range = ranges_[i];
+        if (!memcmp(process_data_buf + range.offset, published_ + range.offset, range.size))
+            continue;
+        memcpy(published_ + range.offset, process_data_buf + range.offset, range.size);
+        changed_[i].store(trailer.seq, std::memory_order_relaxed);
+    }
+    memcpy(image, process_data_buf, size_);
+    memcpy(image + size_, &trailer, sizeof(trailer));
+    images_.publish();
+}
+
+void OutputImage::begin_write()
+{
+    pthread_mutex_lock(&writer_mutex_);
+    // the commands which reached their target cycle are part of the image from now on
+    fold_applied();
+}
+
+void OutputImage::commit(uint64_t based_on_cycle)
+{
+    publish_image(based_on_cycle);
+    pthread_mutex_unlock(&writer_mutex_);
+}
+
+bool OutputImage::schedule(const output_write *writes, size_t count, uint64_t target_cycle, uint64_t based_on_cycle)
+{
+    uint64_t head;
+
+    if (count > OUTPUT_PATCH_MAX_WRITES)
+        return false;
+
+    pthread_mutex_lock(&writer_mutex_);
+    head = head_.load(std::memory_order_relaxed);
+    if (head - consumed_.load(std::memory_order_acquire) >= OUTPUT_SCHEDULE_SLOTS)
+    {
+        // a slot is released when the realtime thread gets an image with its command folded in
+        uint64_t folded = folded_;
+        fold_applied();
+        if (folded_ != folded)
+            publish_image(0);
+        for (int i = 0; head - consumed_.load(std::memory_order_acquire) >= OUTPUT_SCHEDULE_SLOTS; i++)
+        {
+            if (i == 10)
+            {
+                pthread_mutex_unlock(&writer_mutex_);
+                return false;
+            }
+            usleep(PERIOD_NS / 1000);
+        }
+    }
+
+    output_patch &patch = patches_[head % OUTPUT_SCHEDULE_SLOTS];
+    memcpy(patch.writes, writes, count * sizeof(output_write));
+    patch.count = count;
+    patch.target_cycle = target_cycle;
+    patch.based_on_cycle = based_on_cycle;
+    head_.store(head + 1, std::memory_order_release);
+    pthread_mutex_unlock(&writer_mutex_);
+    return true;
+}
+
+void OutputImage::discard_scheduled()
+{
+    pthread_mutex_lock(&writer_mutex_);
+    head_.store(applied_.load(std::memory_order_acquire), std::memory_order_release);
+    pthread_mutex_unlock(&writer_mutex_);
+}
+
+void OutputImage::snapshot(uint8_t *buffer)
+{
+    pthread_mutex_lock(&writer_mutex_);
+    memcpy(buffer, process_data_buf, size_);
+    pthread_mutex_unlock(&writer_mutex_);
+}
+
+void OutputImage::record_latency(uint64_t cycle, uint64_t based_on_cycle)
+{
+    if (based_on_cycle && cycle >= based_on_cycle)
+        command_latency_histogram_.record((cycle - based_on_cycle) * PERIOD_NS);
+}
+
+const uint8_t *OutputImage::latest(uint64_t cycle)
+{
+    image_trailer trailer;
+    bool fresh = images_.update();
+    const uint8_t *image = images_.read_buffer();
+
+    memcpy(&trailer, image + size_, sizeof(trailer));
+    if (fresh)
+        record_latency(cycle, trailer.based_on_cycle);
+    // the scheduled commands folded in this image are no longer applied on top of it
+    if (trailer.folded != current_folded_)
+        force_copy_ = true;
+    fresh_ = fresh;
+    current_seq_ = trailer.seq;
+    current_folded_ = trailer.folded;
+    consumed_.store(current_folded_, std::memory_order_release);
+    return image;
+}
+
+void OutputImage::apply_scheduled(uint8_t *buffer, uint64_t cycle)
+{
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t applied = applied_.load(std::memory_order_relaxed);
+    struct timespec now;
+
+    while (applied < head && patches_[applied % OUTPUT_SCHEDULE_SLOTS].target_cycle <= cycle)
+    {
+        const output_patch &patch = patches_[applied % OUTPUT_SCHEDULE_SLOTS];
+        if (cycle > patch.target_cycle)
+            late_commands_.store(late_commands_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // the command is alive from now on: its slaves are timed out from the cycle it applies, not from its arrival
+        clock_gettime(CLOCK_TO_USE, &now);
+        for (size_t i = 0; i < patch.count; i++)
+            output_watchdog.feed(patch.writes[i].slave, TIMESPEC2NS(now));
+        record_latency(cycle, patch.based_on_cycle);
+        applied_commands_.store(applied_commands_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        applied++;
+    }
+    applied_.store(applied, std::memory_order_release);
+
+    // the applied commands, until an image with them folded in arrives
+    for (uint64_t i = current_folded_; i < applied; i++)
+        apply_patch(buffer, patches_[i % OUTPUT_SCHEDULE_SLOTS]);
+}
+
+void OutputImage::copy_to(uint8_t *buffer, uint64_t cycle)
+{
+    const uint8_t *image = latest(cycle);
+
+    if (fresh_ || force_copy_)
+    {
+        utilities::copy_output_ranges(buffer, image, ranges_.data(), ranges_.size(), changed_,
+                                      force_copy_ ? 0 : copied_seq_);
+        copied_seq_ = current_seq_;
+        force_copy_ = false;
+    }
+    apply_scheduled(buffer, cycle);
+}
+
+void OutputImage::invalidate()
+{
+    force_copy_ = true;
+}
+
+size_t OutputImage::ranges_count() const
+{
+    return ranges_.size();
+}
+
+void OutputImage::make_write(output_write *write, int slave, size_t offset, pdo_type type, uint8_t bit, int64_t value)
+{
+    write->offset = offset;
+    write->slave = slave;
+    write->size = pdo_type_size(type);
+    memset(write->data, 0, sizeof(write->data));
+    memset(write->mask, 0, sizeof(write->mask));
+    write_pdo_value(write->data, type, 0, bit, value);
+    if (type == PDO_BOOL)
+        write->mask[0] = 1 << bit;
+    else
+        memset(write->mask, 0xff, write->size);
+}
+
+uint64_t OutputImage::applied_commands() const
+{
+    return applied_commands_.load(std::memory_order_relaxed);
+}
+
+uint64_t OutputImage::late_commands() const
+{
+    return late_commands_.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram &OutputImage::command_latency_histogram() const
+{
+    return command_latency_histogram_;
+}
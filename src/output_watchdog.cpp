@@ -0,0 +1,216 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file output_watchdog.cpp
+   \brief Implementation of the OutputWatchdog class.
+
+   The writers store the time of their last command per slave; the realtime thread compares it
+   with the wakeup time and copies the precomputed safe outputs of the slaves timed out.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "output_watchdog.h"
+#include "ether_ros.h"
+
+OutputWatchdog::OutputWatchdog()
+    : safe_image_(NULL), fed_ns_(NULL), expired_(NULL), expirations_(NULL)
+{
+}
+
+void OutputWatchdog::load_safe_outputs(int slave, XmlRpc::XmlRpcValue &safe_outputs)
+{
+    const std::string &name = ethercat_slaves[slave].slave_name;
+    const PDOLayout &layout = ethercat_slaves[slave].slave.get_pdo_out_layout();
+
+    if (safe_outputs.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+        ROS_FATAL("Slave %s: /ethercat_slaves/%s/safe_outputs must be a map\n", name.c_str(), name.c_str());
+        exit(1);
+    }
+    for (XmlRpc::XmlRpcValue::iterator it = safe_outputs.begin(); it != safe_outputs.end(); it++)
+    {
+        int index = layout.find(it->first);
+        XmlRpc::XmlRpcValue &value = it->second;
+        if (index < 0)
+        {
+            ROS_FATAL("Slave %s: safe_outputs: no output PDO variable %s\n", name.c_str(), it->first.c_str());
+            exit(1);
+        }
+        if (value.getType() != XmlRpc::XmlRpcValue::TypeInt && value.getType() != XmlRpc::XmlRpcValue::TypeBoolean)
+        {
+            ROS_FATAL("Slave %s: safe_outputs: %s must be an integer\n", name.c_str(), it->first.c_str());
+            exit(1);
+        }
+        const pdo_field &field = layout.field(index);
+        if (field.offset + pdo_type_size(field.type) > (size_t)slave_offsets[slave].pdo_out_size)
+        {
+            ROS_FATAL("Slave %s: safe_outputs: %s is out of the output PDO\n", name.c_str(), it->first.c_str());
+            exit(1);
+        }
+        int64_t safe_value = value.getType() == XmlRpc::XmlRpcValue::TypeBoolean ? (bool)value : (int)value;
+        write_pdo_value(safe_image_ + slave_offsets[slave].pdo_out, field.type, field.offset, field.bit, safe_value);
+    }
+}
+
+void OutputWatchdog::init(XmlRpc::XmlRpcValue &params)
+{
+    int timeout_ms = 0;
+
+    if (params.hasMember("output_watchdog") && params["output_watchdog"].hasMember("timeout_ms"))
+    {
+        XmlRpc::XmlRpcValue &timeout = params["output_watchdog"]["timeout_ms"];
+        if (timeout.getType() != XmlRpc::XmlRpcValue::TypeInt || (int)timeout < 0)
+        {
+            ROS_FATAL("/ethercat_slaves/output_watchdog/timeout_ms must be a non negative integer\n");
+            exit(1);
+        }
+        timeout_ms = timeout;
+    }
+
+    safe_image_ = new uint8_t[total_process_data];
+    memset(safe_image_, 0, total_process_data);
+    timeouts_ns_.assign(slaves_count, 0);
+    fed_ns_ = new std::atomic<uint64_t>[slaves_count];
+    expired_ = new std::atomic<bool>[slaves_count];
+    expirations_ = new std::atomic<uint64_t>[slaves_count];
+
+    int watched = 0;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        XmlRpc::XmlRpcValue &entry = params[ethercat_slaves[i].slave_name];
+        int slave_timeout_ms = timeout_ms;
+        if (entry.hasMember("output_timeout_ms"))
+        {
+            if (entry["output_timeout_ms"].getType() != XmlRpc::XmlRpcValue::TypeInt || (int)entry["output_timeout_ms"] < 0)
+            {
+                ROS_FATAL("Slave %s: /ethercat_slaves/%s/output_timeout_ms must be a non negative integer\n",
+                          ethercat_slaves[i].slave_name.c_str(), ethercat_slaves[i].slave_name.c_str());
+                exit(1);
+            }
+            slave_timeout_ms = entry["output_timeout_ms"];
+        }
+        if (entry.hasMember("safe_outputs"))
+            load_safe_outputs(i, entry["safe_outputs"]);
+        timeouts_ns_[i] = (int64_t)slave_timeout_ms * 1000000LL;
+        fed_ns_[i].store(0, std::memory_order_relaxed);
+        // the slaves start with their safe outputs, until their first command
+        expired_[i].store(slave_timeout_ms > 0, std::memory_order_relaxed);
+        expirations_[i].store(0, std::memory_order_relaxed);
+        if (slave_timeout_ms > 0)
+            watched++;
+    }
+    if (watched)
+        ROS_INFO("Output watchdog: %d of %d slaves fall back to their safe outputs without commands\n",
+                 watched, slaves_count);
+}
+
+void OutputWatchdog::feed(int slave)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_TO_USE, &now);
+    feed(slave, TIMESPEC2NS(now));
+}
+
+void OutputWatchdog::feed(int slave, uint64_t now_ns)
+{
+    if (!fed_ns_ || (slave != 255 && slave >= slaves_count))
+        return;
+    int first = slave == 255 ? 0 : slave;
+    int last = slave == 255 ? slaves_count - 1 : slave;
+    for (int i = first; i <= last; i++)
+        fed_ns_[i].store(now_ns, std::memory_order_release);
+}
+
+bool OutputWatchdog::update(uint64_t now_ns)
+{
+    bool recovered = false;
+
+    if (timeouts_ns_.empty())
+        return false;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        if (!timeouts_ns_[i])
+            continue;
+        uint64_t fed_ns = fed_ns_[i].load(std::memory_order_acquire);
+        // the wakeup may precede a command received during the previous cycle
+        bool expired = !fed_ns || (int64_t)(now_ns - fed_ns) > timeouts_ns_[i];
+        bool was_expired = expired_[i].load(std::memory_order_relaxed);
+        if (expired == was_expired)
+            continue;
+        expired_[i].store(expired, std::memory_order_relaxed);
+        if (expired)
+            expirations_[i].store(expirations_[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        else
+            recovered = true;
+    }
+    return recovered;
+}
+
+void OutputWatchdog::apply(uint8_t *buffer)
+{
+    if (!expired_)
+        return;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        if (expired_[i].load(std::memory_order_relaxed))
+            memcpy(buffer + slave_offsets[i].pdo_out, safe_image_ + slave_offsets[i].pdo_out, slave_offsets[i].pdo_out_size);
+    }
+}
+
+void OutputWatchdog::write_safe_outputs(uint8_t *buffer)
+{
+    for (int i = 0; i < slaves_count; i++)
+    {
+        if (safe_image_)
+            memcpy(buffer + slave_offsets[i].pdo_out, safe_image_ + slave_offsets[i].pdo_out, slave_offsets[i].pdo_out_size);
+        else
+            memset(buffer + slave_offsets[i].pdo_out, 0, slave_offsets[i].pdo_out_size);
+    }
+}
+
+bool OutputWatchdog::expired(int slave) const
+{
+    return expired_ && expired_[slave].load(std::memory_order_relaxed);
+}
+
+uint64_t OutputWatchdog::expirations(int slave) const
+{
+    return expirations_ ? expirations_[slave].load(std::memory_order_relaxed) : 0;
+}
+
+int64_t OutputWatchdog::timeout_ns(int slave) const
+{
+    return timeouts_ns_.empty() ? 0 : timeouts_ns_[slave];
+}
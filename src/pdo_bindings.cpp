@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_bindings.cpp
+   \brief The bindings of the PDO variables to the fields of the PDOIn and PDOOut messages.
+
+   Should a new variable be added to the messages, it must be added here also. The offsets and
+   the types of the variables are not part of the code: they come from the \a /pdo_layouts parameters.
+*/
+
+/*****************************************************************************/
+
+#include "pdo_bindings.h"
+#include "ether_ros.h"
+
+const pdo_binding<ether_ros::PDOIn> pdo_in_bindings[] = {
+    PDO_BINDING(ether_ros::PDOIn, hip_angle),
+    PDO_BINDING(ether_ros::PDOIn, desired_hip_angle),
+    PDO_BINDING(ether_ros::PDOIn, time),
+    PDO_BINDING(ether_ros::PDOIn, knee_angle),
+    PDO_BINDING(ether_ros::PDOIn, desired_knee_angle),
+    PDO_BINDING(ether_ros::PDOIn, PWM10000_knee),
+    PDO_BINDING(ether_ros::PDOIn, PWM10000_hip),
+    PDO_BINDING(ether_ros::PDOIn, velocity_knee1000),
+    PDO_BINDING(ether_ros::PDOIn, velocity_hip1000),
+};
+const size_t pdo_in_bindings_count = sizeof(pdo_in_bindings) / sizeof(pdo_in_bindings[0]);
+
+const pdo_binding<ether_ros::PDOOut> pdo_out_bindings[] = {
+    PDO_BINDING(ether_ros::PDOOut, state_machine),
+    PDO_BINDING(ether_ros::PDOOut, initialize_clock),
+    PDO_BINDING(ether_ros::PDOOut, initialize_angles),
+    PDO_BINDING(ether_ros::PDOOut, inverse_kinematics),
+    PDO_BINDING(ether_ros::PDOOut, blue_led),
+    PDO_BINDING(ether_ros::PDOOut, red_led),
+    PDO_BINDING(ether_ros::PDOOut, button_1),
+    PDO_BINDING(ether_ros::PDOOut, button_2),
+    PDO_BINDING(ether_ros::PDOOut, sync),
+    PDO_BINDING(ether_ros::PDOOut, desired_x_value),
+    PDO_BINDING(ether_ros::PDOOut, filter_bandwidth),
+    PDO_BINDING(ether_ros::PDOOut, desired_y_value),
+    PDO_BINDING(ether_ros::PDOOut, kp_100_knee),
+    PDO_BINDING(ether_ros::PDOOut, kd_1000_knee),
+    PDO_BINDING(ether_ros::PDOOut, ki_100_knee),
+    PDO_BINDING(ether_ros::PDOOut, kp_100_hip),
+    PDO_BINDING(ether_ros::PDOOut, kd_1000_hip),
+    PDO_BINDING(ether_ros::PDOOut, ki_100_hip),
+    PDO_BINDING(ether_ros::PDOOut, x_cntr_traj1000),
+    PDO_BINDING(ether_ros::PDOOut, y_cntr_traj1000),
+    PDO_BINDING(ether_ros::PDOOut, a_ellipse100),
+    PDO_BINDING(ether_ros::PDOOut, b_ellipse100),
+    PDO_BINDING(ether_ros::PDOOut, traj_freq100),
+    PDO_BINDING(ether_ros::PDOOut, phase_deg),
+    PDO_BINDING(ether_ros::PDOOut, flatness_param100),
+};
+const size_t pdo_out_bindings_count = sizeof(pdo_out_bindings) / sizeof(pdo_out_bindings[0]);
+
+const pdo_column_binding<ether_ros::PDOInAll> pdo_in_all_bindings[] = {
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, hip_angle),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, desired_hip_angle),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, time),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, knee_angle),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, desired_knee_angle),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, PWM10000_knee),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, PWM10000_hip),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, velocity_knee1000),
+    PDO_COLUMN_BINDING(ether_ros::PDOInAll, velocity_hip1000),
+};
+const size_t pdo_in_all_bindings_count = sizeof(pdo_in_all_bindings) / sizeof(pdo_in_all_bindings[0]);
+
+const pdo_column_binding<ether_ros::PDOOutAll> pdo_out_all_bindings[] = {
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, state_machine),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, initialize_clock),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, initialize_angles),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, inverse_kinematics),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, blue_led),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, red_led),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, button_1),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, button_2),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, sync),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, desired_x_value),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, filter_bandwidth),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, desired_y_value),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, kp_100_knee),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, kd_1000_knee),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, ki_100_knee),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, kp_100_hip),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, kd_1000_hip),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, ki_100_hip),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, x_cntr_traj1000),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, y_cntr_traj1000),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, a_ellipse100),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, b_ellipse100),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, traj_freq100),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, phase_deg),
+    PDO_COLUMN_BINDING(ether_ros::PDOOutAll, flatness_param100),
+};
+const size_t pdo_out_all_bindings_count = sizeof(pdo_out_all_bindings) / sizeof(pdo_out_all_bindings[0]);
+
+// exits if the layout doesn't fit in the PDO of the slave
+static const PDOLayout &checked_layout(int slave, bool input)
+{
+    const PDOLayout &layout = input ? ethercat_slaves[slave].slave.get_pdo_in_layout()
+                                    : ethercat_slaves[slave].slave.get_pdo_out_layout();
+    uint32_t size = input ? slave_offsets[slave].pdo_in_size : slave_offsets[slave].pdo_out_size;
+
+    if (layout.span() > size)
+    {
+        ROS_FATAL("The %s layout of slave %d needs %lu bytes, but the slave has %u\n",
+                  input ? "pdo_in" : "pdo_out", slave, layout.span(), size);
+        exit(1);
+    }
+    return layout;
+}
+
+void init_pdo_in_decoders(std::vector<PDODecoder<ether_ros::PDOIn> > &decoders)
+{
+    decoders.resize(slaves_count);
+    for (int i = 0; i < slaves_count; i++)
+        decoders[i].init(checked_layout(i, true), pdo_in_bindings, pdo_in_bindings_count);
+}
+
+void init_pdo_out_decoders(std::vector<PDODecoder<ether_ros::PDOOut> > &decoders)
+{
+    decoders.resize(slaves_count);
+    for (int i = 0; i < slaves_count; i++)
+        decoders[i].init(checked_layout(i, false), pdo_out_bindings, pdo_out_bindings_count);
+}
+
+void init_pdo_in_all_decoder(PDOColumnDecoder<ether_ros::PDOInAll> &decoder)
+{
+    std::vector<const PDOLayout *> layouts(slaves_count);
+    std::vector<size_t> offsets(slaves_count);
+
+    for (int i = 0; i < slaves_count; i++)
+    {
+        layouts[i] = &checked_layout(i, true);
+        offsets[i] = slave_offsets[i].pdo_in;
+    }
+    decoder.init(layouts, offsets, pdo_in_all_bindings, pdo_in_all_bindings_count);
+}
+
+void init_pdo_out_all_decoder(PDOColumnDecoder<ether_ros::PDOOutAll> &decoder)
+{
+    std::vector<const PDOLayout *> layouts(slaves_count);
+    std::vector<size_t> offsets(slaves_count);
+
+    for (int i = 0; i < slaves_count; i++)
+    {
+        layouts[i] = &checked_layout(i, false);
+        offsets[i] = slave_offsets[i].pdo_out;
+    }
+    decoder.init(layouts, offsets, pdo_out_all_bindings, pdo_out_all_bindings_count);
+}
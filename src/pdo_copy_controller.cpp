@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_copy_controller.cpp
+   \brief Implementation of the PDOCopyController class: the \a pdo_copy controller type.
+*/
+
+/*****************************************************************************/
+
+#include <math.h>
+#include "rt_controller.h"
+
+/** \class PDOCopyController
+    \brief Writes an input variable, scaled by a gain, to an output variable, in the same cycle.
+
+    Its parameters, in its entry of \a /ethercat_slaves/controllers: \a slave, \a input, \a output,
+    and optionally \a output_slave (the same slave) and \a gain (1.0). An example of the RTController
+    interface, and a same-cycle loopback for measuring the sense-to-actuate latency.
+*/
+class PDOCopyController : public RTController
+{
+  private:
+    rt_variable input_;
+    rt_variable output_;
+    double gain_;
+
+  public:
+    bool init(ros::NodeHandle &n, RTControllerIO &io, XmlRpc::XmlRpcValue &params)
+    {
+        if (!params.hasMember("slave") || params["slave"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+            !params.hasMember("input") || params["input"].getType() != XmlRpc::XmlRpcValue::TypeString ||
+            !params.hasMember("output") || params["output"].getType() != XmlRpc::XmlRpcValue::TypeString)
+        {
+            ROS_ERROR("pdo_copy: slave (integer), input and output (strings) are required\n");
+            return false;
+        }
+        int slave = params["slave"];
+        int output_slave = slave;
+        if (params.hasMember("output_slave"))
+        {
+            if (params["output_slave"].getType() != XmlRpc::XmlRpcValue::TypeInt)
+            {
+                ROS_ERROR("pdo_copy: output_slave must be an integer\n");
+                return false;
+            }
+            output_slave = params["output_slave"];
+        }
+        gain_ = 1.0;
+        if (params.hasMember("gain"))
+        {
+            if (params["gain"].getType() == XmlRpc::XmlRpcValue::TypeDouble)
+                gain_ = params["gain"];
+            else if (params["gain"].getType() == XmlRpc::XmlRpcValue::TypeInt)
+                gain_ = (int)params["gain"];
+            else
+            {
+                ROS_ERROR("pdo_copy: gain must be a number\n");
+                return false;
+            }
+        }
+        return io.input(slave, params["input"], &input_) && io.output(output_slave, params["output"], &output_);
+    }
+
+    void update(RTControllerIO &io)
+    {
+        io.write(output_, llround(gain_ * io.read(input_)));
+    }
+};
+
+ETHER_ROS_REGISTER_CONTROLLER(PDOCopyController, "pdo_copy");
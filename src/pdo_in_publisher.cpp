@@ -32,7 +32,7 @@
    \file pdo_in_publisher.cpp
    \brief Implementation of PDOInPublisher class.
 
-   Used for publishing the "raw" input data, received from EtherCAT Communicator after transformation into
+   Used for publishing the "raw" input data, read from the \a pdo_raw_ring after transformation into
    useful, human-readable format, consisted of the EtherCAT variables used by our
    application. Transforms the indeces to variables.
 */
@@ -40,60 +40,120 @@
 /*****************************************************************************/
 #include "pdo_in_publisher.h"
 #include "ether_ros/PDOIn.h"
-#include "ether_ros/PDORaw.h"
+#include "ether_ros/PDOInAll.h"
 #include "ethercat_slave.h"
+#include "pdo_bindings.h"
 #include "utilities.h"
 #include "vector"
 #include "ether_ros.h"
 #include <iostream>
 #include <string>
+#include <time.h>
 
-void PDOInPublisher::pdo_raw_callback(const ether_ros::PDORaw::ConstPtr &pdo_raw)
+int PDOInPublisher::wakeup_period_ns()
 {
-    std::vector<uint8_t> pdo_in_raw = pdo_raw->pdo_in_raw;
-    uint8_t *data_ptr;
-    size_t pos;
-    for (int i = 0; i < master_info.slave_count; i++)
-    {
-        pos = i * num_process_data_in; //The size of every entry is num_process_data_in
-        data_ptr = (uint8_t * ) & pdo_in_raw[pos];
-        ether_ros::PDOIn pdo_in;
-        using namespace utilities;
-
-        // change the following code to match your needs
-        /*
+    return throttle_.consumer_period_ns();
+}
 
-        Insert code here ...
+void PDOInPublisher::consume()
+{
+    bool any = false;
 
-        */
+    // the subscribers are counted once per wakeup, not once per snapshot
+    for (int i = 0; i < slaves_count; i++)
+    {
+        subscribed_[i] = per_slave_ && pdo_in_pub_[i].getNumSubscribers() > 0;
+        any = any || subscribed_[i];
+    }
+    aggregated_subscribed_ = aggregated_ && pdo_in_all_pub_.getNumSubscribers() > 0;
+    if (!any && !aggregated_subscribed_)
+    {
+        skip();
+        return;
+    }
+    // decimated: only the latest snapshot is of interest, the older ones are skipped without copying them
+    while (throttle_.decimation() == 1 ? read() : read_latest())
+    {
+        if (throttle_.due(snapshot_.cycle))
+            publish_pdo_in(snapshot_);
+    }
+}
 
-        pdo_in.hip_angle = process_input_int16(data_ptr, 0);
-        pdo_in.desired_hip_angle = process_input_int16(data_ptr, 2);
-        pdo_in.time = process_input_uint16(data_ptr, 4);
-        pdo_in.knee_angle = process_input_int16(data_ptr, 6);
-        pdo_in.desired_knee_angle = process_input_int16(data_ptr, 8);
-        pdo_in.PWM10000_knee = process_input_int16(data_ptr, 10);
-        pdo_in.PWM10000_hip = process_input_int16(data_ptr, 12);
-        pdo_in.velocity_knee1000 = process_input_int32(data_ptr, 14);
-        pdo_in.velocity_hip1000 = process_input_int32(data_ptr, 18);
+void PDOInPublisher::publish_pdo_in(const pdo_raw_snapshot &snapshot)
+{
+    const uint8_t *frame = snapshot.data;
+    bool any_changed = false;
+    ros::Time stamp;
 
-        /*
-            .....
+    stamp.fromNSec(snapshot.timestamp_ns + clock_offset_ns_);
+    for (int i = 0; i < slaves_count; i++)
+    {
+        changed_[i] = (subscribed_[i] || aggregated_subscribed_) &&
+                      throttle_.changed(i, frame + slave_offsets[i].pdo_in, slave_offsets[i].pdo_in_size);
+        any_changed = any_changed || changed_[i];
+    }
+    for (int i = 0; i < slaves_count; i++)
+    {
+        ether_ros::PDOIn pdo_in;
 
-        */
+        if (!subscribed_[i] || !changed_[i])
+            continue;
+        pdo_in.header.seq = (uint32_t)snapshot.cycle;
+        pdo_in.header.stamp = stamp;
+        // the variables are declared in the pdo_in layout of the slave, in ethercat_slaves.yaml
+        decoders_[i].decode(frame + slave_offsets[i].pdo_in, pdo_in);
         pdo_in_pub_[i].publish(pdo_in);
     }
+    // a single message with every slave, if any of them changed
+    if (aggregated_subscribed_ && any_changed)
+    {
+        pdo_in_all_.header.seq = (uint32_t)snapshot.cycle;
+        pdo_in_all_.header.stamp = stamp;
+        pdo_in_all_.cycle = snapshot.cycle;
+        pdo_in_all_.cycle_time_ns = snapshot.timestamp_ns;
+        // a column of every slave at a time (struct of arrays)
+        all_decoder_.decode(frame, pdo_in_all_);
+        pdo_in_all_pub_.publish(pdo_in_all_);
+    }
 }
 
 void PDOInPublisher::init(ros::NodeHandle &n)
 {
-    //Create  ROS subscriber for the Ethercat RAW data
-    pdo_raw_sub_ = n.subscribe("pdo_raw", 1000, &PDOInPublisher::pdo_raw_callback, &pdo_in_publisher);
+    struct timespec realtime, monotonic;
+
+    throttle_.init(n, "pdo_in", 0.0, false, slaves_count);
+    if (!throttle_.enabled())
+        return;
+    n.param("/ethercat_slaves/publishers/pdo_in/per_slave", per_slave_, true);
+    n.param("/ethercat_slaves/publishers/pdo_in/aggregated", aggregated_, false);
+
+    // the offset of the ROS clock from the clock of the cycles, for stamping the messages
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_TO_USE, &monotonic);
+    clock_offset_ns_ = (int64_t)TIMESPEC2NS(realtime) - (int64_t)TIMESPEC2NS(monotonic);
 
     //Create  ROS publishers for the Ethercat formatted data
-    pdo_in_pub_ = new ros::Publisher[master_info.slave_count];
-    for (int i = 0; i < master_info.slave_count; i++)
+    pdo_in_pub_ = new ros::Publisher[slaves_count];
+    if (per_slave_)
     {
-        pdo_in_pub_[i] = n.advertise<ether_ros::PDOIn>("pdo_in_slave_" + std::to_string(i), 1000);
+        //Compile the PDO layouts of the slaves into decoders
+        init_pdo_in_decoders(decoders_);
+        for (int i = 0; i < slaves_count; i++)
+        {
+            pdo_in_pub_[i] = n.advertise<ether_ros::PDOIn>("pdo_in_slave_" + std::to_string(i), 1000);
+        }
     }
+    if (aggregated_)
+    {
+        // the arrays are sized once, the message is reused in every publish
+        init_pdo_in_all_decoder(all_decoder_);
+        all_decoder_.prepare(pdo_in_all_);
+        pdo_in_all_pub_ = n.advertise<ether_ros::PDOInAll>("pdo_in_all", 1000);
+    }
+    subscribed_.assign(slaves_count, false);
+    changed_.assign(slaves_count, false);
+    aggregated_subscribed_ = false;
+
+    //Read the Ethercat RAW data straight from the ring
+    start_consumer();
 }
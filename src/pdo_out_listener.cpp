@@ -41,23 +41,34 @@
 
 #include "pdo_out_listener.h"
 #include "ether_ros/ModifyPDOVariables.h"
+#include "ether_ros/ModifyPDOVariablesBatch.h"
+#include "ether_ros/PDOCommandBatch.h"
+#include "pdo_schema.h"
 // #include "ethercat_slave.h"
 #include "utilities.h"
 #include "vector"
-#include <pthread.h>
 #include "ether_ros.h"
 #include <iostream>
 #include <string>
 
+// every valid command (of a batch) applied now feeds the output watchdog of its slave;
+// the scheduled ones feed it when they are applied, at their target cycle (\see OutputImage::apply_scheduled)
+template <class C>
+static void feed_output_watchdog(const std::vector<C> &commands)
+{
+    for (size_t i = 0; i < commands.size(); i++)
+        output_watchdog.feed(commands[i].slave_id);
+}
+
 void PDOOutListener::pdo_out_callback(const ether_ros::ModifyPDOVariables::ConstPtr &new_var)
 {
-    pthread_spin_lock(&lock);
+    output_image.begin_write();
     uint8_t slave_id = new_var->slave_id;
     //check if we are broadcasting a variable's value to all slaves
     if (slave_id == 255)
     {
-        ROS_INFO("slave_id is 255\n");
-        for (int i = 0; i < master_info.slave_count; i++)
+        ROS_DEBUG("slave_id is 255\n");
+        for (int i = 0; i < slaves_count; i++)
         {
             modify_pdo_variable(i, new_var);
         }
@@ -66,7 +77,8 @@ void PDOOutListener::pdo_out_callback(const ether_ros::ModifyPDOVariables::Const
     {
         modify_pdo_variable((int)slave_id, new_var);
     }
-    pthread_spin_unlock(&lock);
+    output_image.commit();
+    output_watchdog.feed(slave_id);
 }
 void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPDOVariables::ConstPtr &new_var)
 {
@@ -79,9 +91,9 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
     case 0:
 
     {
-        uint8_t *new_data_ptr = (process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        uint8_t *new_data_ptr = (process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         bool value = new_var->bool_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_BIT(new_data_ptr, new_var->subindex, value);
         break;
     }
@@ -89,9 +101,9 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
     case 1:
 
     {
-        uint8_t *new_data_ptr = (uint8_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        uint8_t *new_data_ptr = (uint8_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         uint8_t value = new_var->uint8_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_U8(new_data_ptr, value);
         break;
     }
@@ -99,9 +111,9 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
     case 2:
 
     {
-        int8_t *new_data_ptr = (int8_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        int8_t *new_data_ptr = (int8_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         int8_t value = new_var->int8_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_S8(new_data_ptr, value);
         break;
     }
@@ -109,22 +121,22 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
     case 3:
 
     {
-        uint16_t *new_data_ptr = (uint16_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        uint16_t *new_data_ptr = (uint16_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         // printf("O:");
         // for(int j = 0 ; j < 24; j++)
         //     printf(" %2.2x", *(new_var->value[j]);
         // printf("\n");
         uint16_t value = new_var->uint16_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_U16(new_data_ptr, value);
         break;
     }
 
     case 4:
     {
-        int16_t *new_data_ptr = (int16_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        int16_t *new_data_ptr = (int16_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         int16_t value = new_var->int16_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_S16(new_data_ptr, value);
         break;
     }
@@ -132,24 +144,24 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
     case 5:
 
     {
-        uint32_t *new_data_ptr = (uint32_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        uint32_t *new_data_ptr = (uint32_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         uint32_t value = new_var->uint32_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_U32(new_data_ptr, value);
         break;
     }
     case 6:
     {
-        int32_t *new_data_ptr = (int32_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        int32_t *new_data_ptr = (int32_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         int32_t value = new_var->int32_value;
-        ROS_INFO("New value will be: %d\n", value);
+        ROS_DEBUG("New value will be: %d\n", value);
         EC_WRITE_S32(new_data_ptr, value);
         break;
     }
     case 7:
 
     {
-        uint64_t *new_data_ptr = (uint64_t *)(process_data_buf + new_var->slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        uint64_t *new_data_ptr = (uint64_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         uint64_t value = new_var->uint64_value;
         EC_WRITE_U64(new_data_ptr, value);
         break;
@@ -158,7 +170,7 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
     case 8:
 
     {
-        int64_t *new_data_ptr = (int64_t *)(process_data_buf + slave_id * (num_process_data_out + num_process_data_in) + new_var->index);
+        int64_t *new_data_ptr = (int64_t *)(process_data_buf + slave_offsets[slave_id].pdo_out + new_var->index);
         int64_t value = new_var->int64_value;
         EC_WRITE_S64(new_data_ptr, value);
         break;
@@ -168,8 +180,230 @@ void PDOOutListener::modify_pdo_variable(int slave_id, const ether_ros::ModifyPD
         break;
     }
 }
+bool PDOOutListener::check_entry(const ether_ros::PDOOutEntry &entry, size_t i)
+{
+    if (entry.slave_id != 255 && entry.slave_id >= slaves_count)
+    {
+        ROS_ERROR("pdo_listener_batch: entry %lu: no slave %u, the batch is dropped\n", i, entry.slave_id);
+        return false;
+    }
+    if (entry.type >= PDO_INVALID || entry.bit > 7)
+    {
+        ROS_ERROR("pdo_listener_batch: entry %lu: invalid type %u or bit %u, the batch is dropped\n", i, entry.type, entry.bit);
+        return false;
+    }
+    int first = entry.slave_id == 255 ? 0 : entry.slave_id;
+    int last = entry.slave_id == 255 ? slaves_count - 1 : entry.slave_id;
+    for (int slave = first; slave <= last; slave++)
+    {
+        if (entry.offset + pdo_type_size((pdo_type)entry.type) > slave_offsets[slave].pdo_out_size)
+        {
+            ROS_ERROR("pdo_listener_batch: entry %lu: offset %u out of the output PDO of slave %d, the batch is dropped\n",
+                      i, entry.offset, slave);
+            return false;
+        }
+    }
+    return true;
+}
+
+void PDOOutListener::pdo_out_batch_callback(const ether_ros::ModifyPDOVariablesBatch::ConstPtr &batch)
+{
+    const std::vector<ether_ros::PDOOutEntry> &entries = batch->entries;
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (!check_entry(entries[i], i))
+            return;
+    }
+
+    if (batch->target_cycle)
+    {
+        pthread_mutex_lock(&schedule_mutex_);
+        schedule_batch(batch);
+        pthread_mutex_unlock(&schedule_mutex_);
+        return;
+    }
+    output_image.begin_write();
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const ether_ros::PDOOutEntry &entry = entries[i];
+        int first = entry.slave_id == 255 ? 0 : entry.slave_id;
+        int last = entry.slave_id == 255 ? slaves_count - 1 : entry.slave_id;
+
+        for (int slave = first; slave <= last; slave++)
+        {
+            write_pdo_value(process_data_buf + slave_offsets[slave].pdo_out,
+                            (pdo_type)entry.type, entry.offset, entry.bit, entry.value);
+        }
+    }
+    output_image.commit(batch->based_on_cycle);
+    feed_output_watchdog(entries);
+}
+
+bool PDOOutListener::check_target_cycle(const char *topic, uint64_t target_cycle, uint64_t current_cycle)
+{
+    if (!EthercatCommunicator::has_running_thread())
+    {
+        ROS_ERROR("%s: the EtherCAT Communicator isn't running, the scheduled batch is dropped\n", topic);
+        return false;
+    }
+    if (target_cycle > current_cycle + max_schedule_ahead_cycles_)
+    {
+        ROS_ERROR("%s: target cycle %lu is more than %d cycles ahead of %lu, the batch is dropped\n",
+                  topic, target_cycle, max_schedule_ahead_cycles_, current_cycle);
+        return false;
+    }
+    return true;
+}
+
+void PDOOutListener::schedule_writes(const char *topic, size_t count, uint64_t target_cycle, uint64_t based_on_cycle,
+                                     uint64_t current_cycle)
+{
+    if (target_cycle <= current_cycle)
+        ROS_WARN("%s: target cycle %lu has passed (current %lu), applying at the next one\n",
+                 topic, target_cycle, current_cycle);
+    if (!output_image.schedule(scheduled_writes_.data(), count, target_cycle, based_on_cycle))
+        ROS_ERROR("%s: too many pending scheduled commands, the batch for cycle %lu is dropped\n",
+                  topic, target_cycle);
+}
+
+void PDOOutListener::schedule_batch(const ether_ros::ModifyPDOVariablesBatch::ConstPtr &batch)
+{
+    const std::vector<ether_ros::PDOOutEntry> &entries = batch->entries;
+    uint64_t current_cycle = EthercatCommunicator::current_cycle();
+    size_t count = 0;
+
+    if (!check_target_cycle("pdo_listener_batch", batch->target_cycle, current_cycle))
+        return;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const ether_ros::PDOOutEntry &entry = entries[i];
+        int first = entry.slave_id == 255 ? 0 : entry.slave_id;
+        int last = entry.slave_id == 255 ? slaves_count - 1 : entry.slave_id;
+
+        for (int slave = first; slave <= last; slave++)
+        {
+            if (count == OUTPUT_PATCH_MAX_WRITES)
+            {
+                ROS_ERROR("pdo_listener_batch: more than %d writes, the scheduled batch is dropped\n", OUTPUT_PATCH_MAX_WRITES);
+                return;
+            }
+            OutputImage::make_write(&scheduled_writes_[count++], slave, slave_offsets[slave].pdo_out + entry.offset,
+                                    (pdo_type)entry.type, entry.bit, entry.value);
+        }
+    }
+    schedule_writes("pdo_listener_batch", count, batch->target_cycle, batch->based_on_cycle, current_cycle);
+}
+
+bool PDOOutListener::check_command(const ether_ros::PDOCommand &command, size_t i)
+{
+    if (command.variable >= variables_.size())
+    {
+        ROS_ERROR("pdo_command: command %lu: no variable %u, the batch is dropped\n", i, command.variable);
+        return false;
+    }
+    // a broadcast goes to the slaves that have the variable, and there's at least one
+    if (command.slave_id == 255)
+        return true;
+    if (command.slave_id >= slaves_count)
+    {
+        ROS_ERROR("pdo_command: command %lu: no slave %u, the batch is dropped\n", i, command.slave_id);
+        return false;
+    }
+    if (!variables_.slot(command.variable, command.slave_id).write)
+    {
+        ROS_ERROR("pdo_command: command %lu: slave %u has no variable %s, the batch is dropped\n",
+                  i, command.slave_id, variables_.names()[command.variable].c_str());
+        return false;
+    }
+    return true;
+}
+
+void PDOOutListener::pdo_command_callback(const ether_ros::PDOCommandBatch::ConstPtr &batch)
+{
+    const std::vector<ether_ros::PDOCommand> &commands = batch->commands;
+
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        if (!check_command(commands[i], i))
+            return;
+    }
+
+    if (batch->target_cycle)
+    {
+        pthread_mutex_lock(&schedule_mutex_);
+        schedule_commands(batch);
+        pthread_mutex_unlock(&schedule_mutex_);
+        return;
+    }
+    output_image.begin_write();
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const ether_ros::PDOCommand &command = commands[i];
+        int first = command.slave_id == 255 ? 0 : command.slave_id;
+        int last = command.slave_id == 255 ? slaves_count - 1 : command.slave_id;
+
+        for (int slave = first; slave <= last; slave++)
+        {
+            const pdo_variable_slot &slot = variables_.slot(command.variable, slave);
+            if (slot.write)
+                slot.write(process_data_buf + slot.offset, slot.bit, command.value);
+        }
+    }
+    output_image.commit(batch->based_on_cycle);
+    feed_output_watchdog(commands);
+}
+
+void PDOOutListener::schedule_commands(const ether_ros::PDOCommandBatch::ConstPtr &batch)
+{
+    const std::vector<ether_ros::PDOCommand> &commands = batch->commands;
+    uint64_t current_cycle = EthercatCommunicator::current_cycle();
+    size_t count = 0;
+
+    if (!check_target_cycle("pdo_command", batch->target_cycle, current_cycle))
+        return;
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const ether_ros::PDOCommand &command = commands[i];
+        int first = command.slave_id == 255 ? 0 : command.slave_id;
+        int last = command.slave_id == 255 ? slaves_count - 1 : command.slave_id;
+
+        for (int slave = first; slave <= last; slave++)
+        {
+            const pdo_variable_slot &slot = variables_.slot(command.variable, slave);
+            if (!slot.write)
+                continue;
+            if (count == OUTPUT_PATCH_MAX_WRITES)
+            {
+                ROS_ERROR("pdo_command: more than %d writes, the scheduled batch is dropped\n", OUTPUT_PATCH_MAX_WRITES);
+                return;
+            }
+            OutputImage::make_write(&scheduled_writes_[count++], slave, slot.offset, slot.type, slot.bit, command.value);
+        }
+    }
+    schedule_writes("pdo_command", count, batch->target_cycle, batch->based_on_cycle, current_cycle);
+}
+
 void PDOOutListener::init(ros::NodeHandle &n)
 {
+    int ret;
+
+    // the writes of a scheduled batch are built here, not in every callback
+    scheduled_writes_.resize(OUTPUT_PATCH_MAX_WRITES);
+    ret = pthread_mutex_init(&schedule_mutex_, NULL);
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_mutex_init");
+    }
+    n.param("/ethercat_slaves/max_schedule_ahead_cycles", max_schedule_ahead_cycles_, 10000);
+
+    // the ids of the compact commands, resolved once by the clients from the parameter
+    variables_.init();
+    n.setParam("/ethercat_slaves/pdo_out_variables", variables_.names());
+    ROS_INFO("pdo_command: %lu output PDO variables in /ethercat_slaves/pdo_out_variables\n", variables_.size());
+
     //Create  ROS subscriber for the Ethercat RAW data
     pdo_out_listener_ = n.subscribe("pdo_listener", 1000, &PDOOutListener::pdo_out_callback, &pdo_out_listener);
+    pdo_out_batch_listener_ = n.subscribe("pdo_listener_batch", 100, &PDOOutListener::pdo_out_batch_callback, &pdo_out_listener);
+    pdo_command_listener_ = n.subscribe("pdo_command", 100, &PDOOutListener::pdo_command_callback, &pdo_out_listener);
 }
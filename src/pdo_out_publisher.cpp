@@ -32,7 +32,7 @@
    \file pdo_out_publisher.cpp
    \brief Implementation of PDOOutPublisher class.
 
-   Used for handling the "raw" output data, received from EtherCAT Communicator and transforming them into
+   Used for handling the "raw" output data, read from the \a pdo_raw_ring and transforming them into
    useful, human-readable format, consisted of the EtherCAT variables used by our
    application. Transforms the indeces to variables.
 */
@@ -41,72 +41,108 @@
 
 #include "pdo_out_publisher.h"
 #include "ether_ros/PDOOut.h"
-#include "ether_ros/PDORaw.h"
+#include "ether_ros/PDOOutAll.h"
 #include "ethercat_slave.h"
+#include "pdo_bindings.h"
 #include "utilities.h"
 #include "vector"
 #include "ether_ros.h"
 #include <iostream>
 #include <string>
+#include <time.h>
 
-void PDOOutPublisher::pdo_raw_callback(const ether_ros::PDORaw::ConstPtr &pdo_raw)
+int PDOOutPublisher::wakeup_period_ns()
 {
-    std::vector<uint8_t> pdo_out_raw = pdo_raw->pdo_out_raw;
-    uint8_t *data_ptr;
-    size_t pos;
-    for (int i = 0; i < master_info.slave_count; i++)
-    {
-        pos = i * num_process_data_out; //The size of every entry is num_process_data_out
-        data_ptr = (uint8_t *)&pdo_out_raw[pos];
-        ether_ros::PDOOut pdo_out;
-        pdo_out.slave_id = i;
-        using namespace utilities;
-
-        // change the following code to match your needs
-        /*
+    return throttle_.consumer_period_ns();
+}
 
-        Insert code here ...
+void PDOOutPublisher::consume()
+{
+    // the subscribers are counted once per wakeup, not once per snapshot
+    subscribed_ = per_slave_ && pdo_out_pub_.getNumSubscribers() > 0;
+    aggregated_subscribed_ = aggregated_ && pdo_out_all_pub_.getNumSubscribers() > 0;
+    if (!subscribed_ && !aggregated_subscribed_)
+    {
+        skip();
+        return;
+    }
+    // decimated: only the latest snapshot is of interest, the older ones are skipped without copying them
+    while (throttle_.decimation() == 1 ? read() : read_latest())
+    {
+        if (throttle_.due(snapshot_.cycle))
+            publish_pdo_out(snapshot_);
+    }
+}
 
-        */
-        pdo_out.state_machine = process_input_bit(data_ptr, 0, 0);
-        pdo_out.initialize_clock = process_input_bit(data_ptr, 0, 1);
-        pdo_out.initialize_angles = process_input_bit(data_ptr, 0, 2);
-        pdo_out.inverse_kinematics = process_input_bit(data_ptr, 0, 3);
-        pdo_out.blue_led = process_input_bit(data_ptr, 0, 4);
-        pdo_out.red_led = process_input_bit(data_ptr, 0, 5);
-        pdo_out.button_1 = process_input_bit(data_ptr, 0, 6);
-        pdo_out.button_2 = process_input_bit(data_ptr, 0, 7);
-        pdo_out.sync = process_input_int8(data_ptr, 1);
-        pdo_out.desired_x_value = process_input_int32(data_ptr, 2);
-        pdo_out.filter_bandwidth = process_input_uint16(data_ptr, 6);
-        pdo_out.desired_y_value = process_input_int32(data_ptr, 8);
-        pdo_out.kp_100_knee = process_input_int16(data_ptr, 12);
-        pdo_out.kd_1000_knee = process_input_int16(data_ptr, 14);
-        pdo_out.ki_100_knee = process_input_int16(data_ptr, 16);
-        pdo_out.kp_100_hip = process_input_int16(data_ptr, 18);
-        pdo_out.kd_1000_hip = process_input_int16(data_ptr, 20);
-        pdo_out.ki_100_hip = process_input_int16(data_ptr, 22);
-        pdo_out.x_cntr_traj1000 = process_input_int16(data_ptr, 24);
-        pdo_out.y_cntr_traj1000 = process_input_int16(data_ptr, 26);
-        pdo_out.a_ellipse100 = process_input_int16(data_ptr, 28);
-        pdo_out.b_ellipse100 = process_input_int16(data_ptr, 30);
-        pdo_out.traj_freq100 = process_input_int16(data_ptr, 32);
-        pdo_out.phase_deg = process_input_int16(data_ptr, 34);
-        pdo_out.flatness_param100 = process_input_int16(data_ptr, 36);
+void PDOOutPublisher::publish_pdo_out(const pdo_raw_snapshot &snapshot)
+{
+    const uint8_t *frame = snapshot.data;
+    bool any_changed = false;
+    ros::Time stamp;
 
-        /*
-            .....
+    stamp.fromNSec(snapshot.timestamp_ns + clock_offset_ns_);
+    for (int i = 0; i < slaves_count; i++)
+    {
+        const uint8_t *data_ptr = frame + slave_offsets[i].pdo_out;
+        if (!throttle_.changed(i, data_ptr, slave_offsets[i].pdo_out_size))
+            continue;
+        any_changed = true;
+        if (!subscribed_)
+            continue;
+        ether_ros::PDOOut pdo_out;
+        pdo_out.header.seq = (uint32_t)snapshot.cycle;
+        pdo_out.header.stamp = stamp;
+        pdo_out.slave_id = i;
 
-        */
+        // the variables are declared in the pdo_out layout of the slave, in ethercat_slaves.yaml
+        decoders_[i].decode(data_ptr, pdo_out);
         pdo_out_pub_.publish(pdo_out);
     }
+    // a single message with every slave, if any of them changed
+    if (aggregated_subscribed_ && any_changed)
+    {
+        pdo_out_all_.header.seq = (uint32_t)snapshot.cycle;
+        pdo_out_all_.header.stamp = stamp;
+        pdo_out_all_.cycle = snapshot.cycle;
+        pdo_out_all_.cycle_time_ns = snapshot.timestamp_ns;
+        // a column of every slave at a time (struct of arrays)
+        all_decoder_.decode(frame, pdo_out_all_);
+        pdo_out_all_pub_.publish(pdo_out_all_);
+    }
 }
 
 void PDOOutPublisher::init(ros::NodeHandle &n)
 {
-    //Create  ROS subscriber for the Ethercat RAW data
-    pdo_raw_sub_ = n.subscribe("pdo_raw", 1000, &PDOOutPublisher::pdo_raw_callback, &pdo_out_publisher);
+    struct timespec realtime, monotonic;
+
+    throttle_.init(n, "pdo_out", 10.0, true, slaves_count);
+    if (!throttle_.enabled())
+        return;
+    n.param("/ethercat_slaves/publishers/pdo_out/per_slave", per_slave_, true);
+    n.param("/ethercat_slaves/publishers/pdo_out/aggregated", aggregated_, false);
+
+    // the offset of the ROS clock from the clock of the cycles, for stamping the messages
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_TO_USE, &monotonic);
+    clock_offset_ns_ = (int64_t)TIMESPEC2NS(realtime) - (int64_t)TIMESPEC2NS(monotonic);
+
+    if (per_slave_)
+    {
+        //Compile the PDO layouts of the slaves into decoders
+        init_pdo_out_decoders(decoders_);
+        //Create  ROS publisher for the Ethercat formatted data
+        pdo_out_pub_ = n.advertise<ether_ros::PDOOut>("pdo_out", 1000);
+    }
+    if (aggregated_)
+    {
+        // the arrays are sized once, the message is reused in every publish
+        init_pdo_out_all_decoder(all_decoder_);
+        all_decoder_.prepare(pdo_out_all_);
+        pdo_out_all_pub_ = n.advertise<ether_ros::PDOOutAll>("pdo_out_all", 1000);
+    }
+    subscribed_ = false;
+    aggregated_subscribed_ = false;
 
-    //Create  ROS publisher for the Ethercat formatted data
-    pdo_out_pub_ = n.advertise<ether_ros::PDOOut>("pdo_out", 1000);
+    //Read the Ethercat RAW data straight from the ring
+    start_consumer();
 }
@@ -43,6 +43,7 @@
 #include "pdo_out_publisher_timer.h"
 #include "ether_ros/PDOOut.h"
 #include "ethercat_slave.h"
+#include "pdo_bindings.h"
 #include "utilities.h"
 #include "vector"
 #include "ether_ros.h"
@@ -51,63 +52,40 @@
 
 void PDOOutPublisherTimer::timer_callback(const ros::TimerEvent &event)
 {
-    size_t pos;
     uint8_t *data_ptr;
-    using namespace utilities;
-    copy_process_data_buffer_to_buf(data_ptr_);
+    output_image.snapshot(data_ptr_);
 
-    for (int i = 0; i < master_info.slave_count; i++)
+    for (int i = 0; i < slaves_count; i++)
     {
-        pos = i * (num_process_data_out + num_process_data_in); //The size of every entry is num_process_data_out
-        data_ptr = (uint8_t *)(data_ptr_ + pos);
+        data_ptr = (uint8_t *)(data_ptr_ + slave_offsets[i].pdo_out);
+        if (!throttle_.changed(i, data_ptr, slave_offsets[i].pdo_out_size))
+            continue;
         ether_ros::PDOOut pdo_out;
         pdo_out.slave_id = i;
 
-        // change the following code to match your needs
-        /*
-
-        Insert code here ...
-
-        */
-        pdo_out.state_machine = process_input_bit(data_ptr, 0, 0);
-        pdo_out.initialize_clock = process_input_bit(data_ptr, 0, 1);
-        pdo_out.initialize_angles = process_input_bit(data_ptr, 0, 2);
-        pdo_out.inverse_kinematics = process_input_bit(data_ptr, 0, 3);
-        pdo_out.blue_led = process_input_bit(data_ptr, 0, 4);
-        pdo_out.red_led = process_input_bit(data_ptr, 0, 5);
-        pdo_out.button_1 = process_input_bit(data_ptr, 0, 6);
-        pdo_out.button_2 = process_input_bit(data_ptr, 0, 7);
-        pdo_out.sync = process_input_int8(data_ptr, 1);
-        pdo_out.desired_x_value = process_input_int32(data_ptr, 2);
-        pdo_out.filter_bandwidth = process_input_uint16(data_ptr, 6);
-        pdo_out.desired_y_value = process_input_int32(data_ptr, 8);
-        pdo_out.kp_100_knee = process_input_int16(data_ptr, 12);
-        pdo_out.kd_1000_knee = process_input_int16(data_ptr, 14);
-        pdo_out.ki_100_knee = process_input_int16(data_ptr, 16);
-        pdo_out.kp_100_hip = process_input_int16(data_ptr, 18);
-        pdo_out.kd_1000_hip = process_input_int16(data_ptr, 20);
-        pdo_out.ki_100_hip = process_input_int16(data_ptr, 22);
-        pdo_out.x_cntr_traj1000 = process_input_int16(data_ptr, 24);
-        pdo_out.y_cntr_traj1000 = process_input_int16(data_ptr, 26);
-        pdo_out.a_ellipse100 = process_input_int16(data_ptr, 28);
-        pdo_out.b_ellipse100 = process_input_int16(data_ptr, 30);
-        pdo_out.traj_freq100 = process_input_int16(data_ptr, 32);
-        pdo_out.phase_deg = process_input_int16(data_ptr, 34);
-        pdo_out.flatness_param100 = process_input_int16(data_ptr, 36);
-
-        /*
-            .....
-
-        */
+        // the variables are declared in the pdo_out layout of the slave, in ethercat_slaves.yaml
+        decoders_[i].decode(data_ptr, pdo_out);
         pdo_out_pub_.publish(pdo_out);
     }
 }
 
 void PDOOutPublisherTimer::init(ros::NodeHandle &n)
 {
+    throttle_.init(n, "pdo_out_timer", 0.2, false, slaves_count);
+    if (!throttle_.enabled())
+        return;
+    if (throttle_.rate() <= 0)
+    {
+        ROS_FATAL("/ethercat_slaves/publishers/pdo_out_timer/rate must be positive\n");
+        exit(1);
+    }
+
     data_ptr_ = (uint8_t *)malloc(total_process_data * sizeof(uint8_t));
     memset(data_ptr_, 0, total_process_data); // fill the buffer with zeros
 
+    //Compile the PDO layouts of the slaves into decoders
+    init_pdo_out_decoders(decoders_);
+
     //Create  ROS publisher for the Ethercat formatted data
     pdo_out_pub_ = n.advertise<ether_ros::PDOOut>("pdo_out_timer", 1000);
 
@@ -120,9 +98,8 @@ void PDOOutPublisherTimer::init(ros::NodeHandle &n)
     {
         ROS_INFO("Started ProcessDataTimer publisher\n");
     }
-    pdo_out_timer_ = n.createTimer(ros::Duration(5), &PDOOutPublisherTimer::timer_callback, &pdo_out_publisher_timer);
     //Create  ROS timer
-    //first parameter is in seconds...
+    pdo_out_timer_ = n.createTimer(ros::Duration(1.0 / throttle_.rate()), &PDOOutPublisherTimer::timer_callback, this);
 
     if (!pdo_out_timer_)
     {
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_raw_publisher.cpp
+   \brief Implementation of PDORawPublisher class.
+
+   Used for publishing the "raw" data to the \a /pdo_raw topic, outside of the realtime
+   context. The EtherCAT Communicator writes a snapshot of the domain in the \a pdo_raw_ring in
+   every cycle, and this publisher transforms every one of them into a PDORaw message.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "pdo_raw_publisher.h"
+#include "ether_ros/PDORaw.h"
+#include "ether_ros.h"
+
+void PDORawPublisher::init(ros::NodeHandle &n)
+{
+    // the sizes never change after the domain is configured, so the vectors are never reallocated
+    raw_data_.pdo_in_raw.resize(total_pdo_in);
+    raw_data_.pdo_out_raw.resize(total_pdo_out);
+
+    // the offset of the ROS clock from the clock of the cycles, for stamping the messages
+    struct timespec realtime, monotonic;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_TO_USE, &monotonic);
+    clock_offset_ns_ = (int64_t)TIMESPEC2NS(realtime) - (int64_t)TIMESPEC2NS(monotonic);
+
+    //Create  ROS publisher for the Ethercat RAW data
+    pdo_raw_pub_ = n.advertise<ether_ros::PDORaw>("pdo_raw", 1000);
+
+    start_consumer();
+}
+
+void PDORawPublisher::consume()
+{
+    if (!pdo_raw_pub_.getNumSubscribers())
+    {
+        skip();
+        return;
+    }
+    while (read())
+    {
+        publish_frame(snapshot_.cycle, snapshot_.timestamp_ns, snapshot_.data);
+    }
+}
+
+void PDORawPublisher::publish_frame(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *frame)
+{
+    uint8_t *input_data_raw = raw_data_.pdo_in_raw.data();
+    uint8_t *output_data_raw = raw_data_.pdo_out_raw.data();
+
+    for (int i = 0; i < slaves_count; i++)
+    {
+        memcpy(input_data_raw + slave_offsets[i].raw_in,
+               frame + slave_offsets[i].pdo_in, slave_offsets[i].pdo_in_size);
+        memcpy(output_data_raw + slave_offsets[i].raw_out,
+               frame + slave_offsets[i].pdo_out, slave_offsets[i].pdo_out_size);
+    }
+    raw_data_.header.seq = (uint32_t)cycle;
+    raw_data_.header.stamp.fromNSec(timestamp_ns + clock_offset_ns_);
+    raw_data_.cycle = cycle;
+    raw_data_.cycle_time_ns = timestamp_ns;
+    pdo_raw_pub_.publish(raw_data_);
+}
@@ -0,0 +1,231 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_raw_ring.cpp
+   \brief Implementation of PDORawRing and PDORawRingConsumer classes.
+
+   In-process fan-out of the domain snapshots, from the EtherCAT Communicator to the
+   publishers and loggers, without going through the ROS transport.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "pdo_raw_ring.h"
+#include "utilities.h"
+#include "ether_ros.h"
+
+PDORawRing::PDORawRing() : slots_(NULL), data_(NULL), capacity_(0), mask_(0), frame_size_(0), head_(0)
+{
+}
+
+PDORawRing::~PDORawRing()
+{
+    delete[] slots_;
+    delete[] data_;
+}
+
+void PDORawRing::init(size_t capacity, size_t frame_size)
+{
+    capacity_ = 1;
+    while (capacity_ < capacity)
+        capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    frame_size_ = frame_size;
+
+    slots_ = new slot[capacity_];
+    data_ = new uint8_t[capacity_ * frame_size_];
+    memset(data_, 0, capacity_ * frame_size_); // prefault the pages, before the realtime use
+    for (size_t i = 0; i < capacity_; i++)
+    {
+        slots_[i].seq.store(0, std::memory_order_relaxed);
+        slots_[i].cycle = 0;
+        slots_[i].timestamp_ns = 0;
+        slots_[i].period_ns = 0;
+        slots_[i].data = data_ + i * frame_size_;
+    }
+    head_.store(0, std::memory_order_release);
+}
+
+size_t PDORawRing::frame_size()
+{
+    return frame_size_;
+}
+
+void PDORawRing::write(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *data)
+{
+    uint64_t index = head_.load(std::memory_order_relaxed);
+    slot *s = &slots_[index & mask_];
+
+    // odd sequence: the slot is being written
+    s->seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->cycle = cycle;
+    s->timestamp_ns = timestamp_ns;
+    // the period only changes while the realtime thread is stopped
+    s->period_ns = PERIOD_NS.load(std::memory_order_relaxed);
+    memcpy(s->data, data, frame_size_);
+    s->seq.store(2 * index + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+}
+
+void PDORawRing::attach(cursor *c)
+{
+    c->next = head_.load(std::memory_order_acquire);
+    c->overruns = 0;
+}
+
+bool PDORawRing::read_slot(uint64_t index, pdo_raw_snapshot *snapshot)
+{
+    slot *s = &slots_[index & mask_];
+    uint64_t seq = s->seq.load(std::memory_order_acquire);
+
+    if (seq != 2 * index + 2)
+        return false; // already overwritten (or being overwritten) by a newer snapshot
+    snapshot->cycle = s->cycle;
+    snapshot->timestamp_ns = s->timestamp_ns;
+    snapshot->period_ns = s->period_ns;
+    memcpy(snapshot->data, s->data, frame_size_);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s->seq.load(std::memory_order_relaxed) == seq;
+}
+
+bool PDORawRing::read(cursor *c, pdo_raw_snapshot *snapshot)
+{
+    uint64_t head = head_.load(std::memory_order_acquire);
+
+    while (c->next < head)
+    {
+        if (head - c->next > capacity_)
+        {
+            c->overruns += head - capacity_ - c->next;
+            c->next = head - capacity_;
+        }
+        if (read_slot(c->next, snapshot))
+        {
+            c->next++;
+            return true;
+        }
+        // lost the race with the writer
+        c->overruns++;
+        c->next++;
+        head = head_.load(std::memory_order_acquire);
+    }
+    return false;
+}
+
+bool PDORawRing::read_latest(cursor *c, pdo_raw_snapshot *snapshot)
+{
+    uint64_t head = head_.load(std::memory_order_acquire);
+
+    if (c->next >= head)
+        return false;
+    c->next = head - 1;
+    return read(c, snapshot);
+}
+
+void PDORawRing::skip(cursor *c)
+{
+    c->next = head_.load(std::memory_order_acquire);
+}
+
+//--------------------------------------------------------------------------//
+
+void PDORawRingConsumer::start_consumer()
+{
+    pthread_attr_t attr;
+    int ret;
+
+    snapshot_.data = new uint8_t[pdo_raw_ring.frame_size()];
+    memset(snapshot_.data, 0, pdo_raw_ring.frame_size());
+    pdo_raw_ring.attach(&cursor_);
+
+    // the consumer threads keep the default (non realtime) scheduling attributes, on the telemetry CPUs,
+    // so the decoding, the recording and the publishing never run on the realtime CPU
+    pthread_attr_init(&attr);
+    ret = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &telemetry_spinner.cpuset());
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_attr_setaffinity_np");
+    }
+    ret = pthread_create(&consumer_thread_, &attr, &PDORawRingConsumer::run, this);
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_create");
+    }
+    pthread_attr_destroy(&attr);
+}
+
+bool PDORawRingConsumer::read()
+{
+    return pdo_raw_ring.read(&cursor_, &snapshot_);
+}
+
+bool PDORawRingConsumer::read_latest()
+{
+    return pdo_raw_ring.read_latest(&cursor_, &snapshot_);
+}
+
+void PDORawRingConsumer::skip()
+{
+    pdo_raw_ring.skip(&cursor_);
+}
+
+int PDORawRingConsumer::wakeup_period_ns()
+{
+    return PERIOD_NS;
+}
+
+uint64_t PDORawRingConsumer::overruns()
+{
+    return cursor_.overruns;
+}
+
+void *PDORawRingConsumer::run(void *arg)
+{
+    PDORawRingConsumer *consumer = (PDORawRingConsumer *)arg;
+    struct timespec period, wakeup_time;
+    int period_ns;
+
+    clock_gettime(CLOCK_TO_USE, &wakeup_time);
+    while (ros::ok())
+    {
+        // the period may have been changed (ethercat_communicatord period)
+        period_ns = consumer->wakeup_period_ns();
+        period.tv_sec = period_ns / NSEC_PER_SEC;
+        period.tv_nsec = period_ns % NSEC_PER_SEC;
+        wakeup_time = utilities::timespec_add(wakeup_time, period);
+        clock_nanosleep(CLOCK_TO_USE, TIMER_ABSTIME, &wakeup_time, NULL);
+        consumer->consume();
+    }
+    return NULL;
+}
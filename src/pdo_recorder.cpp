@@ -0,0 +1,250 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_recorder.cpp
+   \brief Implementation of PDORecorder class.
+
+   Used for recording the domain snapshots of every cycle in a binary file, outside of the realtime
+   context, for the post-processing of the experiments. Replaces the recording of the topics with
+   rosbag, which can't keep up with the 1 kHz streams of many slaves.
+*/
+
+/*****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <sstream>
+#include "pdo_recorder.h"
+#include "ether_ros.h"
+
+static std::string layout_text()
+{
+    std::ostringstream text;
+
+    for (int i = 0; i < slaves_count; i++)
+    {
+        const PDOLayout *layouts[2] = {&ethercat_slaves[i].slave.get_pdo_in_layout(), &ethercat_slaves[i].slave.get_pdo_out_layout()};
+        for (int l = 0; l < 2; l++)
+        {
+            for (size_t f = 0; f < layouts[l]->size(); f++)
+            {
+                const pdo_field &field = layouts[l]->field(f);
+                text << i << (l ? " out " : " in ") << field.name << " " << pdo_type_name(field.type) << " "
+                     << field.offset << " " << (int)field.bit << "\n";
+            }
+        }
+    }
+    return text.str();
+}
+
+PDORecorder::PDORecorder() : enabled_(false), fd_(-1), header_(NULL), window_(NULL), finished_(false)
+{
+}
+
+void PDORecorder::init(ros::NodeHandle &n)
+{
+    int window_mb, max_size_mb;
+    int ret;
+    struct timespec realtime, monotonic;
+
+    n.param("/ethercat_slaves/recorder/enabled", enabled_, false);
+    if (!enabled_)
+        return;
+    n.param<std::string>("/ethercat_slaves/recorder/path", path_, "/tmp/ether_ros.rec");
+    n.param("/ethercat_slaves/recorder/window_mb", window_mb, 64);
+    n.param("/ethercat_slaves/recorder/max_size_mb", max_size_mb, 0);
+    if (window_mb <= 0 || max_size_mb < 0)
+    {
+        ROS_FATAL("Recorder: the window_mb must be positive and the max_size_mb not negative\n");
+        exit(1);
+    }
+    window_size_ = (size_t)window_mb << 20;
+    max_size_ = (uint64_t)max_size_mb << 20;
+
+    fd_ = open(path_.c_str(), O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd_ < 0)
+    {
+        ROS_FATAL("Recorder: could not create %s: %s\n", path_.c_str(), strerror(errno));
+        exit(1);
+    }
+    // the offset of the wall clock from the clock of the cycles, for the timestamps
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_TO_USE, &monotonic);
+    write_header((int64_t)TIMESPEC2NS(realtime) - (int64_t)TIMESPEC2NS(monotonic));
+    // a window starts at the page of its first record: every record must fit in it, from anywhere in that page
+    if (header_->record_size + (size_t)sysconf(_SC_PAGESIZE) > window_size_)
+    {
+        ROS_FATAL("Recorder: a record (%u bytes) doesn't fit in the window_mb (%d MB)\n", header_->record_size, window_mb);
+        exit(1);
+    }
+    position_ = header_->data_offset;
+    if (!map_window(position_))
+        exit(1);
+
+    ret = pthread_mutex_init(&mutex_, NULL);
+    if (ret != 0)
+    {
+        handle_error_en(ret, "pthread_mutex_init");
+    }
+    start_consumer();
+    ROS_INFO("Recorder: recording the domain (%lu bytes per cycle) to %s\n", total_process_data, path_.c_str());
+}
+
+void PDORecorder::write_header(int64_t clock_offset_ns)
+{
+    std::string layout = layout_text();
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t slaves_offset = sizeof(pdo_record_header);
+    size_t layout_offset = slaves_offset + slaves_count * sizeof(pdo_record_slave);
+    size_t data_offset = (layout_offset + layout.size() + page - 1) / page * page;
+
+    if (ftruncate(fd_, data_offset))
+    {
+        ROS_FATAL("Recorder: ftruncate: %s\n", strerror(errno));
+        exit(1);
+    }
+    void *header = mmap(NULL, data_offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (header == MAP_FAILED)
+    {
+        ROS_FATAL("Recorder: mmap: %s\n", strerror(errno));
+        exit(1);
+    }
+    header_ = (pdo_record_header *)header;
+    header_->header_size = sizeof(pdo_record_header);
+    header_->image_size = total_process_data;
+    header_->record_size = (sizeof(pdo_record_entry) + total_process_data + 7) & ~7;
+    header_->slave_count = slaves_count;
+    header_->period_ns = PERIOD_NS;
+    header_->layout_size = layout.size();
+    header_->slaves_offset = slaves_offset;
+    header_->layout_offset = layout_offset;
+    header_->data_offset = data_offset;
+    header_->clock_offset_ns = clock_offset_ns;
+    header_->records.store(0, std::memory_order_relaxed);
+    header_->dropped.store(0, std::memory_order_relaxed);
+
+    pdo_record_slave *slaves = (pdo_record_slave *)((uint8_t *)header + slaves_offset);
+    for (int i = 0; i < slaves_count; i++)
+    {
+        strncpy(slaves[i].name, ethercat_slaves[i].slave_name.c_str(), PDO_RECORD_NAME_SIZE - 1);
+        slaves[i].pdo_out_offset = slave_offsets[i].pdo_out;
+        slaves[i].pdo_out_size = slave_offsets[i].pdo_out_size;
+        slaves[i].pdo_in_offset = slave_offsets[i].pdo_in;
+        slaves[i].pdo_in_size = slave_offsets[i].pdo_in_size;
+    }
+    memcpy((uint8_t *)header + layout_offset, layout.data(), layout.size());
+    header_->version = PDO_RECORD_VERSION;
+    // the magic goes last: a reader seeing it can trust the rest of the header
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = PDO_RECORD_MAGIC;
+}
+
+bool PDORecorder::map_window(uint64_t position)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    if (window_)
+        munmap(window_, window_size_);
+    window_ = NULL;
+    window_offset_ = position / page * page;
+    // the file grows a window at a time; the pages beyond the records are truncated at finish()
+    if (ftruncate(fd_, window_offset_ + window_size_))
+    {
+        ROS_ERROR("Recorder: ftruncate: %s, the recording stops\n", strerror(errno));
+        return false;
+    }
+    void *window = mmap(NULL, window_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, window_offset_);
+    if (window == MAP_FAILED)
+    {
+        ROS_ERROR("Recorder: mmap: %s, the recording stops\n", strerror(errno));
+        return false;
+    }
+    window_ = (uint8_t *)window;
+    return true;
+}
+
+int PDORecorder::wakeup_period_ns()
+{
+    // every 10 cycles: the ring keeps the snapshots in between
+    return PERIOD_NS * 10;
+}
+
+void PDORecorder::consume()
+{
+    const size_t record_size = header_->record_size;
+
+    pthread_mutex_lock(&mutex_);
+    while (!finished_ && read())
+    {
+        if (max_size_ && position_ + record_size > max_size_)
+        {
+            ROS_WARN("Recorder: %s reached max_size_mb, the recording stops\n", path_.c_str());
+            finished_ = true;
+            break;
+        }
+        if (position_ + record_size > window_offset_ + window_size_ && !map_window(position_))
+        {
+            finished_ = true;
+            break;
+        }
+        pdo_record_entry *entry = (pdo_record_entry *)(window_ + (position_ - window_offset_));
+        entry->cycle = snapshot_.cycle;
+        entry->timestamp_ns = snapshot_.timestamp_ns;
+        entry->period_ns = snapshot_.period_ns;
+        entry->reserved = 0;
+        memcpy(entry + 1, snapshot_.data, total_process_data);
+        position_ += record_size;
+        header_->records.store(header_->records.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    header_->dropped.store(overruns(), std::memory_order_relaxed);
+    pthread_mutex_unlock(&mutex_);
+}
+
+void PDORecorder::finish()
+{
+    if (!enabled_)
+        return;
+    consume();
+    pthread_mutex_lock(&mutex_);
+    finished_ = true;
+    if (window_)
+        munmap(window_, window_size_);
+    window_ = NULL;
+    if (ftruncate(fd_, position_))
+        ROS_ERROR("Recorder: ftruncate: %s\n", strerror(errno));
+    ROS_INFO("Recorder: %lu records (%lu dropped) in %s\n", header_->records.load(std::memory_order_relaxed),
+             header_->dropped.load(std::memory_order_relaxed), path_.c_str());
+    close(fd_);
+    pthread_mutex_unlock(&mutex_);
+}
@@ -0,0 +1,311 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_schema.cpp
+   \brief Implementation of the PDO schema.
+
+   Loads the PDO layouts from the ROS Parameter Server and reads the variables they describe.
+*/
+
+/*****************************************************************************/
+
+#include "pdo_schema.h"
+#include "pdo_accessors.h"
+
+static const char *pdo_type_names[] = {
+    "bool", "uint8", "int8", "uint16", "int16", "uint32", "int32", "uint64", "int64"};
+
+pdo_type pdo_type_from_string(const std::string &type)
+{
+    for (int i = 0; i < PDO_INVALID; i++)
+    {
+        if (type == pdo_type_names[i])
+            return (pdo_type)i;
+    }
+    return PDO_INVALID;
+}
+
+const char *pdo_type_name(pdo_type type)
+{
+    if (type < 0 || type >= PDO_INVALID)
+        return "invalid";
+    return pdo_type_names[type];
+}
+
+size_t pdo_type_size(pdo_type type)
+{
+    switch (type)
+    {
+    case PDO_BOOL:
+    case PDO_UINT8:
+    case PDO_INT8:
+        return 1;
+    case PDO_UINT16:
+    case PDO_INT16:
+        return 2;
+    case PDO_UINT32:
+    case PDO_INT32:
+        return 4;
+    case PDO_UINT64:
+    case PDO_INT64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+int64_t read_pdo_value(const uint8_t *data_ptr, pdo_type type, size_t offset, uint8_t bit)
+{
+    switch (type)
+    {
+    case PDO_BOOL:
+        return utilities::pdo_read_bit(data_ptr, offset, bit);
+    case PDO_UINT8:
+        return utilities::pdo_read<uint8_t>(data_ptr, offset);
+    case PDO_INT8:
+        return utilities::pdo_read<int8_t>(data_ptr, offset);
+    case PDO_UINT16:
+        return utilities::pdo_read<uint16_t>(data_ptr, offset);
+    case PDO_INT16:
+        return utilities::pdo_read<int16_t>(data_ptr, offset);
+    case PDO_UINT32:
+        return utilities::pdo_read<uint32_t>(data_ptr, offset);
+    case PDO_INT32:
+        return utilities::pdo_read<int32_t>(data_ptr, offset);
+    case PDO_UINT64:
+        return (int64_t)utilities::pdo_read<uint64_t>(data_ptr, offset);
+    case PDO_INT64:
+        return utilities::pdo_read<int64_t>(data_ptr, offset);
+    default:
+        return 0;
+    }
+}
+
+int64_t read_pdo_field(const uint8_t *data_ptr, const pdo_field &field)
+{
+    return read_pdo_value(data_ptr, field.type, field.offset, field.bit);
+}
+
+void read_pdo_column(const uint8_t *frame, const size_t *slave_offsets, size_t slaves,
+                     const pdo_field &field, int64_t *column)
+{
+    switch (field.type)
+    {
+    case PDO_BOOL:
+        utilities::pdo_read_bit_column(frame, slave_offsets, slaves, field.offset, field.bit, column);
+        break;
+    case PDO_UINT8:
+        utilities::pdo_read_column<uint8_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_INT8:
+        utilities::pdo_read_column<int8_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_UINT16:
+        utilities::pdo_read_column<uint16_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_INT16:
+        utilities::pdo_read_column<int16_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_UINT32:
+        utilities::pdo_read_column<uint32_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_INT32:
+        utilities::pdo_read_column<int32_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_UINT64:
+        utilities::pdo_read_column<uint64_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    case PDO_INT64:
+        utilities::pdo_read_column<int64_t>(frame, slave_offsets, slaves, field.offset, column);
+        break;
+    default:
+        memset(column, 0, slaves * sizeof(int64_t));
+        break;
+    }
+}
+
+void write_pdo_value(uint8_t *data_ptr, pdo_type type, size_t offset, uint8_t bit, int64_t value)
+{
+    switch (type)
+    {
+    case PDO_BOOL:
+        utilities::pdo_write_bit(data_ptr, offset, bit, value != 0);
+        break;
+    case PDO_UINT8:
+        utilities::pdo_write<uint8_t>(data_ptr, offset, value);
+        break;
+    case PDO_INT8:
+        utilities::pdo_write<int8_t>(data_ptr, offset, value);
+        break;
+    case PDO_UINT16:
+        utilities::pdo_write<uint16_t>(data_ptr, offset, value);
+        break;
+    case PDO_INT16:
+        utilities::pdo_write<int16_t>(data_ptr, offset, value);
+        break;
+    case PDO_UINT32:
+        utilities::pdo_write<uint32_t>(data_ptr, offset, value);
+        break;
+    case PDO_INT32:
+        utilities::pdo_write<int32_t>(data_ptr, offset, value);
+        break;
+    case PDO_UINT64:
+        utilities::pdo_write<uint64_t>(data_ptr, offset, value);
+        break;
+    case PDO_INT64:
+        utilities::pdo_write<int64_t>(data_ptr, offset, value);
+        break;
+    default:
+        break;
+    }
+}
+
+template <class T>
+static void write_typed(uint8_t *data_ptr, uint8_t /*bit*/, int64_t value)
+{
+    utilities::pdo_write<T>(data_ptr, 0, value);
+}
+
+static void write_bool(uint8_t *data_ptr, uint8_t bit, int64_t value)
+{
+    utilities::pdo_write_bit(data_ptr, 0, bit, value != 0);
+}
+
+// in the order of pdo_type
+static const pdo_writer pdo_writers[PDO_INVALID] = {
+    write_bool,
+    write_typed<uint8_t>,
+    write_typed<int8_t>,
+    write_typed<uint16_t>,
+    write_typed<int16_t>,
+    write_typed<uint32_t>,
+    write_typed<int32_t>,
+    write_typed<uint64_t>,
+    write_typed<int64_t>,
+};
+
+pdo_writer pdo_type_writer(pdo_type type)
+{
+    return type < PDO_INVALID ? pdo_writers[type] : NULL;
+}
+
+bool PDOLayout::load(ros::NodeHandle &n, const std::string &param)
+{
+    XmlRpc::XmlRpcValue list;
+
+    fields_.clear();
+    if (!n.getParam(param, list))
+    {
+        ROS_ERROR("Failed to get the PDO layout '%s'\n", param.c_str());
+        return false;
+    }
+    return load(list, param);
+}
+
+bool PDOLayout::load(XmlRpc::XmlRpcValue &list, const std::string &param)
+{
+    fields_.clear();
+    if (list.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+        ROS_ERROR("The PDO layout '%s' isn't a list\n", param.c_str());
+        return false;
+    }
+    for (int i = 0; i < list.size(); i++)
+    {
+        XmlRpc::XmlRpcValue &entry = list[i];
+        pdo_field field;
+
+        if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct ||
+            !entry.hasMember("name") || !entry.hasMember("type") || !entry.hasMember("offset"))
+        {
+            ROS_ERROR("%s[%d]: every entry needs a name, a type and an offset\n", param.c_str(), i);
+            return false;
+        }
+        // a quoted number, or a number for a name, would throw in the casts
+        if (entry["name"].getType() != XmlRpc::XmlRpcValue::TypeString ||
+            entry["type"].getType() != XmlRpc::XmlRpcValue::TypeString ||
+            entry["offset"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+            (entry.hasMember("bit") && entry["bit"].getType() != XmlRpc::XmlRpcValue::TypeInt))
+        {
+            ROS_ERROR("%s[%d]: the name and the type must be strings, the offset and the bit integers\n", param.c_str(), i);
+            return false;
+        }
+        if (static_cast<int &>(entry["offset"]) < 0 || static_cast<int &>(entry["offset"]) > UINT16_MAX ||
+            (entry.hasMember("bit") && (static_cast<int &>(entry["bit"]) < 0 || static_cast<int &>(entry["bit"]) > 7)))
+        {
+            ROS_ERROR("%s[%d]: offset or bit out of range\n", param.c_str(), i);
+            return false;
+        }
+        field.name = static_cast<std::string &>(entry["name"]);
+        field.type = pdo_type_from_string(static_cast<std::string &>(entry["type"]));
+        field.offset = static_cast<int &>(entry["offset"]);
+        field.bit = entry.hasMember("bit") ? static_cast<int &>(entry["bit"]) : 0;
+        if (field.type == PDO_INVALID)
+        {
+            ROS_ERROR("%s[%d]: unknown type for '%s'\n", param.c_str(), i, field.name.c_str());
+            return false;
+        }
+        fields_.push_back(field);
+    }
+    return true;
+}
+
+size_t PDOLayout::size() const
+{
+    return fields_.size();
+}
+
+size_t PDOLayout::span() const
+{
+    size_t end = 0;
+    for (size_t i = 0; i < fields_.size(); i++)
+    {
+        size_t field_end = fields_[i].offset + pdo_type_size(fields_[i].type);
+        if (field_end > end)
+            end = field_end;
+    }
+    return end;
+}
+
+int PDOLayout::find(const std::string &name) const
+{
+    for (size_t i = 0; i < fields_.size(); i++)
+    {
+        if (fields_[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+const pdo_field &PDOLayout::field(size_t index) const
+{
+    return fields_[index];
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file pdo_variable_table.cpp
+   \brief Implementation of the PDOVariableTable class.
+
+   Resolves, once at startup, the output PDO variables of every slave to their offset in the
+   process image and to the writer of their type.
+*/
+
+/*****************************************************************************/
+
+#include "pdo_variable_table.h"
+#include "ethercat_slave.h"
+#include "ether_ros.h"
+
+void PDOVariableTable::init()
+{
+    pdo_variable_slot empty = {0, NULL, PDO_INVALID, 0};
+
+    names_.clear();
+    slaves_ = slaves_count;
+    for (int s = 0; s < slaves_count; s++)
+    {
+        const PDOLayout &layout = ethercat_slaves[s].slave.get_pdo_out_layout();
+        for (size_t i = 0; i < layout.size(); i++)
+        {
+            if (find(layout.field(i).name) < 0)
+                names_.push_back(layout.field(i).name);
+        }
+    }
+
+    slots_.assign(names_.size() * slaves_, empty);
+    for (int s = 0; s < slaves_count; s++)
+    {
+        const PDOLayout &layout = ethercat_slaves[s].slave.get_pdo_out_layout();
+        for (size_t i = 0; i < layout.size(); i++)
+        {
+            const pdo_field &field = layout.field(i);
+            if (field.offset + pdo_type_size(field.type) > slave_offsets[s].pdo_out_size)
+            {
+                ROS_FATAL("The pdo_out variable '%s' of slave %d is out of its output PDO\n", field.name.c_str(), s);
+                exit(1);
+            }
+            pdo_variable_slot &slot = slots_[find(field.name) * slaves_ + s];
+            slot.offset = slave_offsets[s].pdo_out + field.offset;
+            slot.write = pdo_type_writer(field.type);
+            slot.type = field.type;
+            slot.bit = field.bit;
+        }
+    }
+}
+
+size_t PDOVariableTable::size() const
+{
+    return names_.size();
+}
+
+const std::vector<std::string> &PDOVariableTable::names() const
+{
+    return names_;
+}
+
+int PDOVariableTable::find(const std::string &name) const
+{
+    for (size_t i = 0; i < names_.size(); i++)
+    {
+        if (names_[i] == name)
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,150 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file publish_throttle.cpp
+   \brief Implementation of PublishThrottle class.
+
+   Used for limiting the rate of the monitoring topics (\a pdo_in_slave_N, \a pdo_out, \a pdo_out_timer),
+   so they can stay enabled without loading the system.
+*/
+
+/*****************************************************************************/
+
+#include "publish_throttle.h"
+#include "ether_ros.h"
+#include <math.h>
+#include <algorithm>
+
+static uint64_t fnv1a(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+PublishThrottle::PublishThrottle()
+    : enabled_(true), rate_(0), on_change_(false), frequency_(0), decimation_(1), next_cycle_(0), unchanged_(0)
+{
+}
+
+void PublishThrottle::init(ros::NodeHandle &n, const std::string &topic, double default_rate, bool default_on_change, int slaves)
+{
+    std::string root = "/ethercat_slaves/publishers/" + topic;
+
+    n.param(root + "/enabled", enabled_, true);
+    n.param(root + "/rate", rate_, default_rate);
+    n.param(root + "/on_change", on_change_, default_on_change);
+    if (rate_ < 0)
+    {
+        ROS_FATAL("%s/rate must not be negative\n", root.c_str());
+        exit(1);
+    }
+    update_decimation();
+    next_cycle_ = 0;
+    hashes_.assign(slaves, 0);
+    published_.assign(slaves, false);
+    unchanged_ = 0;
+    ROS_INFO("%s: %s, every %lu cycles%s\n", topic.c_str(), enabled_ ? "enabled" : "disabled",
+             (unsigned long)decimation_, on_change_ ? ", on change" : "");
+}
+
+void PublishThrottle::update_decimation()
+{
+    frequency_ = FREQUENCY;
+    decimation_ = 1;
+    if (rate_ > 0 && rate_ < frequency_)
+        decimation_ = (uint64_t)llround(frequency_ / rate_);
+}
+
+bool PublishThrottle::due(uint64_t cycle)
+{
+    // the period may have been changed (ethercat_communicatord period): the rate is kept
+    if (frequency_ != FREQUENCY)
+        update_decimation();
+    if (cycle < next_cycle_)
+        return false;
+    next_cycle_ = cycle - cycle % decimation_ + decimation_;
+    return true;
+}
+
+bool PublishThrottle::changed(int slave, const uint8_t *data, size_t size)
+{
+    uint64_t hash;
+
+    if (!on_change_)
+        return true;
+    hash = fnv1a(data, size);
+    if (published_[slave] && hash == hashes_[slave])
+    {
+        unchanged_++;
+        return false;
+    }
+    hashes_[slave] = hash;
+    published_[slave] = true;
+    return true;
+}
+
+bool PublishThrottle::enabled()
+{
+    return enabled_;
+}
+
+double PublishThrottle::rate()
+{
+    return rate_;
+}
+
+uint64_t PublishThrottle::decimation()
+{
+    return decimation_;
+}
+
+bool PublishThrottle::on_change()
+{
+    return on_change_;
+}
+
+int PublishThrottle::consumer_period_ns()
+{
+    if (frequency_ != FREQUENCY)
+        update_decimation();
+    return PERIOD_NS * (int)std::min<uint64_t>(decimation_, FREQUENCY);
+}
+
+uint64_t PublishThrottle::unchanged()
+{
+    return unchanged_;
+}
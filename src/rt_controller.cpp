@@ -0,0 +1,119 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file rt_controller.cpp
+   \brief Implementation of the RTControllerIO class and of the registry of the controller types.
+*/
+
+/*****************************************************************************/
+
+#include <map>
+#include "rt_controller.h"
+#include "ether_ros.h"
+
+// a function static, so the registrations of the other translation units, before main(), find it constructed
+static std::map<std::string, rt_controller_factory> &factories()
+{
+    static std::map<std::string, rt_controller_factory> registered;
+    return registered;
+}
+
+namespace rt_controllers
+{
+bool register_type(const char *type, rt_controller_factory factory)
+{
+    return factories().insert(std::make_pair(std::string(type), factory)).second;
+}
+
+RTController *create(const std::string &type)
+{
+    std::map<std::string, rt_controller_factory>::iterator it = factories().find(type);
+
+    return it == factories().end() ? NULL : it->second();
+}
+
+std::vector<std::string> types()
+{
+    std::vector<std::string> names;
+
+    for (std::map<std::string, rt_controller_factory>::iterator it = factories().begin(); it != factories().end(); it++)
+        names.push_back(it->first);
+    return names;
+}
+} // namespace rt_controllers
+
+RTControllerIO::RTControllerIO() : inputs_(NULL), outputs_(NULL), cycle(0), time_ns(0), period_ns(0)
+{
+}
+
+bool RTControllerIO::resolve(int slave, const std::string &name, bool output, rt_variable *var)
+{
+    const char *direction = output ? "pdo_out" : "pdo_in";
+
+    if (slave < 0 || slave >= slaves_count)
+    {
+        ROS_ERROR("Controller %s: no slave %d\n", controller_.c_str(), slave);
+        return false;
+    }
+    const PDOLayout &layout = output ? ethercat_slaves[slave].slave.get_pdo_out_layout()
+                                     : ethercat_slaves[slave].slave.get_pdo_in_layout();
+    int index = layout.find(name);
+    if (index < 0)
+    {
+        ROS_ERROR("Controller %s: slave %s has no %s variable %s\n", controller_.c_str(),
+                  ethercat_slaves[slave].slave_name.c_str(), direction, name.c_str());
+        return false;
+    }
+    const pdo_field &field = layout.field(index);
+    var->offset = (output ? slave_offsets[slave].pdo_out : slave_offsets[slave].pdo_in) + field.offset;
+    var->type = field.type;
+    var->bit = field.bit;
+    return true;
+}
+
+bool RTControllerIO::input(int slave, const std::string &name, rt_variable *var)
+{
+    return resolve(slave, name, false, var);
+}
+
+bool RTControllerIO::output(int slave, const std::string &name, rt_variable *var)
+{
+    if (!resolve(slave, name, true, var))
+        return false;
+    claims_.push_back(*var);
+    for (size_t i = 0; i < slaves_.size(); i++)
+    {
+        if (slaves_[i] == slave)
+            return true;
+    }
+    slaves_.push_back(slave);
+    return true;
+}
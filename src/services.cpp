@@ -33,7 +33,7 @@
    \brief Implements the services used.
 
    Provides services for:
-   - Interacting with the EtherCAT Communicator
+   - Interacting with the EtherCAT Communicator (and changing its period)
    - Changing the EtherCAT output PDOs
 */
 
@@ -44,6 +44,7 @@
 #include "ethercat_communicator.h"
 #include "ether_ros.h"
 #include "utilities.h"
+#include <sstream>
 
 
 bool ethercat_communicatord(ether_ros::EthercatCommd::Request &req,
@@ -86,11 +87,37 @@ bool ethercat_communicatord(ether_ros::EthercatCommd::Request &req,
         res.success = "true";
         return true;
     }
+    else if (req.mode == "reset_fault")
+    {
+        // the slaves are driven again by the output image, from the next cycle
+        res.success = ethercat_comm.overrun_fault() ? "true" : "false";
+        ethercat_comm.reset_overrun_fault();
+        return true;
+    }
+    else if (req.mode.compare(0, 6, "period") == 0)
+    {
+        // period <period_ns> [<sync0_shift_ns>]: the shift of the slaves is kept, if it's missing
+        std::istringstream args(req.mode.substr(6));
+        int period_ns;
+        int32_t sync0_shift = ethercat_slaves[0].slave.get_sync0_shift();
+
+        if (!(args >> period_ns) || (!args.eof() && !(args >> sync0_shift)))
+            return false;
+        s = ethercat_comm.change_period(period_ns, sync0_shift);
+        if (s)
+        {
+            ros::NodeHandle n;
+            n.setParam("/ethercat_slaves/period_ns", period_ns);
+            n.setParam("/ethercat_slaves/sync0_shift", sync0_shift);
+        }
+        res.success = s ? "true" : "false";
+        return true;
+    }
     else if (req.mode == "clear")
     {
-        pthread_spin_lock(&lock);
+        output_image.begin_write();
         memset(process_data_buf, 0, total_process_data); // fill the buffer with zeros
-        pthread_spin_unlock(&lock);
+        output_image.commit();
         res.success = "true";
         return true;
     }
@@ -0,0 +1,186 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file shared_memory_client.cpp
+   \brief Implementation of SharedMemoryClient class.
+
+   The readers of the input image retry a bounded number of times, if the communicator
+   writes the image while they copy it (seqlock). The writers of the output image
+   make the sequence of the slave odd while they write, so that the communicator skips them.
+*/
+
+/*****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include "shared_memory_client.h"
+
+#define SHM_READ_RETRIES 16
+
+SharedMemoryClient::SharedMemoryClient() : header_(NULL), region_size_(0), input_image_(NULL), output_image_(NULL)
+{
+}
+
+SharedMemoryClient::~SharedMemoryClient()
+{
+    close();
+}
+
+bool SharedMemoryClient::open(const char *name)
+{
+    struct stat st;
+    void *region;
+    int fd;
+
+    close();
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(shm_header))
+    {
+        ::close(fd);
+        return false;
+    }
+    region = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (region == MAP_FAILED)
+        return false;
+
+    header_ = (shm_header *)region;
+    region_size_ = st.st_size;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->magic != SHM_MAGIC || header_->version != SHM_VERSION ||
+        header_->header_size != sizeof(shm_header) ||
+        header_->output_image_offset + header_->image_size > region_size_)
+    {
+        close();
+        return false;
+    }
+    input_image_ = (uint8_t *)region + header_->input_image_offset;
+    output_image_ = (uint8_t *)region + header_->output_image_offset;
+    return true;
+}
+
+void SharedMemoryClient::close()
+{
+    if (header_)
+        munmap(header_, region_size_);
+    header_ = NULL;
+    region_size_ = 0;
+    input_image_ = output_image_ = NULL;
+}
+
+bool SharedMemoryClient::is_open()
+{
+    return header_ != NULL;
+}
+
+size_t SharedMemoryClient::image_size()
+{
+    return header_->image_size;
+}
+
+int SharedMemoryClient::slave_count()
+{
+    return header_->slave_count;
+}
+
+const shm_slave_entry *SharedMemoryClient::slave_entry(int slave)
+{
+    return &header_->slaves[slave];
+}
+
+uint64_t SharedMemoryClient::cycle()
+{
+    header_->in_seq.load(std::memory_order_acquire);
+    return header_->cycle;
+}
+
+static bool read_image(shm_header *header, uint8_t *dst, const uint8_t *src, size_t size, shm_frame_info *info)
+{
+    for (int i = 0; i < SHM_READ_RETRIES; i++)
+    {
+        uint64_t seq = header->in_seq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        memcpy(dst, src, size);
+        if (info)
+        {
+            info->cycle = header->cycle;
+            info->timestamp_ns = header->timestamp_ns;
+            info->working_counter = header->working_counter;
+            info->wc_state = header->wc_state;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->in_seq.load(std::memory_order_relaxed) == seq)
+            return true;
+    }
+    return false;
+}
+
+bool SharedMemoryClient::read_inputs(uint8_t *buffer, shm_frame_info *info)
+{
+    return read_image(header_, buffer, input_image_, header_->image_size, info);
+}
+
+bool SharedMemoryClient::read_slave_inputs(int slave, uint8_t *buffer, shm_frame_info *info)
+{
+    const shm_slave_entry *entry = &header_->slaves[slave];
+    return read_image(header_, buffer, input_image_ + entry->pdo_in_offset, entry->pdo_in_size, info);
+}
+
+bool SharedMemoryClient::stage_outputs(int slave, const uint8_t *data)
+{
+    const shm_slave_entry *entry;
+    uint64_t seq;
+
+    if (slave < 0 || slave >= (int)header_->slave_count)
+        return false;
+    entry = &header_->slaves[slave];
+    seq = header_->out_seq[slave].load(std::memory_order_relaxed);
+    if (seq & 1)
+        seq++; // a previous writer died in the middle, recover
+    header_->out_seq[slave].store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(output_image_ + entry->pdo_out_offset, data, entry->pdo_out_size);
+    header_->out_seq[slave].store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+void SharedMemoryClient::release_outputs(int slave)
+{
+    if (slave < 0 || slave >= (int)header_->slave_count)
+        return;
+    header_->out_seq[slave].store(0, std::memory_order_release);
+}
@@ -0,0 +1,166 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file shared_memory_mirror.cpp
+   \brief Implementation of SharedMemoryMirror class.
+
+   Used for giving to the processes of the same host, zero-copy access to the domain of
+   the EtherCAT Communicator via a POSIX shared memory region. The layout of the region
+   is described in shared_memory_layout.h.
+*/
+
+/*****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include "shared_memory_mirror.h"
+#include "ether_ros.h"
+
+SharedMemoryMirror::SharedMemoryMirror() : enabled_(false), region_size_(0), header_(NULL),
+                                           input_image_(NULL), output_image_(NULL), scratch_(NULL),
+                                           applied_seq_(NULL)
+{
+}
+
+void SharedMemoryMirror::init(ros::NodeHandle &n)
+{
+    int fd;
+    void *region;
+
+    n.param("/ethercat_slaves/shared_memory/enabled", enabled_, false);
+    if (!enabled_)
+        return;
+    n.param<std::string>("/ethercat_slaves/shared_memory/name", name_, SHM_DEFAULT_NAME);
+
+    if (slaves_count > SHM_MAX_SLAVES)
+    {
+        ROS_FATAL("Shared memory: %d slaves, but only %d fit in the header\n", slaves_count, SHM_MAX_SLAVES);
+        exit(1);
+    }
+    region_size_ = sizeof(shm_header) + 2 * total_process_data;
+
+    shm_unlink(name_.c_str()); // never map a stale region with an older layout
+    fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (fd < 0)
+    {
+        ROS_FATAL("Shared memory: could not create %s: %s\n", name_.c_str(), strerror(errno));
+        exit(1);
+    }
+    if (ftruncate(fd, region_size_))
+    {
+        ROS_FATAL("Shared memory: ftruncate: %s\n", strerror(errno));
+        exit(1);
+    }
+    region = mmap(NULL, region_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+    {
+        ROS_FATAL("Shared memory: mmap: %s\n", strerror(errno));
+        exit(1);
+    }
+    memset(region, 0, region_size_); // prefault the pages, before the realtime use
+
+    header_ = (shm_header *)region;
+    input_image_ = (uint8_t *)region + sizeof(shm_header);
+    output_image_ = input_image_ + total_process_data;
+    scratch_ = new uint8_t[total_process_data];
+    memset(scratch_, 0, total_process_data);
+    applied_seq_ = new uint64_t[slaves_count];
+    memset(applied_seq_, 0, slaves_count * sizeof(uint64_t));
+
+    header_->header_size = sizeof(shm_header);
+    header_->image_size = total_process_data;
+    header_->input_image_offset = sizeof(shm_header);
+    header_->output_image_offset = sizeof(shm_header) + total_process_data;
+    header_->slave_count = slaves_count;
+    for (int i = 0; i < slaves_count; i++)
+    {
+        shm_slave_entry *entry = &header_->slaves[i];
+        entry->pdo_out_offset = slave_offsets[i].pdo_out;
+        entry->pdo_out_size = slave_offsets[i].pdo_out_size;
+        entry->pdo_in_offset = slave_offsets[i].pdo_in;
+        entry->pdo_in_size = slave_offsets[i].pdo_in_size;
+    }
+    header_->version = SHM_VERSION;
+    // the magic goes last: a client seeing it can trust the rest of the header
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SHM_MAGIC;
+    ROS_INFO("Shared memory: mirroring the domain in %s (%lu bytes)\n", name_.c_str(), region_size_);
+}
+
+bool SharedMemoryMirror::enabled()
+{
+    return enabled_;
+}
+
+void SharedMemoryMirror::publish_inputs(uint64_t cycle, uint64_t timestamp_ns, const uint8_t *domain_pd)
+{
+    uint64_t seq = header_->in_seq.load(std::memory_order_relaxed);
+
+    header_->in_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(input_image_, domain_pd, total_process_data);
+    header_->cycle = cycle;
+    header_->timestamp_ns = timestamp_ns;
+    header_->working_counter = ethercat_domains[0].working_counter();
+    header_->wc_state = ethercat_domains[0].wc_state();
+    header_->in_seq.store(seq + 2, std::memory_order_release);
+}
+
+bool SharedMemoryMirror::apply_outputs(uint8_t *domain_pd)
+{
+    bool applied = false;
+
+    for (int i = 0; i < slaves_count; i++)
+    {
+        uint64_t seq = header_->out_seq[i].load(std::memory_order_acquire);
+        if (seq == 0 || (seq & 1))
+            continue; // not owned by any client, or being written right now
+        const shm_slave_entry *entry = &header_->slaves[i];
+        // copy to the scratch first: the domain must never get a torn image
+        memcpy(scratch_ + entry->pdo_out_offset, output_image_ + entry->pdo_out_offset, entry->pdo_out_size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_->out_seq[i].load(std::memory_order_relaxed) != seq)
+            continue;
+        memcpy(domain_pd + entry->pdo_out_offset, scratch_ + entry->pdo_out_offset, entry->pdo_out_size);
+        applied = true;
+        if (seq != applied_seq_[i])
+        {
+            // a client which stopped staging falls back to the safe outputs, like a dead topic publisher
+            applied_seq_[i] = seq;
+            output_watchdog.feed(i);
+        }
+    }
+    return applied;
+}
@@ -0,0 +1,316 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file simulated_master.cpp
+   \brief Implementation of SimulatedMaster class.
+
+   Used for running (and benchmarking) the whole application without the IgH Master Module and
+   without any slaves: select it with \a master/backend: sim, in ethercat_slaves.yaml.
+*/
+
+/*****************************************************************************/
+
+#include "simulated_master.h"
+#include "ethercat_slave.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#define NSEC_PER_SEC (1000000000L)
+
+// the RxPDOs (the outputs of the slaves) are mapped from 0x7000 (CiA 301/402), the TxPDOs below
+#define SIM_OUTPUT_INDEX 0x7000
+
+SimulatedMaster::SimulatedMaster()
+    : reg_requests_(0), image_(NULL), frame_(NULL), image_size_(0), active_(false), app_time_(0), random_(2463534242U)
+{
+    memset(&config_, 0, sizeof(config_));
+}
+
+SimulatedMaster::~SimulatedMaster()
+{
+    free(image_);
+    free(frame_);
+}
+
+void SimulatedMaster::init(const simulated_master_config &config)
+{
+    config_ = config;
+}
+
+void SimulatedMaster::busy_wait(int ns)
+{
+    struct timespec now;
+    uint64_t deadline;
+
+    if (config_.jitter_ns > 0)
+    {
+        // xorshift32: cheap and reproducible
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        ns += random_ % (config_.jitter_ns + 1);
+    }
+    if (ns <= 0)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    deadline = (uint64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec + ns;
+    do
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    while ((uint64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec < deadline);
+}
+
+bool SimulatedMaster::request(int index)
+{
+    return index == 0 && config_.slaves > 0;
+}
+
+int SimulatedMaster::info(ec_master_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->slave_count = config_.slaves;
+    info->link_up = 1;
+    return 0;
+}
+
+void SimulatedMaster::state(ec_master_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+    state->slaves_responding = config_.slaves;
+    state->al_states = active_ ? 0x08 : 0x02; // OP, or PREOP before the activation
+    state->link_up = 1;
+}
+
+int SimulatedMaster::create_domain()
+{
+    sim_domain domain = {};
+
+    if (active_)
+        return -1;
+    domains_.push_back(domain);
+    return domains_.size() - 1;
+}
+
+size_t SimulatedMaster::domain_size(int domain)
+{
+    return domains_[domain].size;
+}
+
+uint8_t *SimulatedMaster::domain_data(int domain)
+{
+    return active_ ? image_ + domains_[domain].offset : NULL;
+}
+
+void SimulatedMaster::domain_process(int domain)
+{
+    sim_domain &d = domains_[domain];
+
+    if (!d.exchanged)
+        return;
+    d.exchanged = false;
+    for (size_t i = 0; i < loopback_.size(); i++)
+    {
+        const sim_block &b = loopback_[i];
+        if (b.domain == domain)
+            memcpy(image_ + d.offset + b.in_offset, frame_ + d.offset + b.out_offset, b.size);
+    }
+}
+
+void SimulatedMaster::domain_state(int domain, ec_domain_state_t *state)
+{
+    // the state of the last processed exchange: complete, as no datagram is ever lost
+    state->working_counter = domains_[domain].working_counter;
+    state->wc_state = domains_[domain].working_counter ? EC_WC_COMPLETE : EC_WC_ZERO;
+    state->redundancy_active = 0;
+}
+
+void SimulatedMaster::domain_queue(int domain)
+{
+    domains_[domain].queued = true;
+}
+
+int SimulatedMaster::slave_config(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code)
+{
+    if (active_ || position >= config_.slaves)
+        return -1;
+    out_offsets_.push_back(-1);
+    in_offsets_.push_back(-1);
+    config_domains_.push_back(-1);
+    return out_offsets_.size() - 1;
+}
+
+int SimulatedMaster::reg_pdo_entry(int slave_config, uint16_t index, uint8_t subindex, int domain)
+{
+    sim_domain &d = domains_[domain];
+    bool output = index >= SIM_OUTPUT_INDEX;
+    int offset = d.size;
+
+    if (active_ || (config_domains_[slave_config] >= 0 && config_domains_[slave_config] != domain))
+        return -1;
+    config_domains_[slave_config] = domain;
+    d.size += output ? config_.pdo_out_size : config_.pdo_in_size;
+    // a logical read write datagram: +2 for the outputs of a slave, +1 for its inputs
+    d.working_counter += output ? 2 : 1;
+    (output ? out_offsets_ : in_offsets_)[slave_config] = offset;
+    if (out_offsets_[slave_config] >= 0 && in_offsets_[slave_config] >= 0)
+    {
+        sim_block b = {domain, (size_t)out_offsets_[slave_config], (size_t)in_offsets_[slave_config],
+                       (size_t)std::min(config_.pdo_out_size, config_.pdo_in_size)};
+        if (config_.loopback && b.size)
+            loopback_.push_back(b);
+    }
+    return offset;
+}
+
+void SimulatedMaster::config_dc(int slave_config, uint16_t assign_activate, uint32_t sync0_cycle, int32_t sync0_shift)
+{
+}
+
+int SimulatedMaster::create_reg_request(int slave_config, size_t size)
+{
+    return active_ ? -1 : reg_requests_++;
+}
+
+void SimulatedMaster::reg_request_write(int request, uint16_t address, const uint8_t *data, size_t size)
+{
+}
+
+ec_request_state_t SimulatedMaster::reg_request_state(int request)
+{
+    return EC_REQUEST_SUCCESS;
+}
+
+void SimulatedMaster::slave_config_state(int slave_config, ec_slave_config_state_t *state)
+{
+    // every configured slave is there, and operational once the master is active
+    state->online = 1;
+    state->operational = active_;
+    state->al_state = active_ ? 0x08 : 0x02;
+}
+
+int SimulatedMaster::select_reference_clock(int slave_config)
+{
+    return 0;
+}
+
+int SimulatedMaster::activate()
+{
+    if (active_)
+        return -1;
+    // the domains one after the other, as the IgH Master maps them
+    image_size_ = 0;
+    for (size_t i = 0; i < domains_.size(); i++)
+    {
+        domains_[i].offset = image_size_;
+        image_size_ += domains_[i].size;
+    }
+    image_ = (uint8_t *)calloc(image_size_ ? image_size_ : 1, 1);
+    frame_ = (uint8_t *)calloc(image_size_ ? image_size_ : 1, 1);
+    if (!image_ || !frame_)
+        return -1;
+    active_ = true;
+    return 0;
+}
+
+void SimulatedMaster::receive()
+{
+    busy_wait(config_.receive_ns);
+}
+
+void SimulatedMaster::send()
+{
+    busy_wait(config_.send_ns);
+    for (size_t i = 0; i < domains_.size(); i++)
+    {
+        sim_domain &d = domains_[i];
+        // the outputs leave with the frame; they are the inputs of the next process()
+        if (d.queued && !loopback_.empty())
+            memcpy(frame_ + d.offset, image_ + d.offset, d.size);
+        d.exchanged = d.queued;
+        d.queued = false;
+    }
+}
+
+void SimulatedMaster::application_time(uint64_t time_ns)
+{
+    app_time_ = time_ns;
+}
+
+int SimulatedMaster::reference_clock_time(uint32_t *time)
+{
+    *time = (uint32_t)app_time_;
+    return 0;
+}
+
+void SimulatedMaster::sync_reference_clock()
+{
+}
+
+void SimulatedMaster::sync_slave_clocks()
+{
+}
+
+void SimulatedMaster::sync_monitor_queue()
+{
+}
+
+uint32_t SimulatedMaster::sync_monitor_process()
+{
+    return 0;
+}
+
+//--------------------------------------------------------------------------//
+
+simulated_master_config load_simulated_master_config(ros::NodeHandle &n)
+{
+    simulated_master_config config;
+
+    n.param("/ethercat_slaves/master/sim/slaves", config.slaves, 0);
+    n.param("/ethercat_slaves/master/sim/pdo_in_size", config.pdo_in_size, 22);
+    n.param("/ethercat_slaves/master/sim/pdo_out_size", config.pdo_out_size, 38);
+    n.param("/ethercat_slaves/master/sim/receive_ns", config.receive_ns, 5000);
+    n.param("/ethercat_slaves/master/sim/send_ns", config.send_ns, 5000);
+    n.param("/ethercat_slaves/master/sim/jitter_ns", config.jitter_ns, 0);
+    n.param("/ethercat_slaves/master/sim/loopback", config.loopback, true);
+    if (!config.slaves)
+        config.slaves = find_configured_slaves(n).size();
+    if (config.slaves <= 0 || config.pdo_in_size < 0 || config.pdo_out_size < 0 ||
+        config.receive_ns < 0 || config.send_ns < 0 || config.jitter_ns < 0)
+    {
+        ROS_FATAL("master/sim: expected slaves > 0 and non negative sizes and times\n");
+        exit(1);
+    }
+    ROS_INFO("Simulated bus: %d slaves, %d/%d PDO bytes in/out, receive %d ns, send %d ns, jitter %d ns%s\n",
+             config.slaves, config.pdo_in_size, config.pdo_out_size, config.receive_ns, config.send_ns,
+             config.jitter_ns, config.loopback ? ", loopback" : "");
+    return config;
+}
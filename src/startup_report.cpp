@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file startup_report.cpp
+   \brief Implementation of the startup report.
+*/
+
+/*****************************************************************************/
+
+#include <time.h>
+#include <atomic>
+#include <string>
+#include "startup_report.h"
+#include "ether_ros.h"
+
+namespace startup_report
+{
+static const char *phase_names[STARTUP_PHASES] = {"parameters", "slaves", "ready", "activated", "first_cycle"};
+static uint64_t start_ns;
+static std::atomic<uint64_t> marks_ns[STARTUP_PHASES];
+static bool reported[STARTUP_PHASES];
+static uint64_t last_reported_ns;
+
+static uint64_t now_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_TO_USE, &t);
+    return TIMESPEC2NS(t);
+}
+
+void begin()
+{
+    start_ns = now_ns();
+    last_reported_ns = start_ns;
+    for (int i = 0; i < STARTUP_PHASES; i++)
+    {
+        marks_ns[i].store(0, std::memory_order_relaxed);
+        reported[i] = false;
+    }
+}
+
+void mark(startup_phase phase)
+{
+    if (!marks_ns[phase].load(std::memory_order_relaxed))
+        marks_ns[phase].store(now_ns(), std::memory_order_release);
+}
+
+bool report(ros::NodeHandle &n)
+{
+    bool all = true;
+
+    for (int i = 0; i < STARTUP_PHASES; i++)
+    {
+        uint64_t mark_ns = marks_ns[i].load(std::memory_order_acquire);
+
+        if (reported[i])
+            continue;
+        if (!mark_ns)
+        {
+            all = false;
+            continue;
+        }
+        double ms = (mark_ns - start_ns) / 1e6;
+        ROS_INFO("Startup: %s at %.1f ms (+%.1f ms)\n", phase_names[i], ms, ((int64_t)mark_ns - (int64_t)last_reported_ns) / 1e6);
+        n.setParam(std::string("/ethercat_slaves/startup/") + phase_names[i] + "_ms", ms);
+        last_reported_ns = mark_ns;
+        reported[i] = true;
+    }
+    return all;
+}
+} // namespace startup_report
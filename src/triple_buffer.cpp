@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2018 Mike Karamousadakis, NTUA CSL
+ *
+ *  This file is part of the IgH EtherCAT master userspace program in the ROS environment.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is free software; you can
+ *  redistribute it and/or modify it under the terms of the GNU General
+ *  Public License as published by the Free Software Foundation; version 2
+ *  of the License.
+ *
+ *  The IgH EtherCAT master userspace program in the ROS environment is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ *  warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the IgH EtherCAT master userspace program in the ROS environment. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  ---
+ *
+ *  The license mentioned above concerns the source code only. Using the
+ *  EtherCAT technology and brand is only permitted in compliance with the
+ *  industrial property and similar rights of Beckhoff Automation GmbH.
+ *
+ *  Contact information: mkaramousadakis@zoho.eu
+ *****************************************************************************/
+/**
+   \file triple_buffer.cpp
+   \brief Implementation of TripleBuffer class.
+
+   Wait-free handover of whole images between a producer and a consumer thread.
+   The index of the "middle" buffer, together with a flag showing that it holds
+   an image not consumed yet, lives in a single atomic byte, so that every
+   handover is a single atomic exchange.
+*/
+
+/*****************************************************************************/
+
+#include <string.h>
+#include "triple_buffer.h"
+
+TripleBuffer::TripleBuffer() : size_(0), middle_(1), back_(0), front_(2)
+{
+    buffers_[0] = buffers_[1] = buffers_[2] = NULL;
+}
+
+TripleBuffer::~TripleBuffer()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        delete[] buffers_[i];
+    }
+}
+
+void TripleBuffer::init(size_t size)
+{
+    size_ = size;
+    for (int i = 0; i < 3; i++)
+    {
+        delete[] buffers_[i];
+        buffers_[i] = new uint8_t[size];
+        memset(buffers_[i], 0, size); // prefault the pages, before the realtime use
+    }
+    back_ = 0;
+    middle_.store(1, std::memory_order_relaxed);
+    front_ = 2;
+}
+
+size_t TripleBuffer::size()
+{
+    return size_;
+}
+
+uint8_t *TripleBuffer::write_buffer()
+{
+    return buffers_[back_];
+}
+
+void TripleBuffer::publish()
+{
+    uint8_t old = middle_.exchange(back_ | FRESH_BIT, std::memory_order_acq_rel);
+    back_ = old & INDEX_MASK;
+}
+
+bool TripleBuffer::update()
+{
+    if (!(middle_.load(std::memory_order_relaxed) & FRESH_BIT))
+        return false;
+    uint8_t old = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = old & INDEX_MASK;
+    return true;
+}
+
+const uint8_t *TripleBuffer::read_buffer()
+{
+    return buffers_[front_];
+}
@@ -62,103 +62,6 @@ int safe_atoi(const char *s, int *val)
         return -1;
 }
 
-bool process_input_bit(uint8_t *data_ptr, uint8_t index, uint8_t subindex)
-{
-    bool return_value = false;
-    uint8_t *new_data_ptr;
-    new_data_ptr = (data_ptr + index);
-    return_value = EC_READ_BIT(new_data_ptr, subindex);
-    return return_value;
-}
-
-uint8_t process_input_uint8(uint8_t *data_ptr, uint8_t index)
-{
-    uint8_t return_value = 0x00;
-    uint8_t *new_data_ptr;
-    new_data_ptr = (data_ptr + index);
-    return_value = EC_READ_U8(new_data_ptr);
-    return return_value;
-}
-int8_t process_input_int8(uint8_t *data_ptr, uint8_t index)
-{
-    int8_t return_value = 0x00;
-    uint8_t *new_data_ptr;
-    new_data_ptr = (data_ptr + index);
-    return_value = EC_READ_S8(new_data_ptr);
-    return return_value;
-}
-
-uint16_t process_input_uint16(uint8_t *data_ptr, uint8_t index)
-{
-    uint16_t return_value = 0x0000;
-    uint8_t new_data_ptr[2];
-    new_data_ptr[0] = data_ptr[index];
-    new_data_ptr[1] = data_ptr[index + 1];
-    return_value = EC_READ_U16(new_data_ptr);
-    return return_value;
-}
-int16_t process_input_int16(uint8_t *data_ptr, uint8_t index)
-{
-    int16_t return_value = 0x0000;
-    uint8_t new_data_ptr[2];
-    new_data_ptr[0] = data_ptr[index];
-    new_data_ptr[1] = data_ptr[index + 1];
-    return_value = EC_READ_S16(new_data_ptr);
-    return return_value;
-}
-uint32_t process_input_uint32(uint8_t *data_ptr, uint8_t index)
-{
-    uint32_t return_value = 0x00000000;
-    uint8_t new_data_ptr[4];
-    new_data_ptr[0] = data_ptr[index];
-    new_data_ptr[1] = data_ptr[index + 1];
-    new_data_ptr[2] = data_ptr[index + 2];
-    new_data_ptr[3] = data_ptr[index + 3];
-    return_value = EC_READ_U32(new_data_ptr);
-    return return_value;
-}
-int32_t process_input_int32(uint8_t *data_ptr, uint8_t index)
-{
-    int32_t return_value = 0x00000000;
-    uint8_t new_data_ptr[4];
-    new_data_ptr[0] = data_ptr[index];
-    new_data_ptr[1] = data_ptr[index + 1];
-    new_data_ptr[2] = data_ptr[index + 2];
-    new_data_ptr[3] = data_ptr[index + 3];
-    return_value = EC_READ_S32(new_data_ptr);
-    return return_value;
-}
-uint64_t process_input_uint64(uint8_t *data_ptr, uint8_t index)
-{
-    uint64_t return_value = 0x0000000000000000;
-    uint8_t new_data_ptr[8];
-    new_data_ptr[0] = data_ptr[index];
-    new_data_ptr[1] = data_ptr[index + 1];
-    new_data_ptr[2] = data_ptr[index + 2];
-    new_data_ptr[3] = data_ptr[index + 3];
-    new_data_ptr[4] = data_ptr[index + 4];
-    new_data_ptr[5] = data_ptr[index + 5];
-    new_data_ptr[6] = data_ptr[index + 6];
-    new_data_ptr[7] = data_ptr[index + 7];
-    return_value = EC_READ_U64(new_data_ptr);
-    return return_value;
-}
-int64_t process_input_int64(uint8_t *data_ptr, uint8_t index)
-{
-    int64_t return_value = 0x0000000000000000;
-    uint8_t new_data_ptr[8];
-    new_data_ptr[0] = data_ptr[index];
-    new_data_ptr[1] = data_ptr[index + 1];
-    new_data_ptr[2] = data_ptr[index + 2];
-    new_data_ptr[3] = data_ptr[index + 3];
-    new_data_ptr[4] = data_ptr[index + 4];
-    new_data_ptr[5] = data_ptr[index + 5];
-    new_data_ptr[6] = data_ptr[index + 6];
-    new_data_ptr[7] = data_ptr[index + 7];
-    return_value = EC_READ_S64(new_data_ptr);
-    return return_value;
-}
-
 struct timespec timespec_add(struct timespec time1, struct timespec time2)
 {
     struct timespec result;
@@ -177,33 +80,13 @@ struct timespec timespec_add(struct timespec time1, struct timespec time2)
     return result;
 }
 
-void check_domain1_state(void)
-{
-    ec_domain_state_t ds;
-
-    ecrt_domain_state(domain1, &ds);
-
-    if (ds.working_counter != domain1_state.working_counter)
-        ROS_INFO("Domain1: WC %u.\n", ds.working_counter);
-    if (ds.wc_state != domain1_state.wc_state)
-        ROS_INFO("Domain1: State %u.\n", ds.wc_state);
-
-    domain1_state = ds;
-}
-
 void check_master_state(void)
 {
     ec_master_state_t ms;
 
-    ecrt_master_state(master, &ms);
-
-    if (ms.slaves_responding != master_state.slaves_responding)
-        ROS_INFO("%u slave(s).\n", ms.slaves_responding);
-    if (ms.al_states != master_state.al_states)
-        ROS_INFO("AL states: 0x%02X.\n", ms.al_states);
-    if (ms.link_up != master_state.link_up)
-        ROS_INFO("Link is %s.\n", ms.link_up ? "up" : "down");
-
+    ethercat_master->state(&ms);
+    // logged by the health monitor, outside of the realtime thread
+    health_monitor.record_master_state(ms);
     master_state = ms;
 }
 
@@ -241,24 +124,17 @@ std::string &trim(std::string &str, const std::string &chars)
     return ltrim(rtrim(str, chars), chars);
 }
 
-void copy_process_data_buffer_to_buf(uint8_t * buffer)
+void copy_process_data_buffer_to_buf(uint8_t * buffer, uint64_t cycle)
 {
-    pthread_spin_lock(&lock);
-    for (int i = 0; i < master_info.slave_count; i++)
-    {
-        memcpy((buffer + ethercat_slaves[i].slave.get_pdo_out()),
-                (process_data_buf + ethercat_slaves[i].slave.get_pdo_out()),
-                (size_t)(ethercat_slaves[i].slave.get_pdo_in() - ethercat_slaves[i].slave.get_pdo_out())
-            );
-    }
     /*
-    buffer + ethercat_slaves[i].slave.get_pdo_out()) ----> the starting address of the slave's output pdos in the buffer
-
-    process_data_buf + ethercat_slaves[i].slave.get_pdo_out()) ----> the starting address of the slave's output pdos in the process_data_buf
-
-    (size_t)(ethercat_slaves[i].slave.get_pdo_in() - ethercat_slaves[i].slave.get_pdo_out() ----> size of output pdos of the slave
-
+    one memcpy per contiguous range of output pdos (the adjacent slaves are merged),
+    and only for the ranges changed since the previous cycle
     */
-    pthread_spin_unlock(&lock);
+    output_image.copy_to(buffer, cycle);
+}
+
+void clear_outputs(uint8_t *buffer)
+{
+    output_watchdog.write_safe_outputs(buffer);
 }
 } // namespace utilities